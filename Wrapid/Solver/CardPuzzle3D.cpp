@@ -21,8 +21,8 @@ namespace
     const int kRepeats = Solver::kCardPuzzleSuits;
 }
 
-CardPuzzle3D::CardPuzzle3D()
-    : mSolver(new PuzzleSolver<3>(kSize, kSymbols, kRepeats, true))
+CardPuzzle3D::CardPuzzle3D(Solver::SearchOptions options)
+    : mSolver(new PuzzleSolver<3>(kSize, kSymbols, kRepeats, true, options))
 {
 }
 
@@ -45,6 +45,11 @@ Solver::SolveResult CardPuzzle3D::findNextSolution()
     return mSolver->findNextSolution();
 }
 
+Solver::SolutionCount CardPuzzle3D::countSolutions(Solver::SolutionCount limit)
+{
+    return mSolver->countSolutions(limit);
+}
+
 void CardPuzzle3D::print(std::ostream& stream) const
 {
     return mSolver->print(stream);
@@ -64,6 +69,7 @@ namespace
         void run()
         {
             RUN( solveTest );
+            RUN( restartTest );
         }
 
         void solveTest()
@@ -141,6 +147,40 @@ namespace
 
             testSolver<CardPuzzle3D>(puzzle, target, 5, 5);
         }
+
+        // The puzzle above, which restarting in a random order gets out of
+        // quickly. The same seed comes to the same solution each time.
+        void restartTest()
+        {
+            const char* puzzle[13] = {
+                "+----+----+----+ +----+----+----+ +----+----+----+",
+                "|   o|         | |    |        o| |    |         |",
+                "+    +    +----+ +    +    +----+ +    +    +----+",
+                "|    |    |    | |    |    |    | |    |    |    |",
+                "+    +    +    + +    +    +    + +    +    +    +",
+                "|  3 |    |    | |    |    |    | |    |    |  K |",
+                "+    +    +    + +    +    +    + +    +    +    +",
+                "|    |    |    | |   o|    |   o| |    |    |    |",
+                "+    +    +    + +    +    +    + +    +    +    +",
+                "|         |   o| |         |    | |    |  ? |    |",
+                "+----+    +----+ +----+----+    + +    +    +----+",
+                "|              | |       A      | |   o|         |",
+                "+----+----+----+ +----+----+----+ +----+----+----+"
+            };
+
+            Solver::SearchOptions options(Solver::kRestarts | Solver::kForwardChecking, 1, 3);
+            std::string solutions[2];
+            for(int i = 0; i < 2; ++i)
+            {
+                CardPuzzle3D solver(options);
+                CHECK_ASSERT(solver.parse(puzzle) == Solver::kParseSucceed);
+                CHECK_ASSERT(solver.findNextSolution() == Solver::kFoundSolution);
+                std::ostringstream stream;
+                solver.print(stream);
+                solutions[i] = stream.str();
+            }
+            CHECK(solutions[0] == solutions[1]);
+        }
     };
 }
 
@@ -9,6 +9,7 @@
 #include "Solver/Symbol.h"
 #include "Solver/SolveResult.h"
 #include "Solver/ParseResult.h"
+#include "Solver/SearchOptions.h"
 
 #include <vector>
 #include <iostream>
@@ -27,7 +28,7 @@ class Solver::CardPuzzle3D
     PREVENT_COPY_AND_ASSIGNMENT(CardPuzzle3D);
 
 public:
-    CardPuzzle3D();
+    explicit CardPuzzle3D(SearchOptions options = SearchOptions());
     ~CardPuzzle3D();
 
     // See CardPuzzle3DIO for required format.
@@ -36,6 +37,9 @@ public:
 
     SolveResult findNextSolution();
 
+    // Count the solutions, up to the limit if it isn't zero.
+    SolutionCount countSolutions(SolutionCount limit = 0);
+
     void print(std::ostream& stream) const;
 
 private:
@@ -20,8 +20,8 @@ namespace
     const int kRepeats = Solver::kCardPuzzleSuits;
 }
 
-CardPuzzle4D::CardPuzzle4D()
-    : mSolver(new PuzzleSolver<4>(kSize, kSymbols, kRepeats, true))
+CardPuzzle4D::CardPuzzle4D(Solver::SearchOptions options)
+    : mSolver(new PuzzleSolver<4>(kSize, kSymbols, kRepeats, true, options))
 {
 }
 
@@ -44,6 +44,11 @@ Solver::SolveResult CardPuzzle4D::findNextSolution()
     return mSolver->findNextSolution();
 }
 
+Solver::SolutionCount CardPuzzle4D::countSolutions(Solver::SolutionCount limit)
+{
+    return mSolver->countSolutions(limit);
+}
+
 void CardPuzzle4D::print(std::ostream& stream) const
 {
     return mSolver->print(stream);
@@ -9,6 +9,7 @@
 #include "Solver/Symbol.h"
 #include "Solver/SolveResult.h"
 #include "Solver/ParseResult.h"
+#include "Solver/SearchOptions.h"
 
 #include <vector>
 #include <iostream>
@@ -28,7 +29,7 @@ class Solver::CardPuzzle4D
     struct Data;
 
 public:
-    CardPuzzle4D();
+    explicit CardPuzzle4D(SearchOptions options = SearchOptions());
     ~CardPuzzle4D();
 
     // See CardPuzzle4DIO for required format.
@@ -37,6 +38,9 @@ public:
 
     SolveResult findNextSolution();
 
+    // Count the solutions, up to the limit if it isn't zero.
+    SolutionCount countSolutions(SolutionCount limit = 0);
+
     void print(std::ostream& stream) const;
 
 private:
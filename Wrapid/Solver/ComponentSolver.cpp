@@ -0,0 +1,137 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/ComponentSolver.h"
+
+#ifdef BUILD_TESTS
+
+#include "Solver/SolverTest.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace Solver;
+
+namespace
+{
+    class ComponentSolverTest : public Solver::SolverTest
+    {
+    public:
+        void run()
+        {
+            RUN( levelsTest );
+            RUN( wallTest );
+            RUN( noSolutionTest );
+            RUN( onePieceTest );
+        }
+
+        void levelsTest()
+        {
+            // Three levels of four with nothing between them, which
+            // only have to share out the symbols.
+            Grid<3> grid(coord(2, 2, 3));
+            grid.blockAll(2);
+            Sequence symbols(4, 3);
+            GridValues<3> presets(grid.getSize());
+            presets.place(1, coord(0, 0, 0));
+
+            ComponentSolver<3> split(grid, symbols, SearchOptions());
+            split.addPresets(presets);
+            CHECK(split.countSolutions(0) == 800);
+            CHECK(split.componentCount() == 3);
+
+            checkSameSolutionSet<ComponentSolver>(grid, symbols, presets, 0);
+            checkSameSolutionSet<ComponentSolver>(grid, symbols, presets, kArcConsistency | kCardinality);
+            checkSameSolutionSet<ComponentSolver>(grid, symbols, presets, kSmallestDomainFirst | kBreakSymmetry);
+
+            // A level that is already filled in is left as it is.
+            presets.place(2, coord(1, 0, 0));
+            presets.place(2, coord(0, 1, 0));
+            presets.place(3, coord(1, 1, 0));
+            ComponentSolver<3> filled(grid, symbols, SearchOptions());
+            filled.addPresets(presets);
+            Boards solutions = allSolutions(filled);
+            CHECK(filled.componentCount() == 2);
+            CHECK(!solutions.empty());
+            checkSameSolutionSet<ComponentSolver>(grid, symbols, presets, kForwardChecking);
+
+            ComponentSolver<3> limited(grid, symbols, SearchOptions());
+            limited.addPresets(presets);
+            CHECK(limited.countSolutions(10) == 10);
+        }
+
+        void wallTest()
+        {
+            // A wall right across the middle.
+            Grid2D grid(coord(4, 6));
+            grid.unwrap(0);
+            grid.unwrap(1);
+            for(int column = 0; column < 6; ++column)
+            {
+                grid.setWall(coord(1, column), coord(2, column), true);
+            }
+            grid.setWall(coord(0, 2), coord(0, 3), true);
+            grid.setWall(coord(3, 1), coord(3, 2), true);
+            GridValues2D presets(grid.getSize());
+            presets.place(12, coord(0, 0));
+            presets.place(6, coord(3, 5));
+            Sequence symbols(12, 2);
+
+            ComponentSolver<2> split(grid, symbols, SearchOptions());
+            split.addPresets(presets);
+            CHECK(split.countSolutions(0) == 6);
+            CHECK(split.componentCount() == 2);
+            checkSameSolutionSet<ComponentSolver>(grid, symbols, presets, 0);
+            checkSameSolutionSet<ComponentSolver>(grid, symbols, presets, kForwardChecking | kCompressChains);
+        }
+
+        void noSolutionTest()
+        {
+            // Each level can be filled in by itself, but
+            // there aren't enough symbols for all four.
+            Grid<3> grid(coord(2, 2, 4));
+            grid.blockAll(2);
+            Sequence symbols(4, 3);
+
+            ComponentSolver<3> split(grid, symbols, SearchOptions(kForwardChecking));
+            CHECK(split.nextSolution() == kNoSolution);
+            CHECK(split.nextSolution() == kNoSolution);
+            CHECK(split.componentCount() == 4);
+
+            ComponentSolver<3> counter(grid, symbols, SearchOptions());
+            CHECK(counter.countSolutions(0) == 0);
+
+            // More threes than the sequence has.
+            Grid<3> levels(coord(2, 2, 3));
+            levels.blockAll(2);
+            GridValues<3> presets(levels.getSize());
+            presets.place(3, coord(0, 0, 0));
+            presets.place(3, coord(1, 1, 0));
+            presets.place(3, coord(0, 0, 1));
+            presets.place(3, coord(1, 1, 1));
+            ComponentSolver<3> overused(levels, symbols, SearchOptions());
+            overused.addPresets(presets);
+            CHECK(overused.nextSolution() == kNoSolution);
+        }
+
+        void onePieceTest()
+        {
+            Grid<3> grid(coord(2, 2, 3));
+            grid.unwrap(2);
+            Sequence symbols(4, 3);
+            GridValues<3> presets(grid.getSize());
+            presets.place(1, coord(0, 0, 0));
+
+            ComponentSolver<3> whole(grid, symbols, SearchOptions(kForwardChecking));
+            whole.addPresets(presets);
+            CHECK(whole.countSolutions(0) == 200);
+            CHECK(whole.componentCount() == 1);
+        }
+    };
+}
+
+DECLARE_TEST( ComponentSolverTest );
+
+#endif // BUILD_TESTS
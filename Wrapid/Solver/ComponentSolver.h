@@ -0,0 +1,536 @@
+#pragma once
+#ifndef SOLVER_COMPONENTSOLVER_H__INCLUDED
+#define SOLVER_COMPONENTSOLVER_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridSolver.h"
+#include "Solver/ParallelSolver.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/SymbolUsage.h"
+#include "Solver/Topology.h"
+
+#include <vector>
+#include <memory>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class ComponentSolver;
+}
+
+// Solves a board whose walls split it into parts with no way through
+// from one to another. The parts only affect each other through the
+// number of each symbol they use, so each is searched on its own for
+// all of the ways of filling it in, counted by the symbols they use.
+// Those are then put together as a knapsack over the symbol counts,
+// rather than searching every combination of the parts together.
+//
+// Finding every way of filling in a big part can take far longer than
+// solving the whole board, so the part with the most unset cells is
+// left out of the knapsack. It is searched once for each total the
+// other parts can use between them, with the symbols they leave.
+//
+// To count, the knapsack just adds up. To step through the solutions,
+// it picks the symbols for every other part in turn, and then steps
+// through the solutions of each part with exactly those symbols, and
+// the biggest with what is left, like an odometer.
+//
+// A board in one piece is handed straight to a GridSolver (or a
+// ParallelSolver) with the same options. Otherwise the parts are
+// searched with a single thread, without breaking symmetry.
+template <int Dimensions>
+class Solver::ComponentSolver : public Solver::SolveEngine<Dimensions>
+{
+    PREVENT_COPY_AND_ASSIGNMENT(ComponentSolver);
+public:
+    typedef Grid<Dimensions> GridD;
+    typedef GridValues<Dimensions> Values;
+
+    ComponentSolver(const GridD& grid, const Sequence& sequence, SearchOptions options)
+        : mGrid(grid)
+        , mTopology(grid)
+        , mSequence(sequence)
+        , mOptions(options)
+        , mPartOptions(options.flags & ~kPartIgnoredFlags)
+        , mPresets(grid.getSize())
+        , mSolution(grid.getSize())
+        , mStarted(false)
+        , mFeasible(true)
+        , mFilling(false)
+    {
+    }
+
+    ~ComponentSolver()
+    {
+        clearParts();
+    }
+
+    void addPresets(const Values& values)
+    {
+        assert(!mStarted);
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
+        {
+            mPresets.place(it->second, it->first);
+        }
+    }
+
+    SolveResult nextSolution()
+    {
+        if(mPresets.valueCount() == mTopology.cellCount())
+        {
+            mSolution = mPresets;
+            return kAlreadySolved;
+        }
+        if(!mStarted)
+        {
+            start();
+        }
+        if(mWhole.get() != NULLPTR)
+        {
+            return mWhole->nextSolution();
+        }
+        if(mFilling && nextFill())
+        {
+            return kFoundSolution;
+        }
+        while(mFeasible && nextChoice())
+        {
+            if(startFill())
+            {
+                mFilling = true;
+                return kFoundSolution;
+            }
+        }
+        // Every choice has been used up.
+        mFeasible = false;
+        mFilling = false;
+        return kNoSolution;
+    }
+
+    SolutionCount countSolutions(SolutionCount limit = 0)
+    {
+        if(mPresets.valueCount() == mTopology.cellCount())
+        {
+            return 1;
+        }
+        if(!mStarted)
+        {
+            start();
+        }
+        if(mWhole.get() != NULLPTR)
+        {
+            return mWhole->countSolutions(limit);
+        }
+        if(!mFeasible)
+        {
+            return 0;
+        }
+
+        UsageCounts total;
+        total[SymbolUsage(mRemaining.size(), 0)] = 1;
+        UsageCounts joined;
+        for(int i = 0; i < lastComponent() && !total.empty(); ++i)
+        {
+            joinUsage(total, mComponents[i].usage, mRemaining, joined);
+            total.swap(joined);
+        }
+
+        SolutionCount count = 0;
+        const Component& last = mComponents[lastComponent()];
+        UsageCounts::const_iterator end = total.end();
+        for(UsageCounts::const_iterator it = total.begin(); it != end; ++it)
+        {
+            if(limit != 0 && count >= limit)
+            {
+                return limit;
+            }
+            // Only as many of the last part's solutions as could reach the limit.
+            SolutionCount needed = limit == 0 ? 0 : (limit - count + it->second - 1) / it->second;
+            Part part(*this, last, limitsFor(last, leftOver(mRemaining, it->first)));
+            count += it->second * part.count(needed);
+        }
+        return (limit != 0 && count > limit) ? limit : count;
+    }
+
+    const Values& getSolution() const
+    {
+        return mWhole.get() != NULLPTR ? mWhole->getSolution() : mSolution;
+    }
+
+    // The number of parts with cells to fill in, once the search has started.
+    int componentCount() const
+    {
+        return mWhole.get() != NULLPTR ? 1 : (int)mComponents.size();
+    }
+
+private:
+    enum
+    {
+        // Every solution of every part is needed, each part being
+        // searched by itself, so these don't apply.
+        kPartIgnoredFlags = kFirstSolutionOnly | kBreakSymmetry | kExpandSymmetry | kBreakValueSymmetry
+    };
+
+    // A part of the board with some unset cells.
+    struct Component
+    {
+        std::vector<int> cells;
+        std::vector<int> unset;
+        SymbolUsage presets;
+
+        // The ways of filling in the unset cells, by the symbols they use.
+        UsageCounts usage;
+    };
+
+    // One part being searched by itself, with every cell outside it
+    // set to a filler symbol that can sit next to anything. As there
+    // are no open walls out of the part, that doesn't change anything.
+    class Part
+    {
+        PREVENT_COPY_AND_ASSIGNMENT(Part);
+    public:
+        Part(const ComponentSolver& owner, const Component& component, const SymbolUsage& limits)
+            : mFiller(makeRegionSequence(
+                owner.mSequence,
+                limits,
+                owner.mTopology.cellCount() - (int)component.cells.size(),
+                mSequence
+            ))
+            , mSolver(owner.mGrid, mSequence, owner.mPartOptions)
+        {
+            Values presets(owner.mPresets);
+            for(int cell = 0; cell < owner.mTopology.cellCount(); ++cell)
+            {
+                if(owner.mComponentOf[cell] != owner.mComponentOf[component.cells[0]])
+                {
+                    presets.placeAt(mFiller, cell);
+                }
+            }
+            mSolver.addPresets(presets);
+        }
+
+        bool next()
+        {
+            return mSolver.nextSolution() == kFoundSolution;
+        }
+
+        SolutionCount count(SolutionCount limit)
+        {
+            return mSolver.countSolutions(limit);
+        }
+
+        const Values& getSolution() const
+        {
+            return mSolver.getSolution();
+        }
+
+    private:
+        Sequence mSequence;
+        Symbol mFiller;
+        GridSolver<Dimensions> mSolver;
+    };
+    friend class Part;
+
+    void start()
+    {
+        mStarted = true;
+        findComponents();
+        if(mComponents.size() < 2)
+        {
+            if(mOptions.isParallel())
+            {
+                mWhole = std::auto_ptr< SolveEngine<Dimensions> >(
+                    new ParallelSolver<Dimensions>(mGrid, mSequence, mOptions)
+                );
+            }
+            else
+            {
+                mWhole = std::auto_ptr< SolveEngine<Dimensions> >(
+                    new GridSolver<Dimensions>(mGrid, mSequence, mOptions)
+                );
+            }
+            mWhole->addPresets(mPresets);
+            mComponents.clear();
+            return;
+        }
+
+        // What the presets leave of each symbol, for the unset cells.
+        int range = highestSymbol(mSequence.getSymbolMask()) + 1;
+        mRemaining.assign(range, 0);
+        for(Symbol s = Solver::kFirstSymbol; s < range; ++s)
+        {
+            if(hasSymbol(mSequence.getSymbolMask(), s))
+            {
+                mRemaining[s] = mSequence.count(s) - mPresets.symbolCount(s);
+                mFeasible = mFeasible && mRemaining[s] >= 0;
+            }
+        }
+        for(int i = 0; i < lastComponent() && mFeasible; ++i)
+        {
+            countUsage(mComponents[i]);
+            mFeasible = !mComponents[i].usage.empty();
+        }
+    }
+
+    // The part with the most unset cells, which is left out of the
+    // knapsack, and searched with whatever the others leave.
+    int lastComponent() const
+    {
+        return (int)mComponents.size() - 1;
+    }
+
+    // Label the parts that the open walls join up, keeping
+    // those that have unset cells.
+    void findComponents()
+    {
+        int cellCount = mTopology.cellCount();
+        mComponentOf.assign(cellCount, -1);
+        int range = highestSymbol(mSequence.getSymbolMask()) + 1;
+        int label = 0;
+        for(int first = 0; first < cellCount; ++first)
+        {
+            if(mComponentOf[first] >= 0)
+            {
+                continue;
+            }
+            Component component;
+            component.presets.assign(range, 0);
+            component.cells.push_back(first);
+            mComponentOf[first] = label;
+            for(size_t i = 0; i < component.cells.size(); ++i)
+            {
+                int cell = component.cells[i];
+                Topology::const_iterator end = mTopology.end(cell);
+                for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+                {
+                    if(mComponentOf[*n] < 0)
+                    {
+                        mComponentOf[*n] = label;
+                        component.cells.push_back(*n);
+                    }
+                }
+
+                Symbol s = mPresets.atIndex(cell);
+                if(s == Solver::kUnsetSymbol)
+                {
+                    component.unset.push_back(cell);
+                }
+                else if(s < range)
+                {
+                    ++component.presets[s];
+                }
+            }
+            ++label;
+            if(!component.unset.empty())
+            {
+                mComponents.push_back(component);
+            }
+        }
+
+        int biggest = 0;
+        for(int i = 1; i < (int)mComponents.size(); ++i)
+        {
+            if(mComponents[i].unset.size() > mComponents[biggest].unset.size())
+            {
+                biggest = i;
+            }
+        }
+        if(!mComponents.empty())
+        {
+            std::swap(mComponents[biggest], mComponents.back());
+        }
+    }
+
+    // The symbols a part may use are what the presets elsewhere leave.
+    SymbolUsage limitsFor(const Component& component, const SymbolUsage& usage) const
+    {
+        SymbolUsage limits(usage);
+        for(size_t s = 0; s < limits.size(); ++s)
+        {
+            limits[s] += component.presets[s];
+        }
+        return limits;
+    }
+
+    void countUsage(Component& component)
+    {
+        Part part(*this, component, limitsFor(component, mRemaining));
+        SymbolUsage usage(mRemaining.size(), 0);
+        while(part.next())
+        {
+            usage.assign(mRemaining.size(), 0);
+            for(size_t i = 0; i < component.unset.size(); ++i)
+            {
+                ++usage[part.getSolution().atIndex(component.unset[i])];
+            }
+            ++component.usage[usage];
+        }
+    }
+
+    // Step on to the next choice of symbols for every part but the last
+    // that fit in what the presets leave between them. The choice for the
+    // part before the last turns fastest.
+    bool nextChoice()
+    {
+        int count = lastComponent();
+        int k = count - 1;
+        if(mChoice.empty())
+        {
+            mChoice.resize(count);
+            mUsedBefore.assign(count + 1, SymbolUsage(mRemaining.size(), 0));
+            k = 0;
+            mChoice[0] = mComponents[0].usage.begin();
+        }
+        else
+        {
+            ++mChoice[k];
+        }
+        while(k >= 0)
+        {
+            if(mChoice[k] == mComponents[k].usage.end())
+            {
+                if(--k >= 0)
+                {
+                    ++mChoice[k];
+                }
+            }
+            else if(!fitsChoice(k))
+            {
+                ++mChoice[k];
+            }
+            else if(k == count - 1)
+            {
+                return true;
+            }
+            else
+            {
+                ++k;
+                mChoice[k] = mComponents[k].usage.begin();
+            }
+        }
+        return false;
+    }
+
+    // Whether the choice for part k fits in with the ones before it,
+    // and if so, it's added on for the next part.
+    bool fitsChoice(int k)
+    {
+        const SymbolUsage& usage = mChoice[k]->first;
+        for(size_t s = 0; s < usage.size(); ++s)
+        {
+            if(mUsedBefore[k][s] + usage[s] > mRemaining[s])
+            {
+                return false;
+            }
+        }
+        for(size_t s = 0; s < usage.size(); ++s)
+        {
+            mUsedBefore[k + 1][s] = mUsedBefore[k][s] + usage[s];
+        }
+        return true;
+    }
+
+    // Start every part off with the choice, unless the
+    // last part can't be filled in with what is left.
+    bool startFill()
+    {
+        if(mParts.empty())
+        {
+            mParts.assign(mComponents.size(), NULLPTR);
+        }
+        if(!startPart(lastComponent()))
+        {
+            return false;
+        }
+        for(int k = 0; k < lastComponent(); ++k)
+        {
+            startPart(k);
+        }
+        compose();
+        return true;
+    }
+
+    // Step the parts through their solutions with the symbols chosen,
+    // the last part turning fastest.
+    bool nextFill()
+    {
+        for(int k = lastComponent(); k >= 0; --k)
+        {
+            if(mParts[k]->next())
+            {
+                for(int later = k + 1; later <= lastComponent(); ++later)
+                {
+                    startPart(later);
+                }
+                compose();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Every choice came from a solution of the part, so apart from the
+    // first time for the last part, there is always at least one.
+    bool startPart(int k)
+    {
+        const Component& component = mComponents[k];
+        SymbolUsage limits = k == lastComponent()
+            ? limitsFor(component, leftOver(mRemaining, mUsedBefore[k]))
+            : limitsFor(component, mChoice[k]->first);
+        delete mParts[k];
+        mParts[k] = new Part(*this, component, limits);
+        return mParts[k]->next();
+    }
+
+    void compose()
+    {
+        mSolution = mPresets;
+        for(size_t k = 0; k < mParts.size(); ++k)
+        {
+            const std::vector<int>& unset = mComponents[k].unset;
+            for(size_t i = 0; i < unset.size(); ++i)
+            {
+                mSolution.placeAt(mParts[k]->getSolution().atIndex(unset[i]), unset[i]);
+            }
+        }
+    }
+
+    void clearParts()
+    {
+        for(size_t k = 0; k < mParts.size(); ++k)
+        {
+            delete mParts[k];
+        }
+        mParts.clear();
+    }
+
+    const GridD& mGrid;
+    Topology mTopology;
+    const Sequence& mSequence;
+    SearchOptions mOptions;
+    SearchOptions mPartOptions;
+    Values mPresets;
+    Values mSolution;
+    bool mStarted;
+    bool mFeasible;
+    bool mFilling;
+
+    // Only used when the board is in one piece.
+    std::auto_ptr< SolveEngine<Dimensions> > mWhole;
+
+    std::vector<int> mComponentOf;
+    std::vector<Component> mComponents;
+    SymbolUsage mRemaining;
+
+    // The symbols chosen for each part but the last, and what
+    // the parts before each one use between them.
+    std::vector<UsageCounts::const_iterator> mChoice;
+    std::vector<SymbolUsage> mUsedBefore;
+    std::vector<Part*> mParts;
+};
+
+#endif // SOLVER_COMPONENTSOLVER_H__INCLUDED
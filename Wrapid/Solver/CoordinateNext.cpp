@@ -47,6 +47,7 @@ namespace
             do
             {
                 assert(count == (int)order(current));
+                CHECK(order.coordinate(count) == current);
                 ++count;
                 current = Solver::next(current, size);
             } while(current != size);
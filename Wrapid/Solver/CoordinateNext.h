@@ -95,6 +95,19 @@ namespace Solver
             return operator()(c) < operator()(d);
         }
 
+        // Recover the coordinate with the specified hash, so linear arrays
+        // indexed by this ordering can be walked back into the volume.
+        Coord coordinate(size_t index) const
+        {
+            Coord c;
+            for(int d = Dimensions - 1; d >= 0; --d)
+            {
+                c[d] = (int)(index / mStride[d]);
+                index -= c[d] * mStride[d];
+            }
+            return c;
+        }
+
         int stride(int dimension) const
         {
             return mStride[dimension];
@@ -0,0 +1,170 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/CutSolver.h"
+
+#ifdef BUILD_TESTS
+
+#include "Solver/SolverTest.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace Solver;
+
+namespace
+{
+    class CutSolverTest : public Solver::SolverTest
+    {
+    public:
+        void run()
+        {
+            RUN( tunnelTest );
+            RUN( spareSymbolsTest );
+            RUN( wallTest );
+            RUN( noSolutionTest );
+            RUN( uncutTest );
+            RUN( allCutTest );
+        }
+
+        // Three levels of four, with a tunnel from each to the next.
+        static void buildLevels(Grid<3>& grid)
+        {
+            grid.blockAll(2);
+            grid.setWall(coord(0, 0, 0), coord(0, 0, 1), false);
+            grid.setWall(coord(1, 1, 1), coord(1, 1, 2), false);
+        }
+
+        void tunnelTest()
+        {
+            Grid<3> grid(coord(2, 2, 3));
+            buildLevels(grid);
+            Sequence symbols(4, 3);
+            GridValues<3> presets(grid.getSize());
+            presets.place(1, coord(1, 0, 0));
+
+            // A level at the end is cut off by its one tunnel.
+            CutSolver<3> cut(grid, symbols, SearchOptions());
+            cut.addPresets(presets);
+            SolutionCount count = cut.countSolutions(0);
+            CHECK(cut.isCut());
+            CHECK(cut.cutCellCount() == 2);
+            CHECK(count > 0);
+
+            checkSameSolutionSet<CutSolver>(grid, symbols, presets, 0);
+            checkSameSolutionSet<CutSolver>(grid, symbols, presets, kArcConsistency | kCardinality);
+            checkSameSolutionSet<CutSolver>(grid, symbols, presets, kSmallestDomainFirst | kBreakSymmetry);
+            checkSameSolutionSet<CutSolver>(grid, symbols, GridValues<3>(grid.getSize()), kForwardChecking);
+
+            CutSolver<3> limited(grid, symbols, SearchOptions());
+            limited.addPresets(presets);
+            CHECK(limited.countSolutions(10) == 10);
+        }
+
+        void spareSymbolsTest()
+        {
+            // More symbols than cells, so the sides don't have
+            // to use up everything between them.
+            Grid<3> grid(coord(2, 2, 3));
+            buildLevels(grid);
+            Sequence symbols(4, 4);
+            GridValues<3> presets(grid.getSize());
+            presets.place(2, coord(1, 0, 1));
+            checkSameSolutionSet<CutSolver>(grid, symbols, presets, 0);
+        }
+
+        void wallTest()
+        {
+            // A wall right across the middle, with one gap in it.
+            Grid2D grid(coord(4, 6));
+            grid.unwrap(0);
+            grid.unwrap(1);
+            for(int column = 1; column < 6; ++column)
+            {
+                grid.setWall(coord(1, column), coord(2, column), true);
+            }
+            GridValues2D presets(grid.getSize());
+            presets.place(12, coord(0, 0));
+            presets.place(6, coord(3, 5));
+            Sequence symbols(12, 2);
+
+            CutSolver<2> cut(grid, symbols, SearchOptions());
+            cut.addPresets(presets);
+            cut.countSolutions(0);
+            CHECK(cut.isCut());
+            CHECK(cut.cutCellCount() == 2);
+            checkSameSolutionSet<CutSolver>(grid, symbols, presets, kForwardChecking);
+        }
+
+        void noSolutionTest()
+        {
+            Grid<3> grid(coord(2, 2, 3));
+            buildLevels(grid);
+            Sequence symbols(4, 3);
+
+            // More threes than the sequence has.
+            GridValues<3> overused(grid.getSize());
+            overused.place(3, coord(0, 0, 0));
+            overused.place(3, coord(1, 1, 0));
+            overused.place(3, coord(0, 1, 1));
+            overused.place(3, coord(1, 0, 2));
+            CutSolver<3> counter(grid, symbols, SearchOptions());
+            counter.addPresets(overused);
+            CHECK(counter.countSolutions(0) == 0);
+            CutSolver<3> solver(grid, symbols, SearchOptions());
+            solver.addPresets(overused);
+            CHECK(solver.nextSolution() == kNoSolution);
+
+            // Presets around a tunnel that leave no way through.
+            GridValues<3> clash(grid.getSize());
+            clash.place(1, coord(1, 1, 1));
+            clash.place(3, coord(0, 0, 2));
+            clash.place(3, coord(1, 0, 2));
+            clash.place(3, coord(0, 1, 2));
+            checkSameSolutionSet<CutSolver>(grid, symbols, clash, 0);
+        }
+
+        void uncutTest()
+        {
+            // An open torus can't be cut cheaply, so it is searched.
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            presets.place(1, coord(0, 0));
+            presets.place(7, coord(2, 3));
+            Sequence symbols(12, 2);
+
+            CutSolver<2> whole(grid, symbols, SearchOptions(kForwardChecking));
+            whole.addPresets(presets);
+            GridSolver<2> plain(grid, symbols);
+            plain.addPresets(presets);
+            CHECK(whole.countSolutions(0) == plain.countSolutions(0));
+            CHECK(!whole.isCut());
+        }
+
+        void allCutTest()
+        {
+            // Boards so small that every unset cell on a side is a cut
+            // cell, so the cut values fill that side in by themselves.
+            // Here the side is an end row of the strip.
+            Grid2D strip(coord(3, 2));
+            strip.unwrap(0);
+            GridValues2D none(strip.getSize());
+            Sequence threes(3, 3);
+            CutSolver<2> cut(strip, threes, SearchOptions());
+            cut.countSolutions(0);
+            CHECK(cut.isCut());
+            CHECK(cut.cutCellCount() == 4);
+            CHECK(checkSameSolutionSet<CutSolver>(strip, threes, none, 0) == 54);
+
+            Grid2D torus(coord(2, 2));
+            Sequence fives(5, 2);
+            CHECK(checkSameSolutionSet<CutSolver>(torus, fives, GridValues2D(torus.getSize()), 0) == 30);
+        }
+    };
+}
+
+DECLARE_TEST( CutSolverTest );
+
+#endif // BUILD_TESTS
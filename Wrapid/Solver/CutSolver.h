@@ -0,0 +1,633 @@
+#pragma once
+#ifndef SOLVER_CUTSOLVER_H__INCLUDED
+#define SOLVER_CUTSOLVER_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridSolver.h"
+#include "Solver/ParallelSolver.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/SymbolUsage.h"
+#include "Solver/Topology.h"
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class CutSolver;
+}
+
+// Solves a board that a few open walls are enough to cut in two, such
+// as the levels of the card puzzles, which are only joined by their
+// tunnels. Each side is searched by itself for all of the ways of
+// filling it in, with the other side's unset cells out of the way, and
+// those are kept by the values they put in the cut cells (the unset cells
+// with an unset neighbour across the cut) and the symbols they use. A way
+// of filling in one side then goes with a way of filling in the other if
+// their cut cells can sit next to each other and the symbols they use
+// fit in what the presets leave. That costs about as much as searching
+// the two sides, rather than searching them in combination.
+//
+// The cut is the one with the fewest cut cells that takes a slice out of
+// the board along one dimension, so a level, or a run of them, from the
+// rest. Wrapping round counts, so the slice can be from the middle of a
+// dimension. If no slice has few enough cut cells and enough cells on
+// each side, or a side has too many ways of being filled in, the board
+// is handed to a GridSolver (or a ParallelSolver) with the same options.
+//
+// To count, the ways of filling in the sides are joined up. To step
+// through the solutions, each match of cut values and symbols is taken
+// in turn, and both sides are searched again with those cut values and
+// exactly those symbols, stepping through them like an odometer.
+template <int Dimensions>
+class Solver::CutSolver : public Solver::SolveEngine<Dimensions>
+{
+    PREVENT_COPY_AND_ASSIGNMENT(CutSolver);
+public:
+    typedef Grid<Dimensions> GridD;
+    typedef GridValues<Dimensions> Values;
+
+    enum
+    {
+        // The most cut cells a cut may have.
+        kMaxCutCells = 8,
+
+        // Give up on the cut if a side has more ways of being filled in.
+        kMaxSideSolutions = 1 << 18
+    };
+
+    CutSolver(const GridD& grid, const Sequence& sequence, SearchOptions options)
+        : mGrid(grid)
+        , mTopology(grid)
+        , mSequence(sequence)
+        , mOptions(options)
+        , mSideOptions(options.flags & ~kSideIgnoredFlags)
+        , mPresets(grid.getSize())
+        , mSolution(grid.getSize())
+        , mStarted(false)
+        , mMatch(-1)
+    {
+    }
+
+    ~CutSolver()
+    {
+    }
+
+    void addPresets(const Values& values)
+    {
+        assert(!mStarted);
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
+        {
+            mPresets.place(it->second, it->first);
+        }
+    }
+
+    SolveResult nextSolution()
+    {
+        if(mPresets.valueCount() == mTopology.cellCount())
+        {
+            mSolution = mPresets;
+            return kAlreadySolved;
+        }
+        if(!mStarted)
+        {
+            start();
+        }
+        if(mWhole.get() != NULLPTR)
+        {
+            return mWhole->nextSolution();
+        }
+        if(mMatch >= 0 && nextFill())
+        {
+            return kFoundSolution;
+        }
+        while(nextMatch())
+        {
+            if(startFill())
+            {
+                return kFoundSolution;
+            }
+        }
+        return kNoSolution;
+    }
+
+    SolutionCount countSolutions(SolutionCount limit = 0)
+    {
+        if(mPresets.valueCount() == mTopology.cellCount())
+        {
+            return 1;
+        }
+        if(!mStarted)
+        {
+            start();
+        }
+        if(mWhole.get() != NULLPTR)
+        {
+            return mWhole->countSolutions(limit);
+        }
+
+        SolutionCount count = 0;
+        UsageCounts joined;
+        for(size_t i = 0; i < mPairs.size(); ++i)
+        {
+            const UsageCounts& first = mPairs[i].first->second;
+            const UsageCounts& second = mPairs[i].second->second;
+            if(mExact)
+            {
+                // Every symbol left has to be used, so each way of filling in
+                // the first side only goes with the ones that use the rest.
+                UsageCounts::const_iterator end = first.end();
+                for(UsageCounts::const_iterator it = first.begin(); it != end; ++it)
+                {
+                    UsageCounts::const_iterator found = second.find(leftOver(mRemaining, it->first));
+                    if(found != second.end())
+                    {
+                        count += it->second * found->second;
+                    }
+                }
+            }
+            else
+            {
+                joinUsage(first, second, mRemaining, joined);
+                count += totalCount(joined);
+            }
+            if(limit != 0 && count >= limit)
+            {
+                return limit;
+            }
+        }
+        return count;
+    }
+
+    const Values& getSolution() const
+    {
+        return mWhole.get() != NULLPTR ? mWhole->getSolution() : mSolution;
+    }
+
+    // Whether the board was cut, once the search has started, and
+    // how many cut cells there are on the two sides between them.
+    bool isCut() const
+    {
+        return mStarted && mWhole.get() == NULLPTR;
+    }
+
+    int cutCellCount() const
+    {
+        return (int)(mSides[0].cut.size() + mSides[1].cut.size());
+    }
+
+private:
+    enum
+    {
+        // Every solution of each side is needed, each being
+        // searched by itself, so these don't apply.
+        kSideIgnoredFlags = kFirstSolutionOnly | kBreakSymmetry | kExpandSymmetry | kBreakValueSymmetry
+    };
+
+    // The values a way of filling in a side puts in its cut cells, and
+    // the ways of filling it in, by those and the symbols they use.
+    typedef std::vector<Symbol> CutValues;
+    typedef std::map<CutValues, UsageCounts> CutTable;
+    typedef std::pair<typename CutTable::const_iterator, typename CutTable::const_iterator> CutPair;
+
+    struct Side
+    {
+        std::vector<int> unset;
+        std::vector<int> cut;
+        CutTable ways;
+    };
+
+    // An unset cell next to an unset cell on the other side, as
+    // indexes into the cut cells of the two sides.
+    typedef std::pair<int, int> CutEdge;
+
+    // One side being searched by itself, with the unset cells on the other
+    // side set to a filler symbol that can sit next to anything. There is
+    // exactly enough of the filler for them, so none goes on this side.
+    class Half
+    {
+        PREVENT_COPY_AND_ASSIGNMENT(Half);
+    public:
+        Half(const CutSolver& owner, int side, const CutValues& cut, const SymbolUsage& limits)
+            : mFiller(makeRegionSequence(
+                owner.mSequence,
+                limits,
+                (int)owner.mSides[1 - side].unset.size(),
+                mSequence
+            ))
+            , mSolver(owner.mGrid, mSequence, owner.mSideOptions)
+            , mDone(false)
+        {
+            Values presets(owner.mPresets);
+            const std::vector<int>& other = owner.mSides[1 - side].unset;
+            for(size_t i = 0; i < other.size(); ++i)
+            {
+                presets.placeAt(mFiller, other[i]);
+            }
+            const std::vector<int>& cutCells = owner.mSides[side].cut;
+            for(size_t i = 0; i < cut.size(); ++i)
+            {
+                presets.placeAt(cut[i], cutCells[i]);
+            }
+            mSolver.addPresets(presets);
+        }
+
+        // When every unset cell on the side is a cut cell, the cut values
+        // fill it in, and that is the one way there is.
+        bool next()
+        {
+            if(mDone)
+            {
+                return false;
+            }
+            SolveResult result = mSolver.nextSolution();
+            mDone = result == kAlreadySolved;
+            return result == kFoundSolution || result == kAlreadySolved;
+        }
+
+        const Values& getSolution() const
+        {
+            return mSolver.getSolution();
+        }
+
+    private:
+        Sequence mSequence;
+        Symbol mFiller;
+        GridSolver<Dimensions> mSolver;
+        bool mDone;
+    };
+    friend class Half;
+
+    void start()
+    {
+        mStarted = true;
+        int range = highestSymbol(mSequence.getSymbolMask()) + 1;
+        mRemaining.assign(range, 0);
+        mLimits.assign(range, 0);
+        int remaining = 0;
+        bool feasible = true;
+        for(Symbol s = Solver::kFirstSymbol; s < range; ++s)
+        {
+            if(hasSymbol(mSequence.getSymbolMask(), s))
+            {
+                mLimits[s] = mSequence.count(s);
+                mRemaining[s] = mLimits[s] - mPresets.symbolCount(s);
+                feasible = feasible && mRemaining[s] >= 0;
+                remaining += mRemaining[s];
+            }
+        }
+        mExact = remaining == mTopology.cellCount() - mPresets.valueCount();
+
+        if(!feasible)
+        {
+            // Nothing can match, so there is nothing to do.
+            return;
+        }
+        if(!findCut() || !fillSide(0) || !fillSide(1))
+        {
+            if(mOptions.isParallel())
+            {
+                mWhole = std::auto_ptr< SolveEngine<Dimensions> >(
+                    new ParallelSolver<Dimensions>(mGrid, mSequence, mOptions)
+                );
+            }
+            else
+            {
+                mWhole = std::auto_ptr< SolveEngine<Dimensions> >(
+                    new GridSolver<Dimensions>(mGrid, mSequence, mOptions)
+                );
+            }
+            mWhole->addPresets(mPresets);
+            return;
+        }
+        findPairs();
+    }
+
+    // Try every slice along every dimension, and keep the one with the
+    // fewest cut cells, or the most even one out of those. Neither side
+    // may have less than a quarter of the unset cells.
+    bool findCut()
+    {
+        CoordinateOrder<Dimensions> order(mGrid.getSize());
+        int cellCount = mTopology.cellCount();
+        int unsetCount = cellCount - mPresets.valueCount();
+        int bestCut = -1;
+        int bestSmaller = 0;
+        std::vector<bool> inside(cellCount);
+        for(int d = 0; d < Dimensions; ++d)
+        {
+            int size = mGrid.getSize()[d];
+            for(int from = 0; from < size; ++from)
+            {
+                for(int length = 1; length < size; ++length)
+                {
+                    int smaller = 0;
+                    for(int cell = 0; cell < cellCount; ++cell)
+                    {
+                        int layer = order.coordinate(cell)[d];
+                        inside[cell] = (layer - from + size) % size < length;
+                        if(inside[cell] && mPresets.atIndex(cell) == Solver::kUnsetSymbol)
+                        {
+                            ++smaller;
+                        }
+                    }
+                    smaller = std::min(smaller, unsetCount - smaller);
+                    if(smaller * 4 < unsetCount)
+                    {
+                        continue;
+                    }
+                    int cut = countCut(inside);
+                    if(cut > kMaxCutCells)
+                    {
+                        continue;
+                    }
+                    if(bestCut < 0 || cut < bestCut || (cut == bestCut && smaller > bestSmaller))
+                    {
+                        bestCut = cut;
+                        bestSmaller = smaller;
+                        mInside = inside;
+                    }
+                }
+            }
+        }
+        if(bestCut < 0)
+        {
+            return false;
+        }
+
+        // Sort out the sides and their cut cells.
+        for(int cell = 0; cell < cellCount; ++cell)
+        {
+            if(mPresets.atIndex(cell) == Solver::kUnsetSymbol)
+            {
+                Side& side = mSides[mInside[cell] ? 0 : 1];
+                side.unset.push_back(cell);
+                if(isCutCell(mInside, cell))
+                {
+                    side.cut.push_back(cell);
+                }
+            }
+        }
+        const std::vector<int>& first = mSides[0].cut;
+        const std::vector<int>& second = mSides[1].cut;
+        for(size_t i = 0; i < first.size(); ++i)
+        {
+            for(size_t j = 0; j < second.size(); ++j)
+            {
+                if(mTopology.isAdjacent(first[i], second[j]))
+                {
+                    mCutEdges.push_back(CutEdge((int)i, (int)j));
+                }
+            }
+        }
+        return true;
+    }
+
+    bool isCutCell(const std::vector<bool>& inside, int cell) const
+    {
+        Topology::const_iterator end = mTopology.end(cell);
+        for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+        {
+            if(inside[*n] != inside[cell] && mPresets.atIndex(*n) == Solver::kUnsetSymbol)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The unset cells with an unset neighbour on the other side.
+    int countCut(const std::vector<bool>& inside) const
+    {
+        int cut = 0;
+        for(int cell = 0; cell < mTopology.cellCount(); ++cell)
+        {
+            if(mPresets.atIndex(cell) == Solver::kUnsetSymbol && isCutCell(inside, cell))
+            {
+                ++cut;
+            }
+        }
+        return cut;
+    }
+
+    // Search the side for every way of filling it in. Returns false
+    // if there are too many.
+    bool fillSide(int index)
+    {
+        Side& side = mSides[index];
+        Half half(*this, index, CutValues(), mLimits);
+        CutValues cut(side.cut.size());
+        SymbolUsage usage;
+        int found = 0;
+        while(half.next())
+        {
+            if(++found > kMaxSideSolutions)
+            {
+                return false;
+            }
+            const Values& solution = half.getSolution();
+            for(size_t i = 0; i < side.cut.size(); ++i)
+            {
+                cut[i] = solution.atIndex(side.cut[i]);
+            }
+            usage.assign(mRemaining.size(), 0);
+            for(size_t i = 0; i < side.unset.size(); ++i)
+            {
+                ++usage[solution.atIndex(side.unset[i])];
+            }
+            ++side.ways[cut][usage];
+        }
+        return true;
+    }
+
+    // The cut values of the two sides that can sit next to each other.
+    void findPairs()
+    {
+        const CutTable& first = mSides[0].ways;
+        const CutTable& second = mSides[1].ways;
+        typename CutTable::const_iterator firstEnd = first.end();
+        typename CutTable::const_iterator secondEnd = second.end();
+        for(typename CutTable::const_iterator a = first.begin(); a != firstEnd; ++a)
+        {
+            for(typename CutTable::const_iterator b = second.begin(); b != secondEnd; ++b)
+            {
+                if(isCompatible(a->first, b->first))
+                {
+                    mPairs.push_back(CutPair(a, b));
+                }
+            }
+        }
+    }
+
+    bool isCompatible(const CutValues& first, const CutValues& second) const
+    {
+        for(size_t i = 0; i < mCutEdges.size(); ++i)
+        {
+            Symbol a = first[mCutEdges[i].first];
+            Symbol b = second[mCutEdges[i].second];
+            if(!hasSymbol(mSequence.getAdjacentMask(a), b))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool fits(const SymbolUsage& first, const SymbolUsage& second) const
+    {
+        for(size_t s = 0; s < mRemaining.size(); ++s)
+        {
+            if(first[s] + second[s] > mRemaining[s])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Step on to the next pair of ways of filling in the sides, by their
+    // cut values and symbols, that go together. The second side's symbols
+    // turn fastest.
+    bool nextMatch()
+    {
+        if(mMatch < 0)
+        {
+            mMatch = 0;
+            if(!mPairs.empty())
+            {
+                mFirstUsage = mPairs[0].first->second.begin();
+                mSecondUsage = mPairs[0].second->second.begin();
+            }
+        }
+        else
+        {
+            ++mSecondUsage;
+        }
+        while(mMatch < (int)mPairs.size())
+        {
+            const UsageCounts& first = mPairs[mMatch].first->second;
+            const UsageCounts& second = mPairs[mMatch].second->second;
+            if(mSecondUsage == second.end())
+            {
+                ++mFirstUsage;
+                mSecondUsage = second.begin();
+            }
+            if(mFirstUsage == first.end())
+            {
+                if(++mMatch < (int)mPairs.size())
+                {
+                    mFirstUsage = mPairs[mMatch].first->second.begin();
+                    mSecondUsage = mPairs[mMatch].second->second.begin();
+                }
+                continue;
+            }
+            if(fits(mFirstUsage->first, mSecondUsage->first))
+            {
+                return true;
+            }
+            ++mSecondUsage;
+        }
+        return false;
+    }
+
+    // The symbols a side may use are the presets and exactly those chosen.
+    SymbolUsage limitsFor(const SymbolUsage& usage) const
+    {
+        SymbolUsage limits(usage);
+        for(size_t s = 0; s < limits.size(); ++s)
+        {
+            limits[s] += mLimits[s] - mRemaining[s];
+        }
+        return limits;
+    }
+
+    // Each match came from a solution of each side, so there is
+    // always at least one with the cut values and symbols.
+    bool startFill()
+    {
+        if(!startHalf(0))
+        {
+            return false;
+        }
+        startHalf(1);
+        compose();
+        return true;
+    }
+
+    bool startHalf(int side)
+    {
+        const CutValues& cut = side == 0 ? mPairs[mMatch].first->first : mPairs[mMatch].second->first;
+        const SymbolUsage& usage = side == 0 ? mFirstUsage->first : mSecondUsage->first;
+        mHalves[side].reset(new Half(*this, side, cut, limitsFor(usage)));
+        return mHalves[side]->next();
+    }
+
+    // The second side turns fastest.
+    bool nextFill()
+    {
+        if(mHalves[1]->next())
+        {
+            compose();
+            return true;
+        }
+        if(mHalves[0]->next())
+        {
+            startHalf(1);
+            compose();
+            return true;
+        }
+        return false;
+    }
+
+    void compose()
+    {
+        mSolution = mPresets;
+        for(int k = 0; k < 2; ++k)
+        {
+            const Side& side = mSides[k];
+            const Values& values = mHalves[k]->getSolution();
+            for(size_t i = 0; i < side.unset.size(); ++i)
+            {
+                mSolution.placeAt(values.atIndex(side.unset[i]), side.unset[i]);
+            }
+        }
+    }
+
+    const GridD& mGrid;
+    Topology mTopology;
+    const Sequence& mSequence;
+    SearchOptions mOptions;
+    SearchOptions mSideOptions;
+    Values mPresets;
+    Values mSolution;
+    bool mStarted;
+
+    // Only used when the board isn't cut.
+    std::auto_ptr< SolveEngine<Dimensions> > mWhole;
+
+    // How many of each symbol there are, what the presets leave of them,
+    // and whether the unset cells need every one of those.
+    SymbolUsage mLimits;
+    SymbolUsage mRemaining;
+    bool mExact;
+
+    std::vector<bool> mInside;
+    Side mSides[2];
+    std::vector<CutEdge> mCutEdges;
+    std::vector<CutPair> mPairs;
+
+    // The match being stepped through, and the sides with it.
+    int mMatch;
+    UsageCounts::const_iterator mFirstUsage;
+    UsageCounts::const_iterator mSecondUsage;
+    std::auto_ptr<Half> mHalves[2];
+};
+
+#endif // SOLVER_CUTSOLVER_H__INCLUDED
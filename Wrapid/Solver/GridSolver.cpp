@@ -7,13 +7,17 @@
 
 #ifdef BUILD_TESTS
 
-#include "Test.h"
+#include "Solver/SolverTest.h"
+#include "Solver/ValueSymmetry.h"
+
+#include <vector>
+#include <algorithm>
 
 using namespace Solver;
 
 namespace
 {
-    class GridSolverTest : public UnitTest::Framework
+    class GridSolverTest : public Solver::SolverTest
     {
     public:
         void run()
@@ -21,29 +25,59 @@ namespace
             RUN( solve2DTest );
             RUN( challengeTest );
             RUN( solve3DTest );
+            RUN( forwardCheckingTest );
+            RUN( smallestDomainTest );
+            RUN( arcConsistencyTest );
+            RUN( shareWorkTest );
+            RUN( countTest );
+            RUN( symmetryTest );
+            RUN( valueSymmetryTest );
+            RUN( backjumpingTest );
+            RUN( undoTest );
+            RUN( cardinalityTest );
+            RUN( distanceTest );
+            RUN( neighbourCapacityTest );
+            RUN( chainTest );
+            RUN( islandTest );
+            RUN( restartTest );
+            RUN( presetClashTest );
+        }
+
+        // Run the solver with and without the specified options and
+        // check that the solutions come out the same.
+        void checkSameSolutions(
+            const Grid2D& grid,
+            const Sequence& symbols,
+            const GridValues<2>& presets,
+            Solver::SearchOptions options,
+            int expectedCount
+        )
+        {
+            GridSolver<2> plain(grid, symbols);
+            plain.addPresets(presets);
+            GridSolver<2> solver(grid, symbols, options);
+            solver.addPresets(presets);
+
+            int count = 0;
+            for(;;)
+            {
+                Solver::SolveResult expected = plain.nextSolution();
+                CHECK_ASSERT(solver.nextSolution() == expected);
+                if(expected != Solver::kFoundSolution)
+                {
+                    break;
+                }
+                CHECK(Solver::isMatch(plain.getSolution(), solver.getSolution()));
+                ++count;
+            }
+            CHECK(count == expectedCount);
         }
 
         void solve2DTest()
         {
             Coordinate2D size = coord(4, 6);
             Grid2D grid(size);
-            grid.unwrap(0);
-            grid.unwrap(1);
-
-            grid.setWall(coord(0, 1), coord(1, 1), true);
-            grid.setWall(coord(0, 4), coord(1, 4), true);
-            grid.setWall(coord(1, 0), coord(2, 0), true);
-            grid.setWall(coord(1, 3), coord(2, 3), true);
-            grid.setWall(coord(2, 1), coord(3, 1), true);
-            grid.setWall(coord(2, 4), coord(3, 4), true);
-            
-            grid.setWall(coord(0, 2), coord(0, 3), true);
-            grid.setWall(coord(1, 1), coord(1, 2), true);
-            grid.setWall(coord(1, 4), coord(1, 5), true);
-            grid.setWall(coord(2, 1), coord(2, 2), true);
-            grid.setWall(coord(2, 2), coord(2, 3), true);
-            grid.setWall(coord(2, 4), coord(2, 5), true);
-            grid.setWall(coord(3, 2), coord(3, 3), true);
+            buildSolve2DGrid(grid);
 
             Sequence symbols(12, 2);
             GridSolver<2> solver(grid, symbols);
@@ -77,24 +111,7 @@ namespace
         {
             Coordinate2D size = coord(4, 6);
             Grid2D grid(size);
-            grid.unwrap(0);
-            grid.unwrap(1);
-
-            grid.setWall(coord(0, 2), coord(1, 2), true);
-            grid.setWall(coord(0, 4), coord(1, 4), true);
-            grid.setWall(coord(1, 4), coord(2, 4), true);
-            grid.setWall(coord(1, 5), coord(2, 5), true);
-            grid.setWall(coord(2, 0), coord(3, 0), true);
-            grid.setWall(coord(2, 2), coord(3, 2), true);
-            grid.setWall(coord(2, 3), coord(3, 3), true);
-            grid.setWall(coord(2, 4), coord(3, 4), true);
-
-            grid.setWall(coord(0, 0), coord(0, 1), true);
-            grid.setWall(coord(0, 3), coord(0, 4), true);
-            grid.setWall(coord(1, 0), coord(1, 1), true);
-            grid.setWall(coord(1, 1), coord(1, 2), true);
-            grid.setWall(coord(1, 2), coord(1, 3), true);
-            grid.setWall(coord(2, 1), coord(2, 2), true);
+            buildChallengeGrid(grid);
 
             Sequence symbols(12, 2);
             GridSolver<2> solver(grid, symbols);
@@ -144,6 +161,739 @@ namespace
         void solve3DTest()
         {
         }
+
+        void forwardCheckingTest()
+        {
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 9, coord(3, 0));
+            presets.place( 7, coord(0, 5));
+            presets.place( 2, coord(3, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kForwardChecking, 2);
+
+            // With fewer presets there are more solutions to compare.
+            presets.clear(coord(3, 0));
+            presets.clear(coord(3, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kForwardChecking, 6);
+
+            // Presets which can't be completed are caught before any search.
+            Grid2D open(size);
+            GridValues<2> impossible(size);
+            impossible.place(1, coord(0, 0));
+            impossible.place(6, coord(0, 2));
+            impossible.place(1, coord(2, 1));
+            impossible.place(6, coord(1, 1));
+            GridSolver<2> solver(open, symbols, Solver::kForwardChecking);
+            solver.addPresets(impossible);
+            CHECK(solver.nextSolution() == Solver::kNoSolution);
+        }
+
+        void smallestDomainTest()
+        {
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 9, coord(3, 0));
+            presets.place( 7, coord(0, 5));
+            presets.place( 2, coord(3, 5));
+            CHECK(checkSameSolutionSet<GridSolver>(grid, symbols, presets, Solver::kSmallestDomainFirst) == 2);
+
+            presets.clear(coord(3, 0));
+            presets.clear(coord(3, 5));
+            CHECK(checkSameSolutionSet<GridSolver>(grid, symbols, presets, Solver::kSmallestDomainFirst) == 6);
+
+            Grid2D solveGrid(size);
+            buildSolve2DGrid(solveGrid);
+            GridValues<2> solvePresets(size);
+            solvePresets.place(10, coord(0, 0));
+            CHECK(checkSameSolutionSet<GridSolver>(solveGrid, symbols, solvePresets, Solver::kSmallestDomainFirst) == 16);
+        }
+
+        void arcConsistencyTest()
+        {
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 9, coord(3, 0));
+            presets.place( 7, coord(0, 5));
+            presets.place( 2, coord(3, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kArcConsistency, 2);
+
+            presets.clear(coord(3, 0));
+            presets.clear(coord(3, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kArcConsistency, 6);
+            CHECK(checkSameSolutionSet<GridSolver>(grid, symbols, presets, Solver::kArcConsistency | Solver::kSmallestDomainFirst) == 6);
+
+            Grid2D solveGrid(size);
+            buildSolve2DGrid(solveGrid);
+            GridValues<2> solvePresets(size);
+            solvePresets.place(10, coord(0, 0));
+            checkSameSolutions(solveGrid, symbols, solvePresets, Solver::kArcConsistency, 16);
+
+            // Two corridors, with presets at the ends of one that can't be
+            // joined because the path between them has the wrong parity.
+            // Forward checking only sees the cells next to the presets, but
+            // propagation rules it out before any search.
+            Coordinate2D corridorSize = coord(5, 2);
+            Grid2D corridor(corridorSize);
+            corridor.unwrap(0);
+            for(int x = 0; x < corridorSize[0]; ++x)
+            {
+                corridor.setWall(coord(x, 0), coord(x, 1), true);
+            }
+            Sequence ring(6, 2);
+            GridValues<2> ends(corridorSize);
+            ends.place(1, coord(0, 0));
+            ends.place(4, coord(4, 0));
+            GridSolver<2> solver(corridor, ring, Solver::kArcConsistency);
+            solver.addPresets(ends);
+            CHECK(solver.nextSolution() == Solver::kNoSolution);
+        }
+
+        // Asks for work every time it's checked, and keeps what it's given.
+        class GreedyMonitor : public SearchMonitor<2>
+        {
+        public:
+            bool shouldStop()
+            {
+                return false;
+            }
+
+            bool wantsWork()
+            {
+                return true;
+            }
+
+            void takeWork(const GridValues<2>& partial)
+            {
+                shared.push_back(partial);
+            }
+
+            std::vector< GridValues<2> > shared;
+        };
+
+        void shareWorkTest()
+        {
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+
+            Grid2D grid(size);
+            buildSolve2DGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(10, coord(0, 0));
+
+            Boards expected;
+            GridSolver<2> plain(grid, symbols);
+            plain.addPresets(presets);
+            while(plain.nextSolution() == Solver::kFoundSolution)
+            {
+                expected.push_back(asBoard(plain.getSolution()));
+            }
+
+            // Between them, the solver and the work it gave away
+            // should still find every solution exactly once.
+            GreedyMonitor monitor;
+            GridSolver<2> solver(grid, symbols);
+            solver.addPresets(presets);
+            solver.setMonitor(&monitor);
+            Boards found;
+            while(solver.nextSolution() == Solver::kFoundSolution)
+            {
+                found.push_back(asBoard(solver.getSolution()));
+            }
+            CHECK(!monitor.shared.empty());
+            for(size_t i = 0; i < monitor.shared.size(); ++i)
+            {
+                GridSolver<2> part(grid, symbols);
+                part.addPresets(monitor.shared[i]);
+                Solver::SolveResult result = part.nextSolution();
+                if(result == Solver::kAlreadySolved)
+                {
+                    found.push_back(asBoard(part.getSolution()));
+                }
+                while(result == Solver::kFoundSolution)
+                {
+                    found.push_back(asBoard(part.getSolution()));
+                    result = part.nextSolution();
+                }
+            }
+
+            std::sort(expected.begin(), expected.end());
+            std::sort(found.begin(), found.end());
+            CHECK(found.size() == 16);
+            CHECK(found == expected);
+        }
+
+        Solver::SolutionCount countSolutions(
+            const Grid2D& grid,
+            const Sequence& symbols,
+            const GridValues<2>& presets,
+            Solver::SearchOptions options,
+            Solver::SolutionCount limit
+        )
+        {
+            GridSolver<2> solver(grid, symbols, options);
+            solver.addPresets(presets);
+            return solver.countSolutions(limit);
+        }
+
+        void countTest()
+        {
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+
+            Grid2D grid(size);
+            buildSolve2DGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(10, coord(0, 0));
+
+            const int flags[] = { 0, Solver::kForwardChecking, Solver::kSmallestDomainFirst, Solver::kArcConsistency };
+            for(int i = 0; i < 4; ++i)
+            {
+                CHECK(countSolutions(grid, symbols, presets, flags[i], 0) == 16);
+                CHECK(countSolutions(grid, symbols, presets, flags[i], 2) == 2);
+                CHECK(countSolutions(grid, symbols, presets, flags[i], 100) == 16);
+            }
+
+            // A solved grid is a single solution.
+            GridSolver<2> solver(grid, symbols);
+            solver.addPresets(presets);
+            CHECK_ASSERT(solver.nextSolution() == Solver::kFoundSolution);
+            CHECK(countSolutions(grid, symbols, solver.getSolution(), 0, 0) == 1);
+
+            Grid2D challenge(size);
+            buildChallengeGrid(challenge);
+            GridValues<2> challengePresets(size);
+            challengePresets.place(12, coord(0, 0));
+            challengePresets.place( 7, coord(0, 5));
+            CHECK(countSolutions(challenge, symbols, challengePresets, 0, 0) == 6);
+        }
+
+        void symmetryTest()
+        {
+            // A band round a torus, with four symbols used three times
+            // each, has 800 solutions which fall into 38 sets.
+            Coordinate2D size = coord(6, 2);
+            Grid2D band(size);
+            Sequence symbols(4, 3);
+            GridValues<2> presets(size);
+
+            CHECK(countSolutions(band, symbols, presets, 0, 0) == 800);
+            CHECK(countSolutions(band, symbols, presets, Solver::kBreakSymmetry, 0) == 38);
+            CHECK(countSolutions(band, symbols, presets, Solver::kBreakSymmetry | Solver::kArcConsistency, 0) == 38);
+            CHECK(countSolutions(band, symbols, presets, Solver::kExpandSymmetry, 0) == 800);
+            CHECK(checkSameSolutionSet<GridSolver>(band, symbols, presets, Solver::kExpandSymmetry) == 800);
+
+            // A preset leaves fewer symmetries, but expanding still
+            // gets back to the same solutions.
+            presets.place(2, coord(0, 0));
+            CHECK(checkSameSolutionSet<GridSolver>(band, symbols, presets, Solver::kExpandSymmetry | Solver::kSmallestDomainFirst) == 200);
+            CHECK(countSolutions(band, symbols, presets, Solver::kBreakSymmetry, 0) < 200);
+        }
+
+        // Every solution should be a relabelling of exactly one of those
+        // found when breaking value symmetry, keeping the presets.
+        void checkValueImages(
+            const Grid2D& grid,
+            const Sequence& symbols,
+            const GridValues<2>& presets,
+            Solver::SearchOptions options
+        )
+        {
+            Boards expected = searchAll(grid, symbols, presets);
+            Boards found = searchAll(grid, symbols, presets, options);
+            CHECK(found.size() < expected.size());
+
+            ValueSymmetry symmetry(symbols);
+            Boards images(found);
+            for(size_t f = 0; f < found.size(); ++f)
+            {
+                for(int i = 0; i < symmetry.size(); ++i)
+                {
+                    Board image(found[f]);
+                    for(size_t c = 0; c < image.size(); ++c)
+                    {
+                        image[c] = symmetry.apply(i, image[c]);
+                    }
+                    if(image != found[f] && keepsPresets(image, presets))
+                    {
+                        // Another found solution can't be an image.
+                        CHECK(!std::binary_search(found.begin(), found.end(), image));
+                        images.push_back(image);
+                    }
+                }
+            }
+            std::sort(images.begin(), images.end());
+            images.erase(std::unique(images.begin(), images.end()), images.end());
+            CHECK(images == expected);
+        }
+
+        static bool keepsPresets(const Board& board, const GridValues<2>& presets)
+        {
+            Board preset = asBoard(presets);
+            for(size_t c = 0; c < board.size(); ++c)
+            {
+                if(preset[c] != Solver::kUnsetSymbol && preset[c] != board[c])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void valueSymmetryTest()
+        {
+            // The four symbols go round a square, which can be turned
+            // and flipped over.
+            Coordinate2D size = coord(6, 2);
+            Grid2D band(size);
+            Sequence symbols(4, 3);
+            GridValues<2> presets(size);
+
+            checkValueImages(band, symbols, presets, Solver::kBreakValueSymmetry);
+            checkValueImages(band, symbols, presets, Solver::kBreakValueSymmetry | Solver::kArcConsistency | Solver::kSmallestDomainFirst);
+            CHECK(countSolutions(band, symbols, presets, Solver::kBreakValueSymmetry, 0) < 800 / 4);
+
+            // Presets can only be swapped with other presets, which is
+            // a relabelling the board can't have.
+            presets.place(2, coord(0, 0));
+            checkValueImages(band, symbols, presets, Solver::kBreakValueSymmetry);
+            presets.place(4, coord(2, 0));
+            checkValueImages(band, symbols, presets, Solver::kBreakValueSymmetry | Solver::kForwardChecking);
+
+            // Board symmetry takes over when both are asked for.
+            presets.clear(coord(0, 0));
+            presets.clear(coord(2, 0));
+            CHECK(countSolutions(band, symbols, presets, Solver::kBreakSymmetry | Solver::kBreakValueSymmetry, 0) == 38);
+        }
+
+        void backjumpingTest()
+        {
+            // Jumping back only skips dead ends, so the solutions
+            // come out in the same order.
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 9, coord(3, 0));
+            presets.place( 7, coord(0, 5));
+            presets.place( 2, coord(3, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kBackjumping, 2);
+
+            presets.clear(coord(3, 0));
+            presets.clear(coord(3, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kBackjumping, 6);
+            checkSameSolutions(grid, symbols, presets, Solver::kRecordNogoods, 6);
+            checkSameSolutions(grid, symbols, presets, Solver::kForwardChecking | Solver::kRecordNogoods, 6);
+            checkSameSolutions(grid, symbols, presets, Solver::kArcConsistency | Solver::kRecordNogoods, 6);
+            CHECK(checkSameSolutionSet<GridSolver>(grid, symbols, presets, Solver::kSmallestDomainFirst | Solver::kRecordNogoods) == 6);
+
+            Grid2D solveGrid(size);
+            buildSolve2DGrid(solveGrid);
+            GridValues<2> solvePresets(size);
+            solvePresets.place(10, coord(0, 0));
+            checkSameSolutions(solveGrid, symbols, solvePresets, Solver::kRecordNogoods, 16);
+            checkSameSolutions(solveGrid, symbols, solvePresets, Solver::kForwardChecking | Solver::kBackjumping, 16);
+
+            // Lots of solutions, and the symmetry options.
+            Coordinate2D bandSize = coord(6, 2);
+            Grid2D band(bandSize);
+            Sequence bandSymbols(4, 3);
+            GridValues<2> bandPresets(bandSize);
+            CHECK(countSolutions(band, bandSymbols, bandPresets, Solver::kRecordNogoods, 0) == 800);
+            CHECK(countSolutions(band, bandSymbols, bandPresets, Solver::kSmallestDomainFirst | Solver::kRecordNogoods, 0) == 800);
+            CHECK(countSolutions(band, bandSymbols, bandPresets, Solver::kBreakSymmetry | Solver::kRecordNogoods, 0) == 38);
+            CHECK(countSolutions(band, bandSymbols, bandPresets, Solver::kBreakValueSymmetry | Solver::kRecordNogoods, 0)
+                == countSolutions(band, bandSymbols, bandPresets, Solver::kBreakValueSymmetry, 0));
+
+            // Presets which can't be completed, where the cells in between
+            // have plenty of ways to fill them in before running into it.
+            Grid2D open(size);
+            GridValues<2> impossible(size);
+            impossible.place(1, coord(0, 0));
+            impossible.place(7, coord(3, 5));
+            impossible.place(1, coord(2, 2));
+            impossible.place(7, coord(1, 3));
+            int flags[] = { Solver::kBackjumping, Solver::kRecordNogoods, Solver::kArcConsistency | Solver::kRecordNogoods };
+            for(int i = 0; i < 3; ++i)
+            {
+                CHECK(countSolutions(open, symbols, impossible, flags[i], 0)
+                    == countSolutions(open, symbols, impossible, Solver::kForwardChecking, 0));
+            }
+        }
+
+        void undoTest()
+        {
+            // Once the search is over everything it did has been undone,
+            // leaving just the presets.
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 7, coord(0, 5));
+
+            int flags[] = {
+                0,
+                Solver::kForwardChecking,
+                Solver::kSmallestDomainFirst,
+                Solver::kArcConsistency | Solver::kRecordNogoods
+            };
+            for(int i = 0; i < 4; ++i)
+            {
+                GridSolver<2> solver(grid, symbols, SearchOptions(flags[i]));
+                solver.addPresets(presets);
+                while(solver.nextSolution() == Solver::kFoundSolution)
+                {
+                }
+                CHECK(asBoard(solver.getSolution()) == asBoard(presets));
+            }
+        }
+
+        void cardinalityTest()
+        {
+            // Filling in hidden singles only cuts dead ends, so the
+            // solutions come out in the same order.
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 7, coord(0, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kCardinality, 6);
+            checkSameSolutions(grid, symbols, presets, Solver::kArcConsistency | Solver::kCardinality, 6);
+            checkSameSolutions(grid, symbols, presets, Solver::kCardinality | Solver::kRecordNogoods, 6);
+            CHECK(checkSameSolutionSet<GridSolver>(grid, symbols, presets, Solver::kSmallestDomainFirst | Solver::kCardinality) == 6);
+
+            Grid2D solveGrid(size);
+            buildSolve2DGrid(solveGrid);
+            GridValues<2> solvePresets(size);
+            solvePresets.place(10, coord(0, 0));
+            checkSameSolutions(solveGrid, symbols, solvePresets, Solver::kCardinality, 16);
+
+            // With spare symbols the counts are only upper bounds.
+            Coordinate2D bandSize = coord(6, 2);
+            Grid2D band(bandSize);
+            GridValues<2> bandPresets(bandSize);
+            Sequence bandSymbols(4, 3);
+            CHECK(countSolutions(band, bandSymbols, bandPresets, Solver::kCardinality, 0) == 800);
+            Sequence spareSymbols(5, 3);
+            CHECK(countSolutions(band, spareSymbols, bandPresets, Solver::kCardinality, 0)
+                == countSolutions(band, spareSymbols, bandPresets, Solver::kForwardChecking, 0));
+
+            // Not enough symbols to go round is found before searching.
+            Sequence tooFew(3, 3);
+            GridSolver<2> solver(band, tooFew, SearchOptions(Solver::kCardinality));
+            CHECK(solver.nextSolution() == Solver::kNoSolution);
+        }
+
+        void distanceTest()
+        {
+            // The presets narrow the cells far from them as well as their
+            // neighbours, which mustn't lose any solutions.
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 9, coord(3, 0));
+            presets.place( 7, coord(0, 5));
+            presets.place( 2, coord(3, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kForwardChecking, 2);
+            checkSameSolutions(grid, symbols, presets, Solver::kForwardChecking | Solver::kBackjumping, 2);
+            CHECK(checkSameSolutionSet<GridSolver>(grid, symbols, presets, Solver::kSmallestDomainFirst) == 2);
+
+            // Every loop on the torus has an even length, so 12 and 3 can't
+            // be two steps apart, though nothing in between is set yet.
+            Grid2D open(size);
+            GridValues<2> parity(size);
+            parity.place(12, coord(0, 0));
+            parity.place( 3, coord(0, 2));
+            CHECK(countSolutions(open, symbols, parity, Solver::kForwardChecking, 0) == 0);
+            CHECK(countSolutions(open, symbols, parity, 0, 0) == 0);
+
+            // A joker can be next to anything, so the windows around
+            // a preset open up after it.
+            Sequence cards(6, 1);
+            Symbol joker = cards.addSymbol(2);
+            for(Symbol s = 1; s <= 6; ++s)
+            {
+                cards.makeAdjacent(joker, s);
+            }
+            Grid2D band(coord(4, 2));
+            GridValues<2> jokers(band.getSize());
+            jokers.place(6, coord(0, 0));
+            jokers.place(3, coord(2, 1));
+            CHECK(countSolutions(band, cards, jokers, 0, 0) == 6);
+            CHECK(countSolutions(band, cards, jokers, Solver::kForwardChecking, 0) == 6);
+        }
+
+        void neighbourCapacityTest()
+        {
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 7, coord(0, 5));
+            checkSameSolutions(grid, symbols, presets, Solver::kNeighbourCapacity, 6);
+            checkSameSolutions(grid, symbols, presets, Solver::kNeighbourCapacity | Solver::kForwardChecking, 6);
+            checkSameSolutions(grid, symbols, presets, Solver::kNeighbourCapacity | Solver::kRecordNogoods, 6);
+
+            // On the open torus every cell has four neighbours, but
+            // there are only two 11s and two 1s to go round a 12.
+            Grid2D open(size);
+            GridValues<2> crowded(size);
+            crowded.place(12, coord(1, 1));
+            crowded.place(11, coord(3, 3));
+            GridSolver<2> solver(open, symbols, SearchOptions(Solver::kNeighbourCapacity));
+            solver.addPresets(crowded);
+            CHECK(solver.countSolutions(0) == 0);
+            CHECK(countSolutions(open, symbols, crowded, Solver::kNeighbourCapacity | Solver::kBackjumping, 0) == 0);
+        }
+
+        void chainTest()
+        {
+            // Filling in the corridors a walk at a time finds the same
+            // solutions, in its own order.
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+            Grid2D grid(size);
+            buildChallengeGrid(grid);
+            GridValues<2> presets(size);
+            presets.place(12, coord(0, 0));
+            presets.place( 7, coord(0, 5));
+            int flags[] = {
+                0,
+                Solver::kForwardChecking,
+                Solver::kArcConsistency | Solver::kCardinality,
+                Solver::kNeighbourCapacity
+            };
+            for(int i = 0; i < 4; ++i)
+            {
+                CHECK(checkSameSolutionSet<GridSolver>(grid, symbols, presets, flags[i] | Solver::kCompressChains) == 6);
+            }
+            CHECK(countSolutions(grid, symbols, presets, Solver::kBreakSymmetry | Solver::kCompressChains, 0)
+                == countSolutions(grid, symbols, presets, Solver::kBreakSymmetry, 0));
+
+            Grid2D solveGrid(size);
+            buildSolve2DGrid(solveGrid);
+            GridValues<2> solvePresets(size);
+            solvePresets.place(10, coord(0, 0));
+            CHECK(checkSameSolutionSet<GridSolver>(solveGrid, symbols, solvePresets, Solver::kCompressChains) == 16);
+            CHECK(countSolutions(solveGrid, symbols, solvePresets, Solver::kCompressChains, 0) == 16);
+
+            // A board that is one long corridor, snaking along the rows.
+            Grid2D snake(size);
+            buildSnake(snake);
+            GridValues<2> head(size);
+            head.place(12, coord(0, 0));
+            Solver::SolutionCount count = countSolutions(snake, symbols, head, 0, 0);
+            CHECK(checkSameSolutionSet<GridSolver>(snake, symbols, head, Solver::kCompressChains) == count);
+            CHECK(checkSameSolutionSet<GridSolver>(snake, symbols, head, Solver::kForwardChecking | Solver::kCompressChains) == count);
+        }
+
+        void islandTest()
+        {
+            // Counting the islands separately comes to the same counts.
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+            Grid2D solveGrid(size);
+            buildSolve2DGrid(solveGrid);
+            GridValues<2> solvePresets(size);
+            solvePresets.place(10, coord(0, 0));
+            Grid2D challenge(size);
+            buildChallengeGrid(challenge);
+            GridValues<2> challengePresets(size);
+            challengePresets.place(12, coord(0, 0));
+            challengePresets.place( 7, coord(0, 5));
+
+            Grid2D band(coord(6, 2));
+            Sequence fours(4, 3);
+            GridValues<2> none(band.getSize());
+
+            int flags[] = {
+                0,
+                Solver::kForwardChecking,
+                Solver::kSmallestDomainFirst,
+                Solver::kArcConsistency | Solver::kCardinality,
+                Solver::kCompressChains,
+                Solver::kRecordNogoods
+            };
+            for(int i = 0; i < 12; ++i)
+            {
+                int islands = flags[i / 2] | (i % 2 == 0 ? Solver::kSplitIslands : Solver::kCacheIslands);
+                CHECK(countSolutions(solveGrid, symbols, solvePresets, islands, 0) == 16);
+                CHECK(countSolutions(solveGrid, symbols, solvePresets, islands, 5) == 5);
+                CHECK(countSolutions(challenge, symbols, challengePresets, islands, 0) == 6);
+                CHECK(countSolutions(band, fours, none, islands, 0) == 800);
+            }
+
+            // The islands are ignored when breaking symmetry.
+            CHECK(countSolutions(band, fours, none, Solver::kBreakSymmetry | Solver::kSplitIslands, 0) == 38);
+
+            // A board that is one long corridor, which any set
+            // cell along the way splits in two.
+            Grid2D snake(size);
+            buildSnake(snake);
+            GridValues<2> middle(size);
+            middle.place(12, coord(1, 2));
+            middle.place(6, coord(2, 3));
+            Solver::SolutionCount expected = countSolutions(snake, symbols, middle, 0, 0);
+            CHECK(expected > 0);
+            CHECK(countSolutions(snake, symbols, middle, Solver::kSplitIslands, 0) == expected);
+            CHECK(countSolutions(snake, symbols, middle, Solver::kForwardChecking | Solver::kSplitIslands, 0) == expected);
+            CHECK(countSolutions(snake, symbols, middle, Solver::kCacheIslands, 0) == expected);
+
+            // The same islands come round again by different routes, and a
+            // cache shared between searches answers the second from what
+            // the first remembered.
+            int cached = Solver::kSmallestDomainFirst | Solver::kCacheIslands;
+            Solver::SubproblemCache cache(1 << 16);
+            GridSolver<2> first(band, fours, Solver::SearchOptions(cached));
+            first.setCache(&cache);
+            CHECK(first.countSolutions(0) == 800);
+            CHECK(cache.size() > 0);
+            CHECK(cache.hits() > 0);
+            unsigned long long misses = cache.misses();
+            GridSolver<2> second(band, fours, Solver::SearchOptions(cached));
+            second.setCache(&cache);
+            CHECK(second.countSolutions(0) == 800);
+            CHECK(cache.misses() == misses);
+
+            // A cache too small to hold much still gives the same count.
+            Solver::SubproblemCache tiny(64);
+            GridSolver<2> third(band, fours, Solver::SearchOptions(cached));
+            third.setCache(&tiny);
+            CHECK(third.countSolutions(0) == 800);
+            CHECK(tiny.cost() <= 64);
+
+            // Stepping through the solutions doesn't split.
+            CHECK(checkSameSolutionSet<GridSolver>(solveGrid, symbols, solvePresets, Solver::kSplitIslands) == 16);
+        }
+
+        void restartTest()
+        {
+            int luby[15] = { 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8 };
+            for(int i = 0; i < 15; ++i)
+            {
+                CHECK(Solver::lubyTerm(i) == luby[i]);
+            }
+
+            // The order is random, but every solution still
+            // comes out once, whatever the seed.
+            Coordinate2D size = coord(4, 6);
+            Sequence symbols(12, 2);
+            Grid2D challenge(size);
+            buildChallengeGrid(challenge);
+            GridValues<2> challengePresets(size);
+            challengePresets.place(12, coord(0, 0));
+            challengePresets.place( 7, coord(0, 5));
+            Grid2D solveGrid(size);
+            buildSolve2DGrid(solveGrid);
+            GridValues<2> solvePresets(size);
+            solvePresets.place(10, coord(0, 0));
+
+            int flags[] = {
+                Solver::kRestarts,
+                Solver::kRestarts | Solver::kForwardChecking,
+                Solver::kRestarts | Solver::kSmallestDomainFirst | Solver::kRecordNogoods,
+                Solver::kRestarts | Solver::kArcConsistency | Solver::kCardinality,
+                Solver::kRestarts | Solver::kCompressChains
+            };
+            for(unsigned seed = 0; seed < 3; ++seed)
+            {
+                for(int i = 0; i < 5; ++i)
+                {
+                    Solver::SearchOptions options(flags[i], 1, seed);
+                    CHECK(checkSameSolutionSet<GridSolver>(challenge, symbols, challengePresets, options) == 6);
+                    CHECK(checkSameSolutionSet<GridSolver>(solveGrid, symbols, solvePresets, options) == 16);
+                }
+            }
+            Grid2D band(coord(6, 2));
+            Sequence fours(4, 3);
+            GridValues<2> none(band.getSize());
+            CHECK(countSolutions(band, fours, none, Solver::kRestarts, 0) == 800);
+            CHECK(countSolutions(band, fours, none, Solver::kRestarts | Solver::kBreakSymmetry, 0) == 38);
+            CHECK(countSolutions(band, fours, none, Solver::kRestarts | Solver::kSplitIslands, 0) == 800);
+
+            // The same seed takes the same route to the same solution.
+            GridSolver<2> first(solveGrid, symbols, Solver::SearchOptions(Solver::kRestarts, 1, 7));
+            first.addPresets(solvePresets);
+            GridSolver<2> second(solveGrid, symbols, Solver::SearchOptions(Solver::kRestarts, 1, 7));
+            second.addPresets(solvePresets);
+            CHECK(first.nextSolution() == Solver::kFoundSolution);
+            CHECK(second.nextSolution() == Solver::kFoundSolution);
+            CHECK(Solver::isMatch(first.getSolution(), second.getSolution()));
+
+            // A preset that fits next to its neighbours, but leaves nothing
+            // that can be filled in. Without forward checking that only shows
+            // deep in the search, so the runs get longer until one of them
+            // gets to the end.
+            GridValues<2> stuck(challengePresets);
+            stuck.place(4, coord(3, 5));
+            int stuckFlags[] = { 0, Solver::kBackjumping };
+            for(int i = 0; i < 2; ++i)
+            {
+                GridSolver<2> solver(challenge, symbols, Solver::SearchOptions(stuckFlags[i] | Solver::kRestarts, 1, 1));
+                solver.addPresets(stuck);
+                CHECK(solver.nextSolution() == Solver::kNoSolution);
+                CHECK(solver.restartCount() > 0);
+            }
+        }
+
+        void presetClashTest()
+        {
+            // Presets next to each other that can't be. The search never
+            // checks one preset against another, so they are checked first
+            // and every option agrees that there is nothing to find.
+            Grid2D grid(coord(2, 2));
+            Sequence symbols(7, 2);
+            GridValues<2> presets(grid.getSize());
+            presets.place(5, coord(0, 0));
+            presets.place(5, coord(0, 1));
+            int flags[] = {
+                0,
+                Solver::kForwardChecking,
+                Solver::kSmallestDomainFirst,
+                Solver::kArcConsistency,
+                Solver::kBreakSymmetry,
+                Solver::kBreakValueSymmetry,
+                Solver::kBackjumping | Solver::kRecordNogoods,
+                Solver::kCardinality,
+                Solver::kNeighbourCapacity,
+                Solver::kCompressChains,
+                Solver::kSplitIslands,
+                Solver::kRestarts
+            };
+            for(int i = 0; i < 12; ++i)
+            {
+                GridSolver<2> solver(grid, symbols, flags[i]);
+                solver.addPresets(presets);
+                CHECK(solver.nextSolution() == Solver::kNoSolution);
+                CHECK(countSolutions(grid, symbols, presets, flags[i], 0) == 0);
+            }
+        }
     };
 }
 
@@ -8,11 +8,23 @@
 
 #include "Solver/GridValues.h."
 #include "Solver/Grid.h"
+#include "Solver/Topology.h"
 #include "Solver/Sequence.h"
 #include "Solver/SolveResult.h"
+#include "Solver/SearchOptions.h"
+#include "Solver/SearchMonitor.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/Symmetry.h"
+#include "Solver/ValueSymmetry.h"
+#include "Solver/SymbolUsage.h"
+#include "Solver/SubproblemCache.h"
+#include "Solver/Luby.h"
 
 #include <vector>
+#include <utility>
 #include <algorithm>
+#include <memory>
+#include <random>
 
 namespace Solver
 {
@@ -35,7 +47,7 @@ namespace Solver
                 const Grid<3>& grid,
                 const GridValues<3>& values,
                 const Coordinate<3>& location,
-                const std::vector<Symbol>& options
+                SymbolMask options
             )
             {
                 if(location == coord(1, 2, 3))
@@ -53,49 +65,98 @@ namespace Solver
         const Grid<Dimensions>&,
         const GridValues<Dimensions>&,
         const Coordinate<Dimensions>&,
-        const std::vector<Symbol>&
+        SymbolMask
     )
     {
     }
 }
 
 // Finds solutions to grid puzzles.
-// The basic aproach is to use backtracking
+// The basic aproach is to use backtracking, optionally with
+// some inference to prune the search (see SearchOptions).
 template <int Dimensions>
-class Solver::GridSolver
+class Solver::GridSolver : public Solver::SolveEngine<Dimensions>
 {
     PREVENT_COPY_AND_ASSIGNMENT(GridSolver);
 public:
     typedef Grid<Dimensions> GridD;
     typedef Coordinate<Dimensions> Coord;
     typedef GridValues<Dimensions> Values;
-    typedef std::vector<Symbol> SymbolList;
-    typedef Sequence::SymbolSet SymbolSet;
 
     // The information needed at each choice point of the
     // backtracker. Note that the structure of the problem is that
     // we don't need to clear the locations when we pop the stack,
     // just follow the same path through the grid with different values.
+    // Locations are linear cell indices into the Topology.
     struct Stage
     {
-        Stage(Coord loc, bool freeRegionStart = false)
+        Stage(int loc, bool freeRegionStart = false)
             : location(loc)
             , isFreeRegionStart(freeRegionStart)
+            , options(0)
+            , trailMark(0)
+            , chain(-1)
+            , walkStart(-1)
+            , walkEnd(-1)
+            , walkDepth(0)
         {
         }
 
-        Coord location;
+        int location;
         bool isFreeRegionStart;
-        SymbolList options;
+        SymbolMask options;
+
+        // The length of the trail when this stage was entered. Undoing
+        // back to it takes away everything placed from here on.
+        size_t trailMark;
+
+        // With backjumping, the earlier stages that had a hand in ruling
+        // out the options here, indexed by depth.
+        std::vector<bool> conflicts;
+
+        // When the location is in a chain, the stage fills in the whole
+        // chain as a walk from the cell before its first cell to the
+        // cell after its last. The walk is searched one cell at a time
+        // within the stage, with the options left and the trail mark
+        // for each cell.
+        int chain;
+        std::vector<int> walkCells;
+        int walkStart;
+        int walkEnd;
+        std::vector<SymbolMask> walkOptions;
+        std::vector<size_t> walkMarks;
+        int walkDepth;
     };
     typedef std::vector<Stage> Stages;
 
-    GridSolver(const GridD& grid, const Sequence& sequence)
+    GridSolver(const GridD& grid, const Sequence& sequence, SearchOptions options = SearchOptions())
         : mGrid(grid)
+        , mTopology(grid)
         , mTotalCount(mGrid.getTotalSize())
         , mSequence(sequence)
+        , mOptions(options)
         , mValues(grid.getSize())
+        , mAvailable(allowedSymbols(sequence))
+        , mUsed(0)
         , mStackTop(-1)
+        , mSearchLocation(0)
+        , mSolutionDepth(-1)
+        , mWipedOut(-1)
+        , mCrowded(-1)
+        , mSymbolRange(highestSymbol(sequence.getSymbolMask()) + 1)
+        , mMonitor(NULLPTR)
+        , mMonitorCountdown(kMonitorInterval)
+        , mRandom(options.seed)
+        , mRandomOrder(false)
+        , mRestarting(false)
+        , mRestart(0)
+        , mRestartBudget(0)
+        , mSymmetry(NULLPTR)
+        , mImage(0)
+        , mCounting(false)
+        , mIslandCount(0)
+        , mVisit(0)
+        , mCache(NULLPTR)
     {
 #if BUILD_TESTS
         assert(mGrid.integrityCheck());
@@ -107,68 +168,385 @@ public:
     {
         // Don't allow adding presets after the solve has started.
         assert(mStackTop < 0);
+        Symbol previous = mValues[location];
         mValues.place(s, location);
+        updateAvailable(previous);
+        updateAvailable(s);
     }
 
     // Set all initial values on the grid prior to solve.
     void addPresets(const Values& values)
     {
-        Values::const_iterator end = values.end();
-        for(Values::const_iterator it = values.begin(); it != end; ++it)
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
         {
             addPreset(it->second, it->first);
         }
     }
 
-    // The top level of the backtracker.
+    // Have the search check in with the monitor regularly. If the monitor
+    // asks it to stop, nextSolution reports that there are no more solutions.
+    void setMonitor(SearchMonitor<Dimensions>* monitor)
+    {
+        mMonitor = monitor;
+    }
+
+    // Use symmetries found elsewhere, rather than finding them from the
+    // presets. They must be symmetries of the presets, and they have to be
+    // shared by all the solvers working on parts of the same search so
+    // that they agree on which solution of each set to keep.
+    void setSymmetry(const Symmetry* symmetry)
+    {
+        assert(mStackTop < 0);
+        mSymmetry = symmetry;
+    }
+
+    // Share a cache of what islands came to with other searches of the
+    // same puzzle. Without one, each top level search makes its own.
+    void setCache(SubproblemCache* cache)
+    {
+        mCache = cache;
+    }
+
     SolveResult nextSolution()
     {
-        if(mStack.size() > 0)
+        if(++mImage < (int)mImages.size())
         {
-            // We are still sitting at the point of the last solve.
-            popOption();
+            return kFoundSolution;
         }
-        else if(!findNextUnsetNeighbour())
+        mImages.clear();
+        SolveResult result = findSolution();
+        if(result == kFoundSolution && mOptions.has(kExpandSymmetry))
         {
-            if(isSolution())
+            mSymmetry->images(mValues, mImages);
+            mImage = 0;
+        }
+        return result;
+    }
+
+    SolutionCount countSolutions(SolutionCount limit = 0)
+    {
+        if(mStack.empty() && isSolution())
+        {
+            return 1;
+        }
+        SolutionCount count = 0;
+        SolutionCount found = countNextSolutions();
+        while(found > 0)
+        {
+            count += found;
+            if(limit != 0 && count >= limit)
             {
-                return kAlreadySolved;
+                return limit;
             }
-            else
+            found = countNextSolutions();
+        }
+        return count;
+    }
+
+    // Like nextSolution, but rather than trying the other options for the
+    // last cell one at a time it counts them all as solutions at once.
+    // Returns the number found, or zero when the search is finished.
+    // Presets that are already a solution are not counted.
+    SolutionCount countNextSolutions()
+    {
+        mCounting = true;
+        if(findSolution() != kFoundSolution)
+        {
+            return 0;
+        }
+        if(mIslandCount > 0)
+        {
+            // The unset cells split up, and were counted island by island.
+            SolutionCount found = mIslandCount;
+            mIslandCount = 0;
+            return found;
+        }
+        if(breaksSymmetry())
+        {
+            // The other options for the last cell might not lead.
+            return mOptions.has(kExpandSymmetry) ? mSymmetry->orbitSize(mValues) : 1;
+        }
+
+        // The last cell's options were worked out with every other cell
+        // set, so they all fit.
+        Stage& last = mStack[mStackTop];
+        SolutionCount found = 1 + countSymbols(last.options);
+        last.options = 0;
+        return found;
+    }
+
+    const GridValues<Dimensions>& getSolution() const
+    {
+        return mImages.empty() ? mValues : mImages[mImage];
+    }
+
+    // How many times the search has started again with kRestarts.
+    int restartCount() const
+    {
+        return mRestart;
+    }
+
+private:
+    // The kinds of state that are changed on the trail.
+    enum ChangeKind
+    {
+        kValueChange,
+        kDomainChange,
+        kSetNeighboursChange,
+        kAvailableChange,
+        kUsedChange
+    };
+
+    // One entry on the trail. The old value is a symbol for a value
+    // change. A set neighbours change stands for the counts around the
+    // cell all going up by one, rather than logging each of them.
+    struct Change
+    {
+        Change(ChangeKind k, int i, SymbolMask o)
+            : kind(k)
+            , index(i)
+            , old(o)
+        {
+        }
+
+        ChangeKind kind;
+        int index;
+        SymbolMask old;
+    };
+
+    // The top level of the backtracker.
+    SolveResult findSolution()
+    {
+        if(mStack.empty() && breaksSymmetry() && mSymmetry == NULLPTR)
+        {
+            mOwnSymmetry = std::auto_ptr<Symmetry>(new Symmetry(mGrid, mTopology, mValues));
+            mSymmetry = mOwnSymmetry.get();
+        }
+        if(mStack.empty() && mOptions.has(kBreakValueSymmetry) && !breaksSymmetry())
+        {
+            mValueSymmetry = std::auto_ptr<ValueSymmetry>(new ValueSymmetry(mSequence));
+        }
+
+        if(mStack.empty() && isBackjumping())
+        {
+            mDepthOf.assign(mTotalCount, -1);
+        }
+        if(mStack.empty())
+        {
+            // The presets are never undone.
+            mTrail.clear();
+            initialiseLimits();
+            if(isCompressingChains())
+            {
+                findChains();
+            }
+            initialiseOrder();
+        }
+
+        // Otherwise we are still sitting at the point of the last solve,
+        // and carry on with what is left to try there. That is usually
+        // nothing, but a chain can have more walks to it.
+        if(mStack.empty())
+        {
+            if(!presetsFit())
+            {
+                return kNoSolution;
+            }
+            if(isForwardChecking() && !initialiseDomains())
+            {
+                // The presets alone leave some cell with no options.
+                return kNoSolution;
+            }
+            if(isSolution())
             {
-                findNextFreeLocation();
+                return kAlreadySolved;
             }
+            nextStage();
         }
         while(mStackTop >= 0)
         {
+            if(mMonitor != NULLPTR && --mMonitorCountdown == 0)
+            {
+                mMonitorCountdown = kMonitorInterval;
+                if(mMonitor->shouldStop())
+                {
+                    return kNoSolution;
+                }
+                if(mMonitor->wantsWork())
+                {
+                    shareWork();
+                }
+            }
+            if(mRestarting && --mRestartBudget == 0)
+            {
+                restart();
+            }
             if(placeNextOption())
             {
                 if(isSolution())
                 {
+                    // Nothing on the path to a solution can be jumped over.
+                    mSolutionDepth = mStackTop;
+                    mRestarting = false;
                     return kFoundSolution;
                 }
-                else if(!findNextUnsetNeighbour())
+                else if(mCounting && isSplittingIslands() && splitsRegion(mStack[mStackTop]))
+                {
+                    // Nor can anything on the way to the islands, as
+                    // there is no telling what ruled them out.
+                    mSolutionDepth = mStackTop;
+                    mIslandCount = countIslands();
+                    if(mIslandCount > 0)
+                    {
+                        mRestarting = false;
+                        return kFoundSolution;
+                    }
+                }
+                else
                 {
-                    findNextFreeLocation();
+                    nextStage();
                 }
             }
             else
             {
-                popOption();
+                backtrack();
             }
         }
         return kNoSolution;
     }
 
-    const GridValues<Dimensions>& getSolution() const
+    bool isSolution() const
     {
-        return mValues;
+        return mValues.valueCount() == mTotalCount;
     }
 
-private:
-    bool isSolution() const
+    // Whether the presets next to each other can be. The search only checks
+    // the cells it sets against their neighbours, so without this a clash
+    // between two presets would be caught by some options and not others.
+    // A board that is filled in already is left to be reported as solved.
+    bool presetsFit() const
     {
-        return mValues.valueCount() == mTotalCount;
+        if(isSolution())
+        {
+            return true;
+        }
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            Symbol s = mValues.atIndex(cell);
+            if(s == Solver::kUnsetSymbol)
+            {
+                continue;
+            }
+            SymbolMask adjacent = mSequence.getAdjacentMask(s);
+            Topology::const_iterator end = mTopology.end(cell);
+            for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+            {
+                Symbol atN = mValues.atIndex(*n);
+                if(atN != Solver::kUnsetSymbol && !hasSymbol(adjacent, atN))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Set up the order that ties between cells are broken in, and with
+    // restarts mix it up and set the budget for the first run. Ties go
+    // to the lowest rank. Without restarts the ranks are the cells.
+    void initialiseOrder()
+    {
+        mRank.resize(mTotalCount);
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            mRank[cell] = cell;
+        }
+        mRandomOrder = isRestarting();
+        mRestarting = mRandomOrder;
+        if(mRandomOrder)
+        {
+            shuffleOrder();
+            mRestart = 0;
+            mRestartBudget = kRestartUnit * lubyTerm(mRestart);
+        }
+    }
+
+    void shuffleOrder()
+    {
+        std::shuffle(mRank.begin(), mRank.end(), mRandom);
+        mSearchLocation = randomBelow(mTotalCount);
+    }
+
+    int randomBelow(int limit)
+    {
+        return std::uniform_int_distribution<int>(0, limit - 1)(mRandom);
+    }
+
+    // The budget has run out without finding a solution, so undo
+    // everything and start again from the top in a new order with a
+    // new budget. Any nogoods still hold, so they are kept.
+    void restart()
+    {
+        undoTo(mStack[0].trailMark);
+        mStack.clear();
+        mStackTop = -1;
+        mSolutionDepth = -1;
+        shuffleOrder();
+        if(mOptions.has(kSmallestDomainFirst))
+        {
+            rebuildCandidates();
+        }
+        mRestartBudget = kRestartUnit * lubyTerm(++mRestart);
+        nextStage();
+    }
+
+    // Hand half of the untried options at the shallowest stage that has
+    // any over to the monitor, each as the partial solution that leads to it.
+    // Shallow stages have the largest subtrees under them.
+    void shareWork()
+    {
+        for(int depth = 0; depth <= mStackTop; ++depth)
+        {
+            Stage& stage = mStack[depth];
+            int count = countSymbols(stage.options);
+            if(count > 0)
+            {
+                Values partial(mValues);
+                for(int above = depth; above <= mStackTop; ++above)
+                {
+                    partial.clearAt(mStack[above].location);
+                    for(size_t i = 0; i < mStack[above].walkCells.size(); ++i)
+                    {
+                        partial.clearAt(mStack[above].walkCells[i]);
+                    }
+                }
+                // The options handed over haven't been ruled out here.
+                mSolutionDepth = std::max(mSolutionDepth, depth);
+                for(int shared = (count + 1) / 2; shared > 0; --shared)
+                {
+                    // Options are tried highest first, so keep those.
+                    Symbol s = lowestSymbol(stage.options);
+                    stage.options &= ~symbolBit(s);
+                    partial.placeAt(s, stage.location);
+                    mMonitor->takeWork(partial);
+                }
+                return;
+            }
+        }
+    }
+
+    // Move on to a new stage once the current one has been placed.
+    void nextStage()
+    {
+        if(mOptions.has(kSmallestDomainFirst))
+        {
+            pushSmallestDomain();
+        }
+        else if(!findNextUnsetNeighbour())
+        {
+            findNextFreeLocation();
+        }
     }
 
     bool findNextUnsetNeighbour()
@@ -176,20 +554,26 @@ private:
         ++mStackTop;
         if(mStackTop == (int)mStack.size())
         {
-            Coord current = mSearchLocation;
-            while(isSet(current) || !hasSetNeighbour(current))
+            int current = mSearchLocation;
+            int openChain = -1;
+            while(isSet(current) || !hasSetNeighbour(current) || isOpenChain(current))
             {
-                current = next(current, mGrid.getSize());
-                if(current == mGrid.getSize())
+                if(openChain < 0 && !isSet(current) && hasSetNeighbour(current))
                 {
-                    // loop back to the start.
-                    current = Coord();
+                    openChain = current;
                 }
+                current = nextCell(current);
                 if(current == mSearchLocation)
                 {
-                    // We got back to where we started, so
-                    // there's nothing to find.
-                    return false;
+                    if(openChain < 0)
+                    {
+                        // We got back to where we started, so
+                        // there's nothing to find.
+                        return false;
+                    }
+                    // Only chains with an end still open are left.
+                    current = openChain;
+                    break;
                 }
             }
             mStack.push_back(Stage(current));
@@ -201,39 +585,42 @@ private:
 
     // Try to grow as directly as possible by starting the next
     // stage close to where we are now.
-    Coord nextSearchLocation(const Coord& location)
+    int nextSearchLocation(int location)
     {
-        GridD::Neighbours n = mGrid.getNeighbours(location, false);
-        while(n.advance())
+        // With a random order, start looking from a random neighbour.
+        int degree = mTopology.degree(location);
+        int first = mRandomOrder && degree > 0 ? randomBelow(degree) : 0;
+        Topology::const_iterator neighbours = mTopology.begin(location);
+        for(int i = 0; i < degree; ++i)
         {
-            if(!isSet(n.current()))
+            int n = neighbours[(first + i) % degree];
+            if(!isSet(n))
             {
-                return n.current();
+                return n;
             }
         }
         // Nothing good, just pick something.
-        Coord nextLocation = next(location, mGrid.getSize());
-        if(nextLocation == mGrid.getSize())
-        {
-            return Coord();
-        }
-        else
-        {
-            return nextLocation;
-        }
+        return nextCell(location);
     }
 
-    bool isSet(const Coord& location) const
+    // Step through the cells in coordinate order, looping back to the start.
+    int nextCell(int location) const
     {
-        return mValues[location] != Solver::kUnsetSymbol;
+        ++location;
+        return location == mTotalCount ? 0 : location;
     }
 
-    bool hasSetNeighbour(const Coord& location) const
+    bool isSet(int location) const
     {
-        GridD::Neighbours n = mGrid.getNeighbours(location, false);
-        while(n.advance())
+        return mValues.atIndex(location) != Solver::kUnsetSymbol;
+    }
+
+    bool hasSetNeighbour(int location) const
+    {
+        Topology::const_iterator end = mTopology.end(location);
+        for(Topology::const_iterator n = mTopology.begin(location); n != end; ++n)
         {
-            if(isSet(n.current()))
+            if(isSet(*n))
             {
                 return true;
             }
@@ -244,15 +631,10 @@ private:
     bool findNextFreeLocation()
     {
         assert(mStackTop == (int)mStack.size());
-        Coord current = mSearchLocation;
+        int current = mSearchLocation;
         while(isSet(current))
         {
-            current = next(current, mGrid.getSize());
-            if(current == mGrid.getSize())
-            {
-                // loop back to the start.
-                current = Coord();
-            }
+            current = nextCell(current);
             assert(current != mSearchLocation);
         }
         mStack.push_back(Stage(current, true));
@@ -261,123 +643,1750 @@ private:
         return true;
     }
 
+    // The options for a location are the symbols that are still available
+    // and adjacent in the sequence to every symbol already set around it.
     void updateOptions()
     {
-        SymbolList& options = mStack[mStackTop].options;
-        options.clear();
-
-        if(mStack[mStackTop].isFreeRegionStart)
+        Stage& stage = mStack[mStackTop];
+        stage.trailMark = mTrail.size();
+        if(isCompressingChains() && mChainOf[stage.location] >= 0)
         {
-            addConstrainedBySequence(options, mSequence.getSymbols());
+            startWalk(stage);
             return;
         }
+        SymbolMask options = mAvailable;
 
-        GridD::Neighbours n = mGrid.getNeighbours(mStack[mStackTop].location, false);
-        while(n.advance())
+        if(isForwardChecking())
+        {
+            // The live domain already accounts for the neighbours.
+            options &= mDomains[stage.location];
+        }
+        else if(!stage.isFreeRegionStart)
         {
-            Symbol atN = mValues[n.current()];
-            if(atN != Solver::kUnsetSymbol)
+            Topology::const_iterator end = mTopology.end(stage.location);
+            for(Topology::const_iterator n = mTopology.begin(stage.location); options != 0 && n != end; ++n)
             {
-                const SymbolSet& adjacent = mSequence.getAdjacent(atN);
-                // Is this the first neighbour we encounter?
-                if(options.size() == 0)
-                {
-                    addConstrainedBySequence(options, adjacent);
-                    if(options.size() == 0)
-                    {
-                        // We've run out of options.
-                        return;
-                    }
-                }
-                else
+                Symbol atN = mValues.atIndex(*n);
+                if(atN != Solver::kUnsetSymbol)
                 {
-                    removeIncompatible(options, adjacent);
-
-                    if(options.size() == 0)
-                    {
-                        // We can't satisfy the constraints.
-                        return;
-                    }
+                    options &= mSequence.getAdjacentMask(atN);
                 }
             }
         }
-        diagnose(mGrid, mValues, mStack[mStackTop].location, options);
+        SymbolMask allowed = options;
+        if(mValueSymmetry.get() != NULLPTR)
+        {
+            options = mValueSymmetry->representatives(options, mUsed);
+        }
+        stage.options = options;
+        if(isBackjumping())
+        {
+            stage.conflicts.assign(mStackTop, false);
+            if(options != allowed)
+            {
+                // Relabelling depends on everything placed so far.
+                addConflictsBelow(stage.conflicts, mStackTop);
+            }
+            explain(stage.location, mSequence.getSymbolMask() & ~allowed, stage.conflicts);
+        }
+        diagnose(mGrid, mValues, mValues.locationOf(stage.location), options);
     }
 
-    void addConstrainedBySequence(SymbolList& options, const SymbolSet& adjacent)
+    // The symbols that can be placed at all. A sequence
+    // can allow a symbol no times.
+    static SymbolMask allowedSymbols(const Sequence& sequence)
     {
-        Sequence::SymbolSet::const_iterator adjIt = adjacent.begin();
-        for(; adjIt != adjacent.end(); ++adjIt)
+        SymbolMask allowed = 0;
+        for(SymbolMask symbols = sequence.getSymbolMask(); symbols != 0; )
         {
-            Symbol s = *adjIt;
-            if(mSequence.count(s) > mValues.symbolCount(s))
+            Symbol s = lowestSymbol(symbols);
+            symbols &= ~symbolBit(s);
+            if(sequence.count(s) > 0)
             {
-                options.push_back(s);
+                allowed |= symbolBit(s);
             }
         }
+        return allowed;
     }
 
-    // Functor used to filter the list of options.
-    template <typename T>
-    struct IsNotIn
+    // Keep the masks of symbols which have been used, and which haven't
+    // been used up, in step with the values.
+    void updateAvailable(Symbol s)
     {
-        IsNotIn(const std::set<T>& items)
-            : mItems(items)
+        if(s == Solver::kUnsetSymbol)
         {
+            return;
         }
+        SymbolMask bit = symbolBit(s);
+        int count = mValues.symbolCount(s);
+        setMask(kUsedChange, mUsed, count > 0 ? mUsed | bit : mUsed & ~bit);
+        setMask(kAvailableChange, mAvailable, count < mSequence.count(s) ? mAvailable | bit : mAvailable & ~bit);
+    }
 
-        bool operator()(T item) const
+    void setMask(ChangeKind kind, SymbolMask& mask, SymbolMask value)
+    {
+        if(mask != value)
         {
-            return mItems.find(item) == mItems.end();
+            mTrail.push_back(Change(kind, 0, mask));
+            mask = value;
         }
+    }
 
-    private:
-        PREVENT_ASSIGNMENT(IsNotIn);
-        const std::set<T>& mItems;
-    };
+    void placeValue(int location, Symbol s)
+    {
+        Symbol previous = mValues.atIndex(location);
+        mTrail.push_back(Change(kValueChange, location, (SymbolMask)previous));
+        if(previous == Solver::kUnsetSymbol && mOptions.has(kCardinality))
+        {
+            updateSupply(mDomains[location], -1);
+        }
+        mValues.placeAt(s, location);
+        updateAvailable(previous);
+        updateAvailable(s);
+    }
 
-    void removeIncompatible(SymbolList& options, const SymbolSet& adjacent)
+    // Put back everything changed since the mark, latest first.
+    void undoTo(size_t mark)
     {
-        options.erase(
-            std::remove_if(options.begin(), options.end(), IsNotIn<Symbol>(adjacent)),
-            options.end()
-        );
+        while(mTrail.size() > mark)
+        {
+            const Change& change = mTrail.back();
+            switch(change.kind)
+            {
+            case kValueChange:
+                if((Symbol)change.old == Solver::kUnsetSymbol)
+                {
+                    mValues.clearAt(change.index);
+                    if(mOptions.has(kCardinality))
+                    {
+                        updateSupply(mDomains[change.index], 1);
+                    }
+                }
+                else
+                {
+                    mValues.placeAt((Symbol)change.old, change.index);
+                }
+                break;
+            case kDomainChange:
+                if(mOptions.has(kCardinality))
+                {
+                    updateSupply(change.old & ~mDomains[change.index], 1);
+                }
+                mDomains[change.index] = change.old;
+                break;
+            case kSetNeighboursChange:
+                updateSetNeighbours(change.index, -1);
+                break;
+            case kAvailableChange:
+                mAvailable = change.old;
+                break;
+            case kUsedChange:
+                mUsed = change.old;
+                break;
+            }
+            mTrail.pop_back();
+        }
     }
 
     bool placeNextOption()
     {
         Stage& current = mStack[mStackTop];
-        if(current.options.size() > 0)
+        if(current.chain >= 0)
         {
-            mValues.place(current.options.back(), current.location);
-            current.options.pop_back();
-            return true;
+            return placeNextWalk(current);
         }
-        else
+        while(current.options != 0)
         {
-            return false;
+            // Take the highest symbol first, or any of them at random.
+            Symbol s = mRandomOrder ? randomSymbol(current.options) : highestSymbol(current.options);
+            current.options &= ~symbolBit(s);
+
+            // This replaces the previous option tried here, if any.
+            clearLocation(current);
+            placeValue(current.location, s);
+            if(isForwardChecking())
+            {
+                updateSetNeighbours(current.location, 1);
+                mTrail.push_back(Change(kSetNeighboursChange, current.location, 0));
+            }
+            if(isBackjumping())
+            {
+                mDepthOf[current.location] = mStackTop;
+                if(violatesNogood(current.location, s, current.conflicts))
+                {
+                    continue;
+                }
+            }
+
+            if(isForwardChecking() && !propagate(current.location, s))
+            {
+                if(isBackjumping())
+                {
+                    explainWipeOut(current.conflicts);
+                }
+            }
+            else if(mOptions.has(kNeighbourCapacity) && !checkCapacity(current.location, s))
+            {
+                if(isBackjumping())
+                {
+                    explainCapacity(current.conflicts);
+                }
+            }
+            else if(mSymmetry != NULLPTR && !mSymmetry->allows(mValues))
+            {
+                // The lex-leader test looks at the whole board.
+                addConflictsBelow(current.conflicts, mStackTop);
+            }
+            else
+            {
+                return true;
+            }
         }
+        return false;
     }
 
-    void popOption()
+    Symbol randomSymbol(SymbolMask options)
     {
-        Stage& current = mStack[mStackTop];
-        mValues.clear(current.location);
-
-        // The location will still be the next neighbour to look at,
-        // so we won't need to find it again, just move back
-        // the stack one step.
-        --mStackTop;
+        for(int skip = randomBelow(countSymbols(options)); skip > 0; --skip)
+        {
+            options &= ~symbolBit(lowestSymbol(options));
+        }
+        return lowestSymbol(options);
     }
 
-    const GridD& mGrid;
-    int mTotalCount;
-    const Sequence& mSequence;
-    Values mValues;
+    // Once the current stage has run out of options, step back to the
+    // deepest earlier stage that helped rule them out, passing on the
+    // rest of the blame. Without backjumping that is always the stage
+    // just before.
+    void backtrack()
+    {
+        int depth = mStackTop;
+        if(!isBackjumping() || depth <= mSolutionDepth)
+        {
+            mSolutionDepth = std::min(mSolutionDepth, depth - 1);
+            popOption();
+            return;
+        }
 
-    Stages mStack;
-    int mStackTop;
-    Coord mSearchLocation;
+        const std::vector<bool>& conflicts = mStack[depth].conflicts;
+        int target = depth - 1;
+        while(target >= 0 && !conflicts[target])
+        {
+            --target;
+        }
+        if(mOptions.has(kRecordNogoods))
+        {
+            recordNogood(conflicts);
+        }
+        if(target >= 0)
+        {
+            std::vector<bool>& targetConflicts = mStack[target].conflicts;
+            for(int i = 0; i < target; ++i)
+            {
+                if(conflicts[i])
+                {
+                    targetConflicts[i] = true;
+                }
+            }
+        }
+        // With nothing to blame but the presets, this ends the search.
+        while(mStackTop > target)
+        {
+            popOption();
+        }
+    }
+
+    void clearLocation(const Stage& stage)
+    {
+        undoTo(stage.trailMark);
+    }
+
+    void popOption()
+    {
+        clearLocation(mStack[mStackTop]);
+        if(mOptions.has(kSmallestDomainFirst))
+        {
+            pushCandidate(mStack[mStackTop].location);
+        }
+
+        // The location will still be the next neighbour to look at,
+        // so we won't need to find it again, just move back
+        // the stack one step.
+        --mStackTop;
+    }
+
+    // The chains are the runs of unset cells with exactly two neighbours.
+    // A run that closes up into a loop is left alone, as is a single cell.
+    void findChains()
+    {
+        mChainOf.assign(mTotalCount, -1);
+        mChains.clear();
+        int longest = 0;
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            if(mChainOf[cell] != -1 || !isChainCell(cell))
+            {
+                continue;
+            }
+            Chain chain;
+            std::vector<int> back;
+            int backEnd = followChain(cell, *mTopology.begin(cell), back);
+            int forwardEnd = followChain(cell, *(mTopology.begin(cell) + 1), chain.cells);
+            if(backEnd == cell || forwardEnd == cell)
+            {
+                // A loop, so mark it as seen but not a chain.
+                mChainOf[cell] = -2;
+                for(size_t i = 0; i < chain.cells.size(); ++i)
+                {
+                    mChainOf[chain.cells[i]] = -2;
+                }
+                continue;
+            }
+            chain.cells.insert(chain.cells.begin(), cell);
+            chain.cells.insert(chain.cells.begin(), back.rbegin(), back.rend());
+            chain.ends[0] = backEnd;
+            chain.ends[1] = forwardEnd;
+            if(chain.cells.size() < 2)
+            {
+                mChainOf[cell] = -2;
+                continue;
+            }
+            for(size_t i = 0; i < chain.cells.size(); ++i)
+            {
+                mChainOf[chain.cells[i]] = (int)mChains.size();
+            }
+            longest = std::max(longest, (int)chain.cells.size());
+            mChains.push_back(chain);
+        }
+
+        // The symbols each symbol can get to in exactly k steps.
+        mWalkReach.assign(longest + 2, std::vector<SymbolMask>(mSymbolRange, 0));
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            mWalkReach[0][s] = symbolBit(s);
+        }
+        for(int k = 1; k < (int)mWalkReach.size(); ++k)
+        {
+            for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+            {
+                SymbolMask reach = 0;
+                for(SymbolMask from = mWalkReach[k - 1][s]; from != 0; )
+                {
+                    Symbol t = lowestSymbol(from);
+                    from &= ~symbolBit(t);
+                    reach |= mSequence.getAdjacentMask(t);
+                }
+                mWalkReach[k][s] = reach;
+            }
+        }
+    }
+
+    // Chains are best left until both of their ends are set, when the
+    // walks along them are pinned down at both ends.
+    bool isOpenChain(int cell) const
+    {
+        if(!isCompressingChains() || mChainOf[cell] < 0)
+        {
+            return false;
+        }
+        const Chain& chain = mChains[mChainOf[cell]];
+        return !isSet(chain.ends[0]) || !isSet(chain.ends[1]);
+    }
+
+    bool isChainCell(int cell) const
+    {
+        return !isSet(cell) && mTopology.degree(cell) == 2;
+    }
+
+    // Step from the cell towards next along the chain, adding the chain
+    // cells passed to the list, and return the first cell that isn't in
+    // the chain, or the cell itself if the chain loops back to it.
+    int followChain(int cell, int next, std::vector<int>& cells)
+    {
+        int previous = cell;
+        while(next != cell && isChainCell(next))
+        {
+            cells.push_back(next);
+            Topology::const_iterator n = mTopology.begin(next);
+            int after = *n == previous ? *(n + 1) : *n;
+            previous = next;
+            next = after;
+        }
+        return next;
+    }
+
+    // Set the stage up to walk along its chain, starting from the end
+    // that is set if only one of them is.
+    void startWalk(Stage& stage)
+    {
+        const Chain& chain = mChains[mChainOf[stage.location]];
+        stage.chain = mChainOf[stage.location];
+        stage.walkCells = chain.cells;
+        stage.walkStart = chain.ends[0];
+        stage.walkEnd = chain.ends[1];
+        if(!isSet(stage.walkStart) && isSet(stage.walkEnd))
+        {
+            std::reverse(stage.walkCells.begin(), stage.walkCells.end());
+            std::swap(stage.walkStart, stage.walkEnd);
+        }
+        int length = (int)stage.walkCells.size();
+        stage.walkOptions.assign(length, 0);
+        stage.walkMarks.assign(length, stage.trailMark);
+        stage.walkDepth = 0;
+        stage.walkOptions[0] = walkOptions(stage, 0);
+        stage.options = 0;
+    }
+
+    // The symbols the i-th cell of the walk could take, given the cell
+    // before it and how far it is from the far end.
+    SymbolMask walkOptions(const Stage& stage, int i) const
+    {
+        int cell = stage.walkCells[i];
+        SymbolMask options = mAvailable;
+        if(isForwardChecking())
+        {
+            options &= mDomains[cell];
+        }
+        Symbol before = mValues.atIndex(i == 0 ? stage.walkStart : stage.walkCells[i - 1]);
+        if(before != Solver::kUnsetSymbol)
+        {
+            options &= mSequence.getAdjacentMask(before);
+        }
+        Symbol end = mValues.atIndex(stage.walkEnd);
+        if(end != Solver::kUnsetSymbol)
+        {
+            options &= mWalkReach[(int)stage.walkCells.size() - i][end];
+        }
+        return options;
+    }
+
+    // Move the walk on to the next one that fits, a depth first search
+    // along the chain that carries on from where the last walk ended.
+    bool placeNextWalk(Stage& stage)
+    {
+        int last = (int)stage.walkCells.size() - 1;
+        int i = stage.walkDepth;
+        while(i >= 0)
+        {
+            if(stage.walkOptions[i] == 0)
+            {
+                --i;
+                continue;
+            }
+            Symbol s = highestSymbol(stage.walkOptions[i]);
+            stage.walkOptions[i] &= ~symbolBit(s);
+
+            int cell = stage.walkCells[i];
+            undoTo(stage.walkMarks[i]);
+            placeValue(cell, s);
+            if(isForwardChecking())
+            {
+                updateSetNeighbours(cell, 1);
+                mTrail.push_back(Change(kSetNeighboursChange, cell, 0));
+                if(!propagate(cell, s))
+                {
+                    continue;
+                }
+            }
+            if(mOptions.has(kNeighbourCapacity) && !checkCapacity(cell, s))
+            {
+                continue;
+            }
+            if(mSymmetry != NULLPTR && !mSymmetry->allows(mValues))
+            {
+                continue;
+            }
+            if(i == last)
+            {
+                stage.walkDepth = i;
+                return true;
+            }
+            ++i;
+            stage.walkMarks[i] = mTrail.size();
+            stage.walkOptions[i] = walkOptions(stage, i);
+        }
+        stage.walkDepth = 0;
+        return false;
+    }
+
+    bool isCompressingChains() const
+    {
+        return mOptions.has(kCompressChains)
+            && !mOptions.has(kSmallestDomainFirst)
+            && !isBackjumping()
+            && !(mOptions.has(kBreakValueSymmetry) && !breaksSymmetry());
+    }
+
+    bool isSplittingIslands() const
+    {
+        return (mOptions.has(kSplitIslands) || mOptions.has(kCacheIslands))
+            && !breaksSymmetry()
+            && !mOptions.has(kBreakValueSymmetry);
+    }
+
+    bool breaksSymmetry() const
+    {
+        return mOptions.has(kBreakSymmetry) || mOptions.has(kExpandSymmetry);
+    }
+
+    // Restarting jumps from one order to another, which the relabelling
+    // of kBreakValueSymmetry depends on, and would stop a parallel search
+    // from sharing out its work in order.
+    bool isRestarting() const
+    {
+        return mOptions.has(kRestarts)
+            && mMonitor == NULLPTR
+            && !(mOptions.has(kBreakValueSymmetry) && !breaksSymmetry());
+    }
+
+    bool isBackjumping() const
+    {
+        return mOptions.has(kBackjumping) || mOptions.has(kRecordNogoods);
+    }
+
+    bool isForwardChecking() const
+    {
+        return mOptions.has(kForwardChecking)
+            || mOptions.has(kSmallestDomainFirst)
+            || mOptions.has(kArcConsistency)
+            || mOptions.has(kCardinality);
+    }
+
+    // Whether the cells a stage placed have cut the unset cells around
+    // them off from each other. Only the unset neighbours of the placed
+    // cells need to be joined back up, so the search through the unset
+    // cells stops as soon as they all are.
+    bool splitsRegion(const Stage& stage)
+    {
+        if(mVisited.empty())
+        {
+            mVisited.assign(mTotalCount, 0);
+            mTouching.assign(mTotalCount, 0);
+        }
+        ++mVisit;
+        mIslandCells.clear();
+        touchUnsetNeighbours(stage.location);
+        for(size_t i = 0; i < stage.walkCells.size(); ++i)
+        {
+            touchUnsetNeighbours(stage.walkCells[i]);
+        }
+        if(mIslandCells.size() < 2)
+        {
+            return false;
+        }
+
+        int touching = (int)mIslandCells.size();
+        int joined = 1;
+        int first = mIslandCells[0];
+        mIslandCells.clear();
+        mIslandCells.push_back(first);
+        mVisited[first] = mVisit;
+        for(size_t i = 0; i < mIslandCells.size(); ++i)
+        {
+            int cell = mIslandCells[i];
+            Topology::const_iterator end = mTopology.end(cell);
+            for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+            {
+                if(!isSet(*n) && mVisited[*n] != mVisit)
+                {
+                    mVisited[*n] = mVisit;
+                    mIslandCells.push_back(*n);
+                    if(mTouching[*n] == mVisit && ++joined == touching)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    void touchUnsetNeighbours(int location)
+    {
+        Topology::const_iterator end = mTopology.end(location);
+        for(Topology::const_iterator n = mTopology.begin(location); n != end; ++n)
+        {
+            if(!isSet(*n) && mTouching[*n] != mVisit)
+            {
+                mTouching[*n] = mVisit;
+                mIslandCells.push_back(*n);
+            }
+        }
+    }
+
+    // Count the ways of filling in the unset cells once they have split
+    // into islands. They only affect each other through the symbols they
+    // use, so all the ways of filling in each island but the biggest are
+    // found by themselves and put together by the symbols they use. The
+    // biggest is then counted with what each total leaves, which splits
+    // it up further if it can.
+    SolutionCount countIslands()
+    {
+        std::vector< std::vector<int> > islands;
+        mIslandOf.assign(mTotalCount, -1);
+        int biggest = 0;
+        for(int first = 0; first < mTotalCount; ++first)
+        {
+            if(isSet(first) || mIslandOf[first] >= 0)
+            {
+                continue;
+            }
+            islands.push_back(std::vector<int>(1, first));
+            std::vector<int>& island = islands.back();
+            mIslandOf[first] = (int)islands.size() - 1;
+            for(size_t i = 0; i < island.size(); ++i)
+            {
+                Topology::const_iterator end = mTopology.end(island[i]);
+                for(Topology::const_iterator n = mTopology.begin(island[i]); n != end; ++n)
+                {
+                    if(!isSet(*n) && mIslandOf[*n] < 0)
+                    {
+                        mIslandOf[*n] = mIslandOf[first];
+                        island.push_back(*n);
+                    }
+                }
+            }
+            if(island.size() > islands[biggest].size())
+            {
+                biggest = (int)islands.size() - 1;
+            }
+        }
+        int last = (int)islands.size() - 1;
+        std::swap(islands[biggest], islands[last]);
+
+        // The sub-searches see the symbols already on the board, so they
+        // are limited by what the sequence allows in all.
+        SymbolUsage limits(mSymbolRange, 0);
+        SymbolUsage remaining(mSymbolRange, 0);
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            if(hasSymbol(mSequence.getSymbolMask(), s))
+            {
+                limits[s] = mSequence.count(s);
+                remaining[s] = limits[s] - mValues.symbolCount(s);
+            }
+        }
+
+        UsageCounts total;
+        total[SymbolUsage(mSymbolRange, 0)] = 1;
+        UsageCounts usage;
+        UsageCounts joined;
+        for(int i = 0; i < last && !total.empty(); ++i)
+        {
+            islandUsage(islands, i, limits, usage);
+            joinUsage(total, usage, remaining, joined);
+            total.swap(joined);
+        }
+
+        SolutionCount count = 0;
+        UsageCounts::const_iterator end = total.end();
+        for(UsageCounts::const_iterator it = total.begin(); it != end; ++it)
+        {
+            SymbolUsage left(limits);
+            for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+            {
+                left[s] -= it->first[s];
+            }
+            count += it->second * countIsland(islands, last, left);
+        }
+        return count;
+    }
+
+    // An island is searched by itself by setting the unset cells of all
+    // the other islands to a filler symbol that can sit next to anything.
+    // As the islands are kept apart by set cells, that changes nothing.
+    void islandProblem(
+        const std::vector< std::vector<int> >& islands,
+        int island,
+        const SymbolUsage& limits,
+        Sequence& sequence,
+        Values& values
+    ) const
+    {
+        int others = mTotalCount - mValues.valueCount() - (int)islands[island].size();
+        Symbol filler = makeRegionSequence(mSequence, limits, others, sequence);
+        values = mValues;
+        for(int i = 0; i < (int)islands.size(); ++i)
+        {
+            for(size_t j = 0; i != island && j < islands[i].size(); ++j)
+            {
+                values.placeAt(filler, islands[i][j]);
+            }
+        }
+    }
+
+    // The cache is shared by all the searches under the top one, which
+    // makes it when it first needs it.
+    SubproblemCache* islandCache()
+    {
+        if(!mOptions.has(kCacheIslands))
+        {
+            return NULLPTR;
+        }
+        if(mCache == NULLPTR)
+        {
+            mOwnCache.reset(new SubproblemCache(kIslandCacheSize));
+            mCache = mOwnCache.get();
+        }
+        return mCache;
+    }
+
+    // What an island comes to depends only on its cells, the values
+    // next to it and, with the limits, the symbols left for it.
+    SubproblemCache::Key islandKey(
+        int kind,
+        const std::vector<int>& island,
+        const SymbolUsage& limits
+    ) const
+    {
+        SubproblemCache::Key key(1, kind);
+        std::vector<int> cells(island);
+        std::sort(cells.begin(), cells.end());
+        key.insert(key.end(), cells.begin(), cells.end());
+
+        key.push_back(-1);
+        std::vector<int> around;
+        for(size_t i = 0; i < cells.size(); ++i)
+        {
+            Topology::const_iterator end = mTopology.end(cells[i]);
+            for(Topology::const_iterator n = mTopology.begin(cells[i]); n != end; ++n)
+            {
+                if(isSet(*n))
+                {
+                    around.push_back(*n);
+                }
+            }
+        }
+        std::sort(around.begin(), around.end());
+        around.erase(std::unique(around.begin(), around.end()), around.end());
+        for(size_t i = 0; i < around.size(); ++i)
+        {
+            key.push_back(around[i]);
+            key.push_back(mValues.atIndex(around[i]));
+        }
+
+        // Having more of a symbol left than the island has cells
+        // is the same as having just enough to fill it.
+        key.push_back(-1);
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            key.push_back(std::min(limits[s] - mValues.symbolCount(s), (int)cells.size()));
+        }
+        return key;
+    }
+
+    void islandUsage(
+        const std::vector< std::vector<int> >& islands,
+        int island,
+        const SymbolUsage& limits,
+        UsageCounts& usage
+    )
+    {
+        SubproblemCache* cache = islandCache();
+        SubproblemCache::Key key;
+        if(cache != NULLPTR)
+        {
+            key = islandKey(kIslandUsage, islands[island], limits);
+            if(cache->findUsage(key, usage))
+            {
+                return;
+            }
+        }
+
+        Sequence sequence;
+        Values values(mGrid.getSize());
+        islandProblem(islands, island, limits, sequence, values);
+        GridSolver solver(mGrid, sequence, mOptions);
+        solver.addPresets(values);
+        solver.setCache(cache);
+
+        usage.clear();
+        SymbolUsage used(mSymbolRange, 0);
+        const std::vector<int>& cells = islands[island];
+        while(solver.nextSolution() == kFoundSolution)
+        {
+            used.assign(mSymbolRange, 0);
+            for(size_t i = 0; i < cells.size(); ++i)
+            {
+                ++used[solver.getSolution().atIndex(cells[i])];
+            }
+            ++usage[used];
+        }
+        if(cache != NULLPTR)
+        {
+            cache->storeUsage(key, usage);
+        }
+    }
+
+    SolutionCount countIsland(
+        const std::vector< std::vector<int> >& islands,
+        int island,
+        const SymbolUsage& limits
+    )
+    {
+        SubproblemCache* cache = islandCache();
+        SubproblemCache::Key key;
+        SolutionCount count = 0;
+        if(cache != NULLPTR)
+        {
+            key = islandKey(kIslandCount, islands[island], limits);
+            if(cache->findCount(key, count))
+            {
+                return count;
+            }
+        }
+
+        Sequence sequence;
+        Values values(mGrid.getSize());
+        islandProblem(islands, island, limits, sequence, values);
+        GridSolver solver(mGrid, sequence, mOptions);
+        solver.addPresets(values);
+        solver.setCache(cache);
+        count = solver.countSolutions(0);
+        if(cache != NULLPTR)
+        {
+            cache->storeCount(key, count);
+        }
+        return count;
+    }
+
+    // With dynamic ordering the path through the grid depends on the
+    // values, so stages can't be reused and are rebuilt as we go.
+    void pushSmallestDomain()
+    {
+        ++mStackTop;
+        mStack.erase(mStack.begin() + mStackTop, mStack.end());
+
+        int cell = popSmallestDomain();
+        mStack.push_back(Stage(cell, mSetNeighbours[cell] == 0));
+        updateOptions();
+    }
+
+    // An entry in the heap of cells to branch on. Entries are not removed
+    // when a cell changes; instead a fresh entry is pushed whenever a cell
+    // becomes more constrained, and stale entries are checked against the
+    // cell as they reach the top.
+    struct Candidate
+    {
+        int size;
+        int setNeighbours;
+        int degree;
+        int rank;
+        int cell;
+
+        // Ordering for a max heap, so the 'largest' candidate is the
+        // most constrained one.
+        bool operator<(const Candidate& other) const
+        {
+            if(size != other.size)
+            {
+                return size > other.size;
+            }
+            if(setNeighbours != other.setNeighbours)
+            {
+                return setNeighbours < other.setNeighbours;
+            }
+            if(degree != other.degree)
+            {
+                return degree < other.degree;
+            }
+            return rank > other.rank;
+        }
+
+        bool operator==(const Candidate& other) const
+        {
+            return size == other.size && setNeighbours == other.setNeighbours && cell == other.cell;
+        }
+    };
+
+    Candidate candidate(int cell) const
+    {
+        Candidate c;
+        c.size = countSymbols(mDomains[cell] & mAvailable);
+        c.setNeighbours = mSetNeighbours[cell];
+        c.degree = mTopology.degree(cell);
+        c.rank = mRank[cell];
+        c.cell = cell;
+        return c;
+    }
+
+    void pushCandidate(int cell)
+    {
+        if(!mOptions.has(kSmallestDomainFirst))
+        {
+            return;
+        }
+        if((int)mCandidates.size() > kCandidateRebuildFactor * mTotalCount)
+        {
+            rebuildCandidates();
+        }
+        mCandidates.push_back(candidate(cell));
+        std::push_heap(mCandidates.begin(), mCandidates.end());
+    }
+
+    void rebuildCandidates()
+    {
+        mCandidates.clear();
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            if(!isSet(cell))
+            {
+                mCandidates.push_back(candidate(cell));
+            }
+        }
+        std::make_heap(mCandidates.begin(), mCandidates.end());
+    }
+
+    int popSmallestDomain()
+    {
+        for(;;)
+        {
+            assert(!mCandidates.empty());
+            Candidate top = mCandidates.front();
+            std::pop_heap(mCandidates.begin(), mCandidates.end());
+            mCandidates.pop_back();
+
+            if(!isSet(top.cell))
+            {
+                Candidate current = candidate(top.cell);
+                if(current == top)
+                {
+                    return top.cell;
+                }
+                // It has become less constrained since this entry was pushed.
+                mCandidates.push_back(current);
+                std::push_heap(mCandidates.begin(), mCandidates.end());
+            }
+        }
+    }
+
+    void updateSetNeighbours(int location, int change)
+    {
+        Topology::const_iterator end = mTopology.end(location);
+        for(Topology::const_iterator n = mTopology.begin(location); n != end; ++n)
+        {
+            mSetNeighbours[*n] += change;
+        }
+    }
+
+    // Start every unset cell's domain off with the symbols
+    // allowed by the presets, near and far.
+    bool initialiseDomains()
+    {
+        mDomains.assign(mTotalCount, mSequence.getSymbolMask());
+        mSetNeighbours.assign(mTotalCount, 0);
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            Symbol s = mValues.atIndex(cell);
+            if(s != Solver::kUnsetSymbol)
+            {
+                narrowByDistance(cell, s);
+                updateSetNeighbours(cell, 1);
+            }
+        }
+        mPresetDomains = mDomains;
+        if(mOptions.has(kCardinality))
+        {
+            initialiseSupply();
+        }
+        if(mOptions.has(kSmallestDomainFirst))
+        {
+            rebuildCandidates();
+        }
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            if(!isSet(cell) && (mDomains[cell] & mAvailable) == 0)
+            {
+                return false;
+            }
+        }
+        if(mOptions.has(kArcConsistency))
+        {
+            // Let the presets shrink the domains as far as they can before
+            // the search starts. This is all on the trail below the first
+            // stage's mark, so is never undone.
+            mQueued.assign(mTotalCount, false);
+            for(int cell = 0; cell < mTotalCount; ++cell)
+            {
+                enqueue(cell);
+            }
+            if(!propagateArcs())
+            {
+                return false;
+            }
+        }
+        return propagateCounts();
+    }
+
+    // A cell d steps away from a preset through the open walls can only
+    // hold a symbol that is d steps away from the preset's symbol in the
+    // sequence. For the hours that is a window of d either side of it, and
+    // only every other hour in the window. A joker is next to everything,
+    // so it just widens the windows until they stop narrowing anything.
+    void narrowByDistance(int preset, Symbol s)
+    {
+        SymbolMask all = mSequence.getSymbolMask();
+        std::vector<int> distance(mTotalCount, -1);
+        std::vector<SymbolMask> reach(1, symbolBit(s));
+        std::vector<int> queue(1, preset);
+        distance[preset] = 0;
+        for(size_t head = 0; head < queue.size(); ++head)
+        {
+            int cell = queue[head];
+            int d = distance[cell];
+            if(d + 1 == (int)reach.size())
+            {
+                SymbolMask next = 0;
+                for(SymbolMask symbols = reach[d]; symbols != 0; )
+                {
+                    Symbol t = lowestSymbol(symbols);
+                    symbols &= ~symbolBit(t);
+                    next |= mSequence.getAdjacentMask(t);
+                }
+                if((next & all) == all)
+                {
+                    // Nothing further away can be narrowed.
+                    return;
+                }
+                reach.push_back(next);
+            }
+            Topology::const_iterator end = mTopology.end(cell);
+            for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+            {
+                if(distance[*n] < 0)
+                {
+                    distance[*n] = d + 1;
+                    mDomains[*n] &= reach[d + 1];
+                    queue.push_back(*n);
+                }
+            }
+        }
+    }
+
+    // Narrow the domains after the symbol s has been placed at location.
+    bool propagate(int location, Symbol s)
+    {
+        if(!mOptions.has(kArcConsistency))
+        {
+            return forwardCheck(location, s) && propagateCounts();
+        }
+
+        enqueue(location);
+        if(!hasSymbol(mAvailable, s))
+        {
+            // Every cell that could have held s has lost an option.
+            for(int cell = 0; cell < mTotalCount; ++cell)
+            {
+                if(hasSymbol(mDomains[cell], s) && !isSet(cell))
+                {
+                    if((mDomains[cell] & mAvailable) == 0)
+                    {
+                        clearQueue();
+                        return false;
+                    }
+                    pushCandidate(cell);
+                    enqueue(cell);
+                }
+            }
+        }
+        return propagateArcs() && propagateCounts();
+    }
+
+    // Narrow the domains of the unset cells around a location that
+    // has just been given the symbol s. Fails if any cell is left
+    // with nothing it could hold.
+    bool forwardCheck(int location, Symbol s)
+    {
+        SymbolMask adjacent = mSequence.getAdjacentMask(s);
+        Topology::const_iterator end = mTopology.end(location);
+        for(Topology::const_iterator n = mTopology.begin(location); n != end; ++n)
+        {
+            if(!isSet(*n))
+            {
+                restrictDomain(*n, adjacent);
+                if((mDomains[*n] & mAvailable) == 0)
+                {
+                    mWipedOut = *n;
+                    return false;
+                }
+            }
+        }
+
+        if(!hasSymbol(mAvailable, s))
+        {
+            // That was the last copy of s, which matters to
+            // every cell that was counting on it.
+            for(int cell = 0; cell < mTotalCount; ++cell)
+            {
+                if(hasSymbol(mDomains[cell], s) && !isSet(cell))
+                {
+                    if((mDomains[cell] & mAvailable) == 0)
+                    {
+                        mWipedOut = cell;
+                        return false;
+                    }
+                    pushCandidate(cell);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Returns true if the domain changed.
+    bool restrictDomain(int cell, SymbolMask mask)
+    {
+        SymbolMask narrowed = mDomains[cell] & mask;
+        bool changed = narrowed != mDomains[cell];
+        if(changed)
+        {
+            mTrail.push_back(Change(kDomainChange, cell, mDomains[cell]));
+            if(mOptions.has(kCardinality))
+            {
+                updateSupply(mDomains[cell] & ~narrowed, -1);
+            }
+            mDomains[cell] = narrowed;
+        }
+        pushCandidate(cell);
+        return changed;
+    }
+
+    // The symbols that a neighbour of the cell could hold, given
+    // what the cell itself can still be.
+    SymbolMask supportOf(int cell) const
+    {
+        Symbol value = mValues.atIndex(cell);
+        if(value != Solver::kUnsetSymbol)
+        {
+            return mSequence.getAdjacentMask(value);
+        }
+        SymbolMask support = 0;
+        SymbolMask domain = mDomains[cell] & mAvailable;
+        while(domain != 0)
+        {
+            Symbol s = lowestSymbol(domain);
+            domain &= ~symbolBit(s);
+            support |= mSequence.getAdjacentMask(s);
+        }
+        return support;
+    }
+
+    void enqueue(int cell)
+    {
+        if(!mQueued[cell])
+        {
+            mQueued[cell] = true;
+            mArcQueue.push_back(cell);
+        }
+    }
+
+    void clearQueue()
+    {
+        for(size_t i = 0; i < mArcQueue.size(); ++i)
+        {
+            mQueued[mArcQueue[i]] = false;
+        }
+        mArcQueue.clear();
+    }
+
+    // AC-3 over the adjacencies of the topology. Each queued cell has had
+    // its domain narrowed, so its unset neighbours are revised against it,
+    // and any of them that change are queued in turn. Fails as soon as
+    // some domain is emptied.
+    bool propagateArcs()
+    {
+        for(size_t head = 0; head < mArcQueue.size(); ++head)
+        {
+            int cell = mArcQueue[head];
+            mQueued[cell] = false;
+            SymbolMask support = supportOf(cell);
+            Topology::const_iterator end = mTopology.end(cell);
+            for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+            {
+                if(!isSet(*n) && restrictDomain(*n, support))
+                {
+                    if((mDomains[*n] & mAvailable) == 0)
+                    {
+                        clearQueue();
+                        return false;
+                    }
+                    enqueue(*n);
+                }
+            }
+        }
+        mArcQueue.clear();
+        return true;
+    }
+
+    // The symbols still to be placed have to fill the unset cells, so
+    // with a total of slack more of them left than there are cells, each
+    // symbol has to go in at least all but slack of the places it has
+    // left. When a symbol has only just enough cells that can take it,
+    // they are forced to it, and with too few the branch is dead. After
+    // that a matching of the cells to the symbols checks that they can
+    // all be filled at once.
+    bool propagateCounts()
+    {
+        if(!mOptions.has(kCardinality))
+        {
+            return true;
+        }
+        bool forced = true;
+        while(forced)
+        {
+            forced = false;
+            int slack = mValues.valueCount() - mTotalCount;
+            for(SymbolMask symbols = mAvailable; symbols != 0; )
+            {
+                Symbol s = lowestSymbol(symbols);
+                symbols &= ~symbolBit(s);
+                slack += remaining(s);
+            }
+            if(slack < 0)
+            {
+                return failCounts();
+            }
+            for(SymbolMask symbols = mAvailable; symbols != 0; )
+            {
+                Symbol s = lowestSymbol(symbols);
+                symbols &= ~symbolBit(s);
+                int needed = remaining(s) - slack;
+                if(needed > 0 && mSupply[s] < needed)
+                {
+                    return failCounts();
+                }
+                if(needed > 0 && mSupply[s] == needed && forceSymbol(s))
+                {
+                    forced = true;
+                }
+            }
+            if(forced && mOptions.has(kArcConsistency) && !propagateArcs())
+            {
+                mWipedOut = -1;
+                return false;
+            }
+        }
+        return matchCells() || failCounts();
+    }
+
+    bool failCounts()
+    {
+        clearQueue();
+        mWipedOut = -1;
+        return false;
+    }
+
+    int remaining(Symbol s) const
+    {
+        return mSymbolLimits[s] - mValues.symbolCount(s);
+    }
+
+    // Narrow every unset cell that could hold s down to just s.
+    // Returns true if any of them changed.
+    bool forceSymbol(Symbol s)
+    {
+        bool changed = false;
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            if(!isSet(cell) && hasSymbol(mDomains[cell], s) && restrictDomain(cell, symbolBit(s)))
+            {
+                changed = true;
+                if(mOptions.has(kArcConsistency))
+                {
+                    enqueue(cell);
+                }
+            }
+        }
+        return changed;
+    }
+
+    void initialiseLimits()
+    {
+        mSymbolLimits.assign(mSymbolRange, 0);
+        for(SymbolMask symbols = mSequence.getSymbolMask(); symbols != 0; )
+        {
+            Symbol s = lowestSymbol(symbols);
+            symbols &= ~symbolBit(s);
+            mSymbolLimits[s] = mSequence.count(s);
+        }
+    }
+
+    // Having just placed s at the location, check the cells that it
+    // could have taken a symbol from: the location itself, and every set
+    // cell that s can sit next to.
+    bool checkCapacity(int location, Symbol s)
+    {
+        if(!hasCapacity(location))
+        {
+            mCrowded = location;
+            return false;
+        }
+        SymbolMask adjacent = mSequence.getAdjacentMask(s);
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            Symbol atCell = mValues.atIndex(cell);
+            if(atCell != Solver::kUnsetSymbol && hasSymbol(adjacent, atCell)
+                && cell != location && !hasCapacity(cell))
+            {
+                mCrowded = cell;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Every unset neighbour of a set cell needs a symbol that can sit
+    // next to it, so there have to be enough of those left.
+    bool hasCapacity(int cell) const
+    {
+        int open = 0;
+        Topology::const_iterator end = mTopology.end(cell);
+        for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+        {
+            if(!isSet(*n))
+            {
+                ++open;
+            }
+        }
+        int capacity = 0;
+        SymbolMask symbols = mSequence.getAdjacentMask(mValues.atIndex(cell)) & mAvailable;
+        while(symbols != 0 && capacity < open)
+        {
+            Symbol s = lowestSymbol(symbols);
+            symbols &= ~symbolBit(s);
+            capacity += remaining(s);
+        }
+        return capacity >= open;
+    }
+
+    // Counts the unset cells whose domains hold each symbol.
+    void initialiseSupply()
+    {
+        mSupply.assign(mSymbolRange, 0);
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            if(!isSet(cell))
+            {
+                updateSupply(mDomains[cell], 1);
+            }
+        }
+        mMatch.assign(mTotalCount, Solver::kUnsetSymbol);
+        mMatchCount.assign(mSymbolRange, 0);
+        mMatchVisited.assign(mSymbolRange, false);
+    }
+
+    void updateSupply(SymbolMask symbols, int change)
+    {
+        while(symbols != 0)
+        {
+            Symbol s = lowestSymbol(symbols);
+            symbols &= ~symbolBit(s);
+            mSupply[s] += change;
+        }
+    }
+
+    // Looks for a symbol for every unset cell, with no symbol used more
+    // times than it has left. The matching is kept between calls and only
+    // the cells whose symbol no longer fits are matched again.
+    bool matchCells()
+    {
+        std::fill(mMatchCount.begin(), mMatchCount.end(), 0);
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            Symbol s = mMatch[cell];
+            if(isSet(cell) || s == Solver::kUnsetSymbol)
+            {
+                mMatch[cell] = Solver::kUnsetSymbol;
+            }
+            else if(hasSymbol(mDomains[cell] & mAvailable, s) && mMatchCount[s] < remaining(s))
+            {
+                ++mMatchCount[s];
+            }
+            else
+            {
+                mMatch[cell] = Solver::kUnsetSymbol;
+            }
+        }
+        for(int cell = 0; cell < mTotalCount; ++cell)
+        {
+            if(!isSet(cell) && mMatch[cell] == Solver::kUnsetSymbol)
+            {
+                std::fill(mMatchVisited.begin(), mMatchVisited.end(), false);
+                if(!augmentMatch(cell))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Finds a symbol for an unmatched cell, if need be by moving other
+    // cells on to different symbols to make room.
+    bool augmentMatch(int cell)
+    {
+        SymbolMask options = mDomains[cell] & mAvailable;
+        for(SymbolMask free = options; free != 0; )
+        {
+            Symbol s = lowestSymbol(free);
+            free &= ~symbolBit(s);
+            if(mMatchCount[s] < remaining(s))
+            {
+                mMatch[cell] = s;
+                ++mMatchCount[s];
+                return true;
+            }
+        }
+        while(options != 0)
+        {
+            Symbol s = lowestSymbol(options);
+            options &= ~symbolBit(s);
+            if(mMatchVisited[s])
+            {
+                continue;
+            }
+            mMatchVisited[s] = true;
+            for(int other = 0; other < mTotalCount; ++other)
+            {
+                if(mMatch[other] == s)
+                {
+                    // The other cell gives up s to this one.
+                    mMatch[other] = Solver::kUnsetSymbol;
+                    if(augmentMatch(other))
+                    {
+                        mMatch[cell] = s;
+                        return true;
+                    }
+                    mMatch[other] = s;
+                }
+            }
+        }
+        return false;
+    }
+
+    static void addConflict(std::vector<bool>& conflicts, int depth)
+    {
+        if(depth >= 0 && depth < (int)conflicts.size())
+        {
+            conflicts[depth] = true;
+        }
+    }
+
+    static void addConflictsBelow(std::vector<bool>& conflicts, int depth)
+    {
+        int end = std::min(depth, (int)conflicts.size());
+        std::fill(conflicts.begin(), conflicts.begin() + end, true);
+    }
+
+    // Blame the stages that stop the cell holding any of the symbols.
+    void explain(int cell, SymbolMask symbols, std::vector<bool>& conflicts) const
+    {
+        while(symbols != 0)
+        {
+            Symbol s = lowestSymbol(symbols);
+            symbols &= ~symbolBit(s);
+            explainSymbol(cell, s, conflicts);
+        }
+    }
+
+    void explainSymbol(int cell, Symbol s, std::vector<bool>& conflicts) const
+    {
+        if(mOptions.has(kArcConsistency) && !hasSymbol(mDomains[cell], s))
+        {
+            // Propagation can take away symbols because of anything
+            // placed up to the stage that did it.
+            addConflictsBelow(conflicts, removedBy(cell, s) + 1);
+            return;
+        }
+
+        if(isForwardChecking() && !hasSymbol(mPresetDomains[cell], s))
+        {
+            // The presets alone rule it out.
+            return;
+        }
+
+        // A neighbour that can't sit next to s. Presets are at depth -1,
+        // so are preferred, and otherwise the shallowest stage is.
+        int culprit = mStackTop + 1;
+        Topology::const_iterator end = mTopology.end(cell);
+        for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+        {
+            Symbol atN = mValues.atIndex(*n);
+            if(atN != Solver::kUnsetSymbol && !hasSymbol(mSequence.getAdjacentMask(atN), s))
+            {
+                culprit = std::min(culprit, mDepthOf[*n]);
+            }
+        }
+        if(culprit <= mStackTop)
+        {
+            addConflict(conflicts, culprit);
+            return;
+        }
+
+        if(!hasSymbol(mAvailable, s))
+        {
+            // Used up, by the presets and these stages.
+            for(int depth = 0; depth < (int)conflicts.size(); ++depth)
+            {
+                if(mValues.atIndex(mStack[depth].location) == s)
+                {
+                    conflicts[depth] = true;
+                }
+            }
+            return;
+        }
+
+        // Nothing to blame, so assume the worst.
+        addConflictsBelow(conflicts, (int)conflicts.size());
+    }
+
+    // The placement at the top of the stack left some cell with no options,
+    // or left the symbol counts unable to fill the cells.
+    void explainWipeOut(std::vector<bool>& conflicts) const
+    {
+        if(mOptions.has(kArcConsistency) || mWipedOut < 0)
+        {
+            // The wipe out could be the end of a long chain of removals,
+            // and the counts depend on everything placed.
+            addConflictsBelow(conflicts, mStackTop);
+        }
+        else
+        {
+            explain(mWipedOut, mSequence.getSymbolMask(), conflicts);
+        }
+    }
+
+    // The stage whose propagation took s out of the cell's domain,
+    // or -1 if it was gone before the search started.
+    int removedBy(int cell, Symbol s) const
+    {
+        SymbolMask after = mDomains[cell];
+        for(size_t entry = mTrail.size(); entry-- > 0; )
+        {
+            const Change& change = mTrail[entry];
+            if(change.kind == kDomainChange && change.index == cell)
+            {
+                SymbolMask before = change.old;
+                if(hasSymbol(before, s) && !hasSymbol(after, s))
+                {
+                    int depth = mStackTop;
+                    while(depth >= 0 && mStack[depth].trailMark > entry)
+                    {
+                        --depth;
+                    }
+                    return depth;
+                }
+                after = before;
+            }
+        }
+        return -1;
+    }
+
+    // The crowded cell is short of symbols because of what it holds, and
+    // because of the symbols that could go next to it used elsewhere.
+    void explainCapacity(std::vector<bool>& conflicts) const
+    {
+        addConflict(conflicts, mDepthOf[mCrowded]);
+        SymbolMask adjacent = mSequence.getAdjacentMask(mValues.atIndex(mCrowded));
+        for(int depth = 0; depth < (int)conflicts.size(); ++depth)
+        {
+            if(hasSymbol(adjacent, mValues.atIndex(mStack[depth].location)))
+            {
+                conflicts[depth] = true;
+            }
+        }
+    }
+
+    // Remember the placements at the stages blamed for a dead end, if
+    // there aren't too many of them. Together they can't be part of
+    // any solution.
+    void recordNogood(const std::vector<bool>& conflicts)
+    {
+        if((int)mNogoods.size() >= kMaxNogoods
+            || std::count(conflicts.begin(), conflicts.end(), true) > kMaxNogoodSize)
+        {
+            return;
+        }
+        if(mNogoodIndex.empty())
+        {
+            mNogoodIndex.resize(mTotalCount * mSymbolRange);
+        }
+        Nogood nogood;
+        for(int depth = 0; depth < (int)conflicts.size(); ++depth)
+        {
+            if(conflicts[depth])
+            {
+                int location = mStack[depth].location;
+                Symbol s = mValues.atIndex(location);
+                nogood.push_back(std::make_pair(location, s));
+                mNogoodIndex[location * mSymbolRange + s].push_back((int)mNogoods.size());
+            }
+        }
+        mNogoods.push_back(nogood);
+    }
+
+    // Checks the nogoods that s at the location would complete, and
+    // blames the stages for the rest of the first one that it does.
+    bool violatesNogood(int location, Symbol s, std::vector<bool>& conflicts) const
+    {
+        if(mNogoodIndex.empty())
+        {
+            return false;
+        }
+        const std::vector<int>& watching = mNogoodIndex[location * mSymbolRange + s];
+        for(size_t i = 0; i < watching.size(); ++i)
+        {
+            const Nogood& nogood = mNogoods[watching[i]];
+            bool complete = true;
+            for(size_t j = 0; complete && j < nogood.size(); ++j)
+            {
+                complete = nogood[j].first == location || mValues.atIndex(nogood[j].first) == nogood[j].second;
+            }
+            if(complete)
+            {
+                for(size_t j = 0; j < nogood.size(); ++j)
+                {
+                    if(nogood[j].first != location)
+                    {
+                        addConflict(conflicts, mDepthOf[nogood[j].first]);
+                    }
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const GridD& mGrid;
+    Topology mTopology;
+    int mTotalCount;
+    const Sequence& mSequence;
+    SearchOptions mOptions;
+    Values mValues;
+    SymbolMask mAvailable;
+    SymbolMask mUsed;
+
+    // Forward checking state: the live domain of every cell, what the
+    // presets left in it, and how many of its neighbours are set.
+    std::vector<SymbolMask> mDomains;
+    std::vector<SymbolMask> mPresetDomains;
+    std::vector<int> mSetNeighbours;
+
+    // Every change the search makes to the values, the symbol masks,
+    // the domains and the set neighbour counts, with what was there
+    // before, so that backtracking just undoes it back to a stage's mark.
+    std::vector<Change> mTrail;
+
+    // Cardinality state: how many of each symbol the sequence allows, how
+    // many unset cells could still hold each one, and a symbol for every
+    // unset cell that fits within the counts.
+    std::vector<int> mSymbolLimits;
+    std::vector<int> mSupply;
+    std::vector<Symbol> mMatch;
+    std::vector<int> mMatchCount;
+    std::vector<bool> mMatchVisited;
+
+    // Arc consistency work queue, and which cells are on it.
+    std::vector<int> mArcQueue;
+    std::vector<bool> mQueued;
+
+    // Chains of corridor cells, each with the cells in order and the
+    // cells just beyond its two ends, the chain each cell is in (or a
+    // negative number), and the symbols reachable in each number of steps
+    // through the sequence.
+    struct Chain
+    {
+        std::vector<int> cells;
+        int ends[2];
+    };
+    std::vector<Chain> mChains;
+    std::vector<int> mChainOf;
+    std::vector< std::vector<SymbolMask> > mWalkReach;
+
+    // Smallest domain first ordering state.
+    enum
+    {
+        kCandidateRebuildFactor = 8
+    };
+    std::vector<Candidate> mCandidates;
+
+    Stages mStack;
+    int mStackTop;
+    int mSearchLocation;
+
+    // Backjumping state: the stage that placed each cell, the depth up
+    // to which the stages are on the path to a solution and so can only
+    // be backtracked over one at a time, the last cell that forward
+    // checking found with no options, and the last set cell found without
+    // enough symbols left for its neighbours.
+    std::vector<int> mDepthOf;
+    int mSolutionDepth;
+    int mWipedOut;
+    int mCrowded;
+
+    // Nogoods are lists of (location, symbol) placements that can't all
+    // be made together, indexed by each of their placements.
+    enum
+    {
+        kMaxNogoodSize = 4,
+        kMaxNogoods = 1 << 16
+    };
+    typedef std::vector< std::pair<int, Symbol> > Nogood;
+    std::vector<Nogood> mNogoods;
+    std::vector< std::vector<int> > mNogoodIndex;
+    int mSymbolRange;
+
+    // How often the monitor is checked, in search steps.
+    enum
+    {
+        kMonitorInterval = 256
+    };
+    SearchMonitor<Dimensions>* mMonitor;
+    int mMonitorCountdown;
+
+    // Restart state: the random order, the rank of each cell when
+    // breaking ties, whether the order is random and whether the search
+    // still restarts, which run it is on and the steps left in the run.
+    enum
+    {
+        kRestartUnit = 1 << 8
+    };
+    std::mt19937 mRandom;
+    std::vector<int> mRank;
+    bool mRandomOrder;
+    bool mRestarting;
+    int mRestart;
+    int mRestartBudget;
+
+    // Symmetry breaking state, with the images of the last
+    // solution found when they are being expanded.
+    std::auto_ptr<Symmetry> mOwnSymmetry;
+    const Symmetry* mSymmetry;
+    std::vector<Values> mImages;
+    int mImage;
+    std::auto_ptr<ValueSymmetry> mValueSymmetry;
+
+    // Island splitting state: whether the search is counting, the count
+    // for the islands last split off, the island each unset cell was in,
+    // and the cells marked on each visit while looking for a split.
+    bool mCounting;
+    SolutionCount mIslandCount;
+    std::vector<int> mIslandOf;
+    std::vector<int> mIslandCells;
+    std::vector<int> mVisited;
+    std::vector<int> mTouching;
+    int mVisit;
+
+    // Remembers what islands came to, when kCacheIslands is on. The
+    // budget is in ints of key and symbol usage, and the kinds keep the
+    // two sorts of answer apart.
+    enum
+    {
+        kIslandCacheSize = 1 << 22,
+        kIslandUsage = 0,
+        kIslandCount = 1
+    };
+    std::auto_ptr<SubproblemCache> mOwnCache;
+    SubproblemCache* mCache;
 };
 
 #endif // SOLVER_GRIDSOLVER_H__INCLUDED
\ No newline at end of file
@@ -22,6 +22,7 @@ namespace
         {
             RUN( gridValues2DTest );
             RUN( gridValues3DTest );
+            RUN( iteratorTest );
         }
 
         void gridValues2DTest()
@@ -86,6 +87,39 @@ namespace
             values.clear(coord(0, 1, 2));
             CHECK(values[coord(0, 1, 2)] == Solver::kUnsetSymbol);
         }
+
+        void iteratorTest()
+        {
+            Solver::Coordinate<2> size(2, 3);
+            GridValues<2> values(size);
+            CHECK(!(values.begin() != values.end()));
+
+            values.place(4, coord(1, 2));
+            values.place(7, coord(0, 1));
+            values.place(4, coord(1, 0));
+            CHECK(values.valueCount() == 3);
+            CHECK(values.symbolCount(4) == 2);
+            CHECK(values.symbolCount(7) == 1);
+            CHECK(values.symbolCount(9) == 0);
+
+            int count = 0;
+            for(GridValues<2>::const_iterator it = values.begin(); it != values.end(); ++it)
+            {
+                CHECK(values[it->first] == it->second);
+                ++count;
+            }
+            CHECK(count == 3);
+
+            values.place(7, coord(1, 2));
+            CHECK(values.symbolCount(4) == 1);
+            CHECK(values.symbolCount(7) == 2);
+            CHECK(values.valueCount() == 3);
+
+            CHECK(values.clear(coord(0, 1)));
+            CHECK(!values.clear(coord(0, 1)));
+            CHECK(values.valueCount() == 2);
+            CHECK(values.getSymbolCounts().size() == 2);
+        }
     };
 }
 
@@ -10,6 +10,8 @@
 #include "Solver/Symbol.h"
 
 #include <unordered_map>
+#include <vector>
+#include <utility>
 #include <assert.h>
 
 #ifdef TRACE
@@ -28,18 +30,81 @@ namespace Solver
 }
 
 // Keeps track of which symbol is in each grid location.
+// The values are kept densely in a linear array in CoordinateOrder,
+// and the symbol counts in an array indexed by symbol, so that the
+// solver's inner loops never need to hash a coordinate.
 template <int Dimensions>
 class Solver::GridValues
 {
 public:
     typedef Coordinate<Dimensions> Coord;
-    typedef std::unordered_map<Coord, Symbol, CoordinateOrder<Dimensions> > Values;
+    typedef std::vector<Symbol> Values;
     typedef std::unordered_map<Symbol, int> SymbolCounts;
-    typedef typename Values::const_iterator const_iterator;
+
+    // Visits the locations which have been set, in coordinate order.
+    class const_iterator
+    {
+    public:
+        typedef std::pair<Coord, Symbol> value_type;
+
+        const_iterator(const GridValues<Dimensions>& values, size_t index)
+            : mValues(&values)
+            , mIndex(index)
+        {
+            skipUnset();
+        }
+
+        const value_type& operator*() const
+        {
+            return mCurrent;
+        }
+
+        const value_type* operator->() const
+        {
+            return &mCurrent;
+        }
+
+        const_iterator& operator++()
+        {
+            ++mIndex;
+            skipUnset();
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return mIndex == other.mIndex;
+        }
+
+        bool operator!=(const const_iterator& other) const
+        {
+            return mIndex != other.mIndex;
+        }
+
+    private:
+        void skipUnset()
+        {
+            const Values& values = mValues->mValues;
+            while(mIndex < values.size() && values[mIndex] == Solver::kUnsetSymbol)
+            {
+                ++mIndex;
+            }
+            if(mIndex < values.size())
+            {
+                mCurrent = value_type(mValues->mOrder.coordinate(mIndex), values[mIndex]);
+            }
+        }
+
+        const GridValues<Dimensions>* mValues;
+        size_t mIndex;
+        value_type mCurrent;
+    };
 
     GridValues(Coord size)
         : mSize(size)
-        , mValues(10, CoordinateOrder<Dimensions>(size))
+        , mOrder(size)
+        , mValues(volume(size), Solver::kUnsetSymbol)
+        , mValueCount(0)
     {
     }
 
@@ -57,72 +122,129 @@ public:
             clear(c);
             return;
         }
+        placeAt(s, (int)mOrder(c));
+    }
 
-        Values::iterator it = mValues.find(c);
-        if(it != mValues.end())
+    bool clear(Coord c)
+    {
+        assert(inVolume(c, mSize));
+        return clearAt((int)mOrder(c));
+    }
+
+    Symbol operator[](Coord c) const
+    {
+        assert(inVolume(c, mSize));
+        return mValues[mOrder(c)];
+    }
+
+    // Access by the linear index of a location in CoordinateOrder,
+    // for code that has already flattened the grid.
+    int indexOf(const Coord& c) const
+    {
+        assert(inVolume(c, mSize));
+        return (int)mOrder(c);
+    }
+
+    Coord locationOf(int index) const
+    {
+        assert(index >= 0 && index < (int)mValues.size());
+        return mOrder.coordinate(index);
+    }
+
+    Symbol atIndex(int index) const
+    {
+        assert(index >= 0 && index < (int)mValues.size());
+        return mValues[index];
+    }
+
+    void placeAt(Symbol s, int index)
+    {
+        assert(index >= 0 && index < (int)mValues.size());
+        assert(s != Solver::kUnsetSymbol);
+
+        Symbol& value = mValues[index];
+        if(value != Solver::kUnsetSymbol)
         {
-            --mCounts[it->second];
-            it->second = s;
+            --mCounts[value];
         }
         else
         {
-            mValues[c] = s;
+            ++mValueCount;
         }
-        ++mCounts[s];
-    }
+        value = s;
 
-    bool clear(Coord c)
-    {
-        Values::iterator it = mValues.find(c);
-        if(it != mValues.end())
+        if(s >= (int)mCounts.size())
         {
-            --mCounts[it->second];
-            mValues.erase(it);
-            return true;
+            mCounts.resize(s + 1, 0);
         }
-        return false;
+        ++mCounts[s];
     }
 
-    Symbol operator[](Coord c) const
+    bool clearAt(int index)
     {
-        Values::const_iterator it = mValues.find(c);
-        if(it != mValues.end())
+        assert(index >= 0 && index < (int)mValues.size());
+
+        Symbol& value = mValues[index];
+        if(value != Solver::kUnsetSymbol)
         {
-            return it->second;
+            --mCounts[value];
+            --mValueCount;
+            value = Solver::kUnsetSymbol;
+            return true;
         }
-        return Solver::kUnsetSymbol;
+        return false;
     }
 
     const_iterator begin() const
     {
-        return mValues.begin();
+        return const_iterator(*this, 0);
     }
 
     const_iterator end() const
     {
-        return mValues.end();
+        return const_iterator(*this, mValues.size());
     }
 
     int valueCount() const
     {
-        return mValues.size();
+        return mValueCount;
     }
 
-    const SymbolCounts& getSymbolCounts() const
+    // Builds a map of the symbols that are currently placed.
+    SymbolCounts getSymbolCounts() const
     {
-        return mCounts;
+        SymbolCounts counts;
+        for(Symbol s = Solver::kFirstSymbol; s < (int)mCounts.size(); ++s)
+        {
+            if(mCounts[s] > 0)
+            {
+                counts[s] = mCounts[s];
+            }
+        }
+        return counts;
     }
 
     int symbolCount(Symbol s) const
     {
-        SymbolCounts::const_iterator found = mCounts.find(s);
-        return found == mCounts.end() ? 0 : found->second;
+        return s < (int)mCounts.size() ? mCounts[s] : 0;
     }
 
 private:
+    static size_t volume(const Coord& size)
+    {
+        size_t total = 1;
+        for(int d = 0; d < Dimensions; ++d)
+        {
+            total *= size[d];
+        }
+        return total;
+    }
+
     Coord mSize;
+    CoordinateOrder<Dimensions> mOrder;
     Values mValues;
-    SymbolCounts mCounts;
+    std::vector<int> mCounts;
+    int mValueCount;
 };
 
 namespace Solver
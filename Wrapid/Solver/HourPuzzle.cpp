@@ -20,8 +20,8 @@ namespace
     const int kRepeats = Solver::kHourPuzzleRepeats;
 }
 
-HourPuzzle::HourPuzzle()
-    : mSolver(new PuzzleSolver<2>(kSize, kSymbols, kRepeats))
+HourPuzzle::HourPuzzle(Solver::SearchOptions options)
+    : mSolver(new PuzzleSolver<2>(kSize, kSymbols, kRepeats, false, options))
 {
 }
 
@@ -44,6 +44,11 @@ Solver::SolveResult HourPuzzle::findNextSolution()
     return mSolver->findNextSolution();
 }
 
+Solver::SolutionCount HourPuzzle::countSolutions(Solver::SolutionCount limit)
+{
+    return mSolver->countSolutions(limit);
+}
+
 void HourPuzzle::print(std::ostream& stream) const
 {
     return mSolver->print(stream);
@@ -65,6 +70,10 @@ namespace
             RUN( solveTest );
             RUN( lessConstrainedTest );
             RUN( freeRegionTest );
+            RUN( smallestDomainTest );
+            RUN( transferCountTest );
+            RUN( treeTest );
+            RUN( diagramTest );
         }
 
         void solveTest()
@@ -153,6 +162,108 @@ namespace
 
             testSolver<HourPuzzle>(puzzle, target, 4, 5);
         }
+
+        void smallestDomainTest()
+        {
+            const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+
+            std::string target(
+                "+----+----+----+----+----+----+\n"
+                "| 12 |  7    6    5 |  8    7 |\n"
+                "+    +    +----+    +----+    +\n"
+                "| 11 |  8 |  1 |  4    5    6 |\n"
+                "+    +    +    +----+----+----+\n"
+                "| 10    9 |  2    3    4    3 |\n"
+                "+----+    +----+----+----+    +\n"
+                "|  9   10   11   12    1    2 |\n"
+                "+----+----+----+----+----+----+\n"
+            );
+
+            testSolver<HourPuzzle>(puzzle, target, 48, 50, false, Solver::kSmallestDomainFirst);
+        }
+
+        void transferCountTest()
+        {
+            const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+
+            HourPuzzle solver(Solver::kTransferCount);
+            CHECK_ASSERT(solver.parse(puzzle) == Solver::kParseSucceed);
+            CHECK(solver.countSolutions() == 48);
+            CHECK(solver.countSolutions(2) == 2);
+        }
+
+        void treeTest()
+        {
+            const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+
+            HourPuzzle counter(Solver::kTreeDecomposition);
+            CHECK_ASSERT(counter.parse(puzzle) == Solver::kParseSucceed);
+            CHECK(counter.countSolutions() == 48);
+
+            // Only the one solution is found from the tables.
+            HourPuzzle solver(Solver::kTreeDecomposition | Solver::kFirstSolutionOnly);
+            CHECK_ASSERT(solver.parse(puzzle) == Solver::kParseSucceed);
+            CHECK(solver.findNextSolution() == Solver::kFoundSolution);
+            CHECK(solver.findNextSolution() == Solver::kNoSolution);
+        }
+
+        void diagramTest()
+        {
+            const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+
+            HourPuzzle counter(Solver::kSolutionDiagram);
+            CHECK_ASSERT(counter.parse(puzzle) == Solver::kParseSucceed);
+            CHECK(counter.countSolutions() == 48);
+
+            HourPuzzle solver(Solver::kSolutionDiagram | Solver::kFirstSolutionOnly);
+            CHECK_ASSERT(solver.parse(puzzle) == Solver::kParseSucceed);
+            int found = 0;
+            while(solver.findNextSolution() == Solver::kFoundSolution)
+            {
+                ++found;
+            }
+            CHECK(found == 48);
+        }
     };
 }
 
@@ -9,6 +9,7 @@
 #include "Solver/Symbol.h"
 #include "Solver/SolveResult.h"
 #include "Solver/ParseResult.h"
+#include "Solver/SearchOptions.h"
 
 #include <vector>
 #include <iostream>
@@ -26,7 +27,7 @@ class Solver::HourPuzzle
 {
     PREVENT_COPY_AND_ASSIGNMENT(HourPuzzle);
 public:
-    HourPuzzle();
+    explicit HourPuzzle(SearchOptions options = SearchOptions());
     ~HourPuzzle();
 
     // See HourPuzzleIO for required format.
@@ -35,6 +36,9 @@ public:
 
     SolveResult findNextSolution();
 
+    // Count the solutions, up to the limit if it isn't zero.
+    SolutionCount countSolutions(SolutionCount limit = 0);
+
     void print(std::ostream& stream) const;
 
 private:
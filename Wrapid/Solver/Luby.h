@@ -0,0 +1,36 @@
+#pragma once
+#ifndef SOLVER_LUBY_H__INCLUDED
+#define SOLVER_LUBY_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+namespace Solver
+{
+    // The index'th term of the Luby sequence, counting from zero:
+    // 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+    // Searches that restart use it for how long each run may go on.
+    inline int lubyTerm(int index)
+    {
+        // Find the smallest run of the sequence that reaches the index,
+        // which is two copies of the run before it and then its last
+        // term. Anything short of the end is in one of the copies.
+        int size = 1;
+        int term = 1;
+        while(size < index + 1)
+        {
+            size = 2 * size + 1;
+            term *= 2;
+        }
+        while(size - 1 != index)
+        {
+            size = (size - 1) / 2;
+            term /= 2;
+            index = index % size;
+        }
+        return term;
+    }
+}
+
+#endif // SOLVER_LUBY_H__INCLUDED
@@ -0,0 +1,130 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/ParallelSolver.h"
+
+#ifdef BUILD_TESTS
+
+#include "Solver/SolverTest.h"
+#include "Solver/HourPuzzleIO.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace Solver;
+
+namespace
+{
+    class ParallelSolverTest : public Solver::SolverTest
+    {
+    public:
+        void run()
+        {
+            RUN( allSolutionsTest );
+            RUN( firstSolutionTest );
+            RUN( noSolutionTest );
+            RUN( countTest );
+            RUN( symmetryTest );
+        }
+
+        static const char** lessConstrained()
+        {
+            static const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+            return puzzle;
+        }
+
+        void allSolutionsTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            CHECK_ASSERT(parse(grid, presets, asStrings(lessConstrained(), grid.getSize())) == kParseSucceed);
+            Sequence symbols(12, 2);
+
+            CHECK(checkSameSolutionSet<ParallelSolver>(grid, symbols, presets, SearchOptions(0, 4)) == 48);
+            CHECK(checkSameSolutionSet<ParallelSolver>(grid, symbols, presets, SearchOptions(kArcConsistency | kSmallestDomainFirst, 3)) == 48);
+            CHECK(checkSameSolutionSet<ParallelSolver>(grid, symbols, presets, SearchOptions(kForwardChecking | kRecordNogoods, 4)) == 48);
+        }
+
+        void firstSolutionTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            CHECK_ASSERT(parse(grid, presets, asStrings(lessConstrained(), grid.getSize())) == kParseSucceed);
+            Sequence symbols(12, 2);
+
+            Boards expected = searchAll(grid, symbols, presets);
+
+            ParallelSolver<2> parallel(grid, symbols, SearchOptions(kFirstSolutionOnly, 4));
+            parallel.addPresets(presets);
+            CHECK_ASSERT(parallel.nextSolution() == kFoundSolution);
+            Board first = asBoard(parallel.getSolution());
+            CHECK(std::binary_search(expected.begin(), expected.end(), first));
+            CHECK(parallel.nextSolution() == kNoSolution);
+        }
+
+        void noSolutionTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            presets.place(1, coord(0, 0));
+            presets.place(6, coord(0, 2));
+            presets.place(1, coord(2, 1));
+            presets.place(6, coord(1, 1));
+            Sequence symbols(12, 2);
+
+            ParallelSolver<2> parallel(grid, symbols, SearchOptions(kForwardChecking, 4));
+            parallel.addPresets(presets);
+            CHECK(parallel.nextSolution() == kNoSolution);
+        }
+
+        void countTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            CHECK_ASSERT(parse(grid, presets, asStrings(lessConstrained(), grid.getSize())) == kParseSucceed);
+            Sequence symbols(12, 2);
+
+            ParallelSolver<2> all(grid, symbols, SearchOptions(0, 4));
+            all.addPresets(presets);
+            CHECK(all.countSolutions(0) == 48);
+
+            ParallelSolver<2> unique(grid, symbols, SearchOptions(kForwardChecking, 4));
+            unique.addPresets(presets);
+            CHECK(unique.countSolutions(2) == 2);
+        }
+
+        void symmetryTest()
+        {
+            // See GridSolverTest::symmetryTest.
+            Grid2D band(coord(6, 2));
+            Sequence symbols(4, 3);
+            GridValues2D presets(band.getSize());
+
+            ParallelSolver<2> broken(band, symbols, SearchOptions(kBreakSymmetry, 4));
+            broken.addPresets(presets);
+            CHECK(broken.countSolutions(0) == 38);
+
+            GridSolver<2> plain(band, symbols);
+            plain.addPresets(presets);
+            ParallelSolver<2> expanded(band, symbols, SearchOptions(kExpandSymmetry, 4));
+            expanded.addPresets(presets);
+            CHECK(allSolutions(expanded) == allSolutions(plain));
+        }
+    };
+}
+
+DECLARE_TEST( ParallelSolverTest );
+
+#endif // BUILD_TESTS
@@ -0,0 +1,447 @@
+#pragma once
+#ifndef SOLVER_PARALLELSOLVER_H__INCLUDED
+#define SOLVER_PARALLELSOLVER_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridSolver.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/SearchMonitor.h"
+#include "Solver/Symmetry.h"
+#include "Solver/Topology.h"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class ParallelSolver;
+}
+
+// Runs a GridSolver search on several threads at once.
+//
+// The work is handed out as tasks, each of which is a partial solution
+// to be completed by its own GridSolver. Every worker keeps a queue of
+// tasks, taking the newest from its own and stealing the oldest from
+// the others when it runs out. The search starts as a single task, and
+// whenever a worker is left idle, a busy one splits its search at the
+// shallowest stage that still has options, and queues them as new tasks.
+//
+// Solutions come out in no particular order. With kFirstSolutionOnly
+// everything stops once one is found, otherwise all of them are passed
+// on, with the workers waiting if too many are held up. When counting,
+// the workers just add up what their searches find.
+//
+// When breaking symmetry, the symmetries are found once from the presets
+// and shared, so that every worker keeps the same solution out of each set.
+template <int Dimensions>
+class Solver::ParallelSolver : public Solver::SolveEngine<Dimensions>
+{
+    PREVENT_COPY_AND_ASSIGNMENT(ParallelSolver);
+public:
+    typedef Grid<Dimensions> GridD;
+    typedef GridValues<Dimensions> Values;
+
+    ParallelSolver(const GridD& grid, const Sequence& sequence, SearchOptions options)
+        : mGrid(grid)
+        , mSequence(sequence)
+        , mOptions(options)
+        , mPresets(grid.getSize())
+        , mSolution(grid.getSize())
+        , mBusy(0)
+        , mRunning(0)
+        , mFinished(false)
+        , mCounting(false)
+        , mCountLimit(0)
+        , mCount(0)
+        , mCancelled(false)
+        , mHungry(0)
+        , mQueued(0)
+    {
+        mOptions.threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+        if(mOptions.threads < 1)
+        {
+            mOptions.threads = 1;
+        }
+    }
+
+    ~ParallelSolver()
+    {
+        stop();
+    }
+
+    void addPresets(const Values& values)
+    {
+        // Don't allow adding presets after the solve has started.
+        assert(mThreads.empty());
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
+        {
+            mPresets.place(it->second, it->first);
+        }
+    }
+
+    SolveResult nextSolution()
+    {
+        if(mPresets.valueCount() == mGrid.getTotalSize())
+        {
+            mSolution = mPresets;
+            return kAlreadySolved;
+        }
+        if(mThreads.empty())
+        {
+            start();
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(mSolutions.empty() && !mFinished)
+        {
+            mSolutionReady.wait(lock);
+        }
+        if(mSolutions.empty())
+        {
+            return kNoSolution;
+        }
+        mSolution = mSolutions.front();
+        mSolutions.pop_front();
+        mSpaceReady.notify_one();
+        return kFoundSolution;
+    }
+
+    SolutionCount countSolutions(SolutionCount limit = 0)
+    {
+        if(mPresets.valueCount() == mGrid.getTotalSize())
+        {
+            return 1;
+        }
+        assert(mThreads.empty());
+        mCounting = true;
+        mCountLimit = limit;
+        start();
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while(!mFinished)
+            {
+                mSolutionReady.wait(lock);
+            }
+        }
+        stop();
+        return (limit != 0 && mCount > limit) ? limit : mCount;
+    }
+
+    const Values& getSolution() const
+    {
+        return mSolution;
+    }
+
+private:
+    // Each worker is the monitor for the searches it runs.
+    class Worker : public SearchMonitor<Dimensions>
+    {
+    public:
+        Worker(ParallelSolver& owner, int index)
+            : mOwner(owner)
+            , mIndex(index)
+        {
+        }
+
+        bool shouldStop()
+        {
+            return mOwner.mCancelled;
+        }
+
+        // Only split when there are more idle workers than queued tasks.
+        bool wantsWork()
+        {
+            return mOwner.mHungry > mOwner.mQueued;
+        }
+
+        void takeWork(const Values& partial)
+        {
+            mOwner.addTask(mIndex, partial);
+        }
+
+    private:
+        ParallelSolver& mOwner;
+        int mIndex;
+    };
+
+    typedef std::deque<Values> Tasks;
+
+    enum
+    {
+        // Workers wait when this many solutions haven't been collected.
+        kMaxHeldSolutions = 64
+    };
+
+    void start()
+    {
+        if(mOptions.has(kBreakSymmetry) || mOptions.has(kExpandSymmetry))
+        {
+            Topology topology(mGrid);
+            mSymmetry = std::auto_ptr<Symmetry>(new Symmetry(mGrid, topology, mPresets));
+        }
+
+        int count = mOptions.threads;
+        mQueues.resize(count);
+        mQueues[0].push_back(mPresets);
+        mQueued = 1;
+        mRunning = count;
+
+        mWorkers.reserve(count);
+        for(int i = 0; i < count; ++i)
+        {
+            mWorkers.push_back(Worker(*this, i));
+        }
+        for(int i = 0; i < count; ++i)
+        {
+            mThreads.push_back(std::thread(&ParallelSolver::work, this, i));
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            cancel();
+        }
+        for(size_t i = 0; i < mThreads.size(); ++i)
+        {
+            mThreads[i].join();
+        }
+        mThreads.clear();
+    }
+
+    // Call with the lock held.
+    void cancel()
+    {
+        mCancelled = true;
+        mWorkReady.notify_all();
+        mSpaceReady.notify_all();
+    }
+
+    void work(int index)
+    {
+        Values task(mGrid.getSize());
+        while(takeTask(index, task))
+        {
+            if(task.valueCount() == mGrid.getTotalSize())
+            {
+                completeTask(task);
+                finishTask();
+                continue;
+            }
+
+            GridSolver<Dimensions> solver(mGrid, mSequence, mOptions);
+            solver.addPresets(task);
+            solver.setMonitor(&mWorkers[index]);
+            solver.setSymmetry(mSymmetry.get());
+            if(mCounting)
+            {
+                countTask(solver);
+            }
+            else
+            {
+                solveTask(solver);
+            }
+            finishTask();
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(--mRunning == 0)
+        {
+            mFinished = true;
+            mSolutionReady.notify_all();
+        }
+    }
+
+    // A task split off from the last stage of another search is already
+    // a solution, but hasn't been checked against the symmetries yet.
+    void completeTask(const Values& task)
+    {
+        std::vector<Values> solutions;
+        if(mSymmetry.get() == NULLPTR)
+        {
+            solutions.push_back(task);
+        }
+        else if(mSymmetry->allows(task))
+        {
+            if(mOptions.has(kExpandSymmetry))
+            {
+                mSymmetry->images(task, solutions);
+            }
+            else
+            {
+                solutions.push_back(task);
+            }
+        }
+
+        if(mCounting)
+        {
+            addCount(solutions.size());
+            return;
+        }
+        for(size_t i = 0; i < solutions.size(); ++i)
+        {
+            if(!addSolution(solutions[i]))
+            {
+                break;
+            }
+        }
+    }
+
+    void solveTask(GridSolver<Dimensions>& solver)
+    {
+        SolveResult result = solver.nextSolution();
+        while(result == kFoundSolution && addSolution(solver.getSolution()))
+        {
+            result = solver.nextSolution();
+        }
+    }
+
+    void countTask(GridSolver<Dimensions>& solver)
+    {
+        SolutionCount found = solver.countNextSolutions();
+        while(found > 0 && addCount(found))
+        {
+            found = solver.countNextSolutions();
+        }
+    }
+
+    bool takeTask(int index, Values& task)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for(;;)
+        {
+            if(mCancelled)
+            {
+                return false;
+            }
+
+            // Newest first from our own queue, since it's the smallest and
+            // the closest to what we were doing, then the oldest from others.
+            int count = (int)mQueues.size();
+            if(!mQueues[index].empty())
+            {
+                task = mQueues[index].back();
+                mQueues[index].pop_back();
+            }
+            else
+            {
+                int victim = (index + 1) % count;
+                while(victim != index && mQueues[victim].empty())
+                {
+                    victim = (victim + 1) % count;
+                }
+                if(victim == index)
+                {
+                    if(mBusy == 0)
+                    {
+                        // Nobody is left to split their search, so we're done.
+                        mWorkReady.notify_all();
+                        return false;
+                    }
+                    ++mHungry;
+                    mWorkReady.wait(lock);
+                    --mHungry;
+                    continue;
+                }
+                task = mQueues[victim].front();
+                mQueues[victim].pop_front();
+            }
+            --mQueued;
+            ++mBusy;
+            return true;
+        }
+    }
+
+    void addTask(int index, const Values& partial)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueues[index].push_back(partial);
+        ++mQueued;
+        mWorkReady.notify_one();
+    }
+
+    void finishTask()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(--mBusy == 0 && mQueued == 0)
+        {
+            mWorkReady.notify_all();
+        }
+    }
+
+    // Returns false if the search should stop.
+    bool addSolution(const Values& solution)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(!mCancelled && (int)mSolutions.size() >= kMaxHeldSolutions)
+        {
+            mSpaceReady.wait(lock);
+        }
+        if(mCancelled)
+        {
+            return false;
+        }
+        mSolutions.push_back(solution);
+        mSolutionReady.notify_one();
+        if(mOptions.has(kFirstSolutionOnly))
+        {
+            cancel();
+            return false;
+        }
+        return true;
+    }
+
+    // Returns false once the count has reached the limit.
+    bool addCount(SolutionCount found)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCount += found;
+        if(mCountLimit != 0 && mCount >= mCountLimit)
+        {
+            cancel();
+            return false;
+        }
+        return true;
+    }
+
+    const GridD& mGrid;
+    const Sequence& mSequence;
+    SearchOptions mOptions;
+    Values mPresets;
+    Values mSolution;
+
+    std::auto_ptr<Symmetry> mSymmetry;
+    std::vector<Worker> mWorkers;
+    std::vector<std::thread> mThreads;
+
+    // Everything below is shared between the threads, and guarded by
+    // the mutex apart from the atomics that the workers poll.
+    std::mutex mMutex;
+    std::condition_variable mWorkReady;
+    std::condition_variable mSolutionReady;
+    std::condition_variable mSpaceReady;
+    std::vector<Tasks> mQueues;
+    Tasks mSolutions;
+    int mBusy;
+    int mRunning;
+    bool mFinished;
+    bool mCounting;
+    SolutionCount mCountLimit;
+    SolutionCount mCount;
+    std::atomic<bool> mCancelled;
+    std::atomic<int> mHungry;
+    std::atomic<int> mQueued;
+};
+
+#endif // SOLVER_PARALLELSOLVER_H__INCLUDED
@@ -7,6 +7,13 @@
  * --------------------------------------------------------------- */
 
 #include "Solver\GridSolver.h"
+#include "Solver\ParallelSolver.h"
+#include "Solver\SatEngine.h"
+#include "Solver\ComponentSolver.h"
+#include "Solver\CutSolver.h"
+#include "Solver\TransferCounter.h"
+#include "Solver\SolutionDiagram.h"
+#include "Solver\TreeSolver.h"
 #include "Solver\PuzzleIOUtils.h"
 
 namespace Solver
@@ -16,9 +23,16 @@ namespace Solver
     {
         PREVENT_COPY_AND_ASSIGNMENT(PuzzleSolver);
     public:
-        PuzzleSolver(Coordinate<Dimensions> size, int symbols, int repeats, bool includeJoker = false)
+        PuzzleSolver(
+            Coordinate<Dimensions> size,
+            int symbols,
+            int repeats,
+            bool includeJoker = false,
+            SearchOptions options = SearchOptions()
+        )
             : mGrid(size)
             , mSequence(symbols, repeats)
+            , mOptions(options)
             , mIsSolution(false)
         {
             if(includeJoker)
@@ -42,9 +56,54 @@ namespace Solver
             ParseResult result = Solver::parse(mGrid, values, puzzle);
             if(result == Solver::kParseSucceed)
             {
-                mSolver = std::auto_ptr< GridSolver<Dimensions> >(
-                    new GridSolver<Dimensions>(mGrid, mSequence)
-                );
+                if(mOptions.has(kSatBackend))
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new SatEngine<Dimensions>(mGrid, mSequence)
+                    );
+                }
+                else if(mOptions.has(kTransferCount))
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new TransferCounter<Dimensions>(mGrid, mSequence, mOptions)
+                    );
+                }
+                else if(mOptions.has(kSolutionDiagram))
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new SolutionDiagram<Dimensions>(mGrid, mSequence, mOptions)
+                    );
+                }
+                else if(mOptions.has(kSplitComponents))
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new ComponentSolver<Dimensions>(mGrid, mSequence, mOptions)
+                    );
+                }
+                else if(mOptions.has(kCutJoin))
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new CutSolver<Dimensions>(mGrid, mSequence, mOptions)
+                    );
+                }
+                else if(TreeSolver<Dimensions>::suits(mGrid, values, mOptions))
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new TreeSolver<Dimensions>(mGrid, mSequence, mOptions)
+                    );
+                }
+                else if(mOptions.isParallel())
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new ParallelSolver<Dimensions>(mGrid, mSequence, mOptions)
+                    );
+                }
+                else
+                {
+                    mSolver = std::auto_ptr< SolveEngine<Dimensions> >(
+                        new GridSolver<Dimensions>(mGrid, mSequence, mOptions)
+                    );
+                }
 
                 mSolver->addPresets(values);
             }
@@ -57,6 +116,13 @@ namespace Solver
             return mSolver->nextSolution();
         }
 
+        // Count the solutions, up to the limit if it isn't zero.
+        Solver::SolutionCount countSolutions(Solver::SolutionCount limit = 0)
+        {
+            assert(mSolver.get() != NULLPTR);
+            return mSolver->countSolutions(limit);
+        }
+
         void print(std::ostream& stream) const
         {
             assert(mSolver.get() != NULLPTR);
@@ -70,8 +136,9 @@ namespace Solver
     private:
         Grid<Dimensions> mGrid;
         Sequence mSequence;
+        SearchOptions mOptions;
         bool mIsSolution;
-        std::auto_ptr< GridSolver<Dimensions> > mSolver;
+        std::auto_ptr< SolveEngine<Dimensions> > mSolver;
     };
 }
 
@@ -0,0 +1,128 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/SatEngine.h"
+
+#ifdef BUILD_TESTS
+
+#include "Solver/SolverTest.h"
+#include "Solver/HourPuzzleIO.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace Solver;
+
+namespace
+{
+    class SatEngineTest : public Solver::SolverTest
+    {
+    public:
+        void run()
+        {
+            RUN( solve2DTest );
+            RUN( countTest );
+            RUN( solve3DTest );
+            RUN( noSolutionTest );
+            RUN( alreadySolvedTest );
+        }
+
+        void solve2DTest()
+        {
+            static const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            CHECK_ASSERT(parse(grid, presets, asStrings(puzzle, grid.getSize())) == kParseSucceed);
+            Sequence symbols(12, 2);
+
+            // The SAT backend finds the solutions in its own order, so
+            // compare them as a set with the backtracker's.
+            SatEngine<2> sat(grid, symbols);
+            sat.addPresets(presets);
+            Boards found = allSolutions(sat);
+            CHECK(found.size() == 48);
+            CHECK(found == searchAll(grid, symbols, presets));
+        }
+
+        void countTest()
+        {
+            // See GridSolverTest::symmetryTest.
+            Grid2D band(coord(6, 2));
+            Sequence symbols(4, 3);
+            SatEngine<2> sat(band, symbols);
+            CHECK(sat.countSolutions(0) == 800);
+
+            SatEngine<2> limited(band, symbols);
+            CHECK(limited.countSolutions(10) == 10);
+        }
+
+        void solve3DTest()
+        {
+            Grid<3> grid(coord(2, 2, 3));
+            grid.unwrap(2);
+            Sequence symbols(4, 3);
+            GridValues<3> presets(grid.getSize());
+            presets.place(1, coord(0, 0, 0));
+
+            Boards expected = searchAll(grid, symbols, presets);
+            CHECK(expected.size() == 200);
+
+            SatEngine<3> sat(grid, symbols);
+            sat.addPresets(presets);
+            CHECK(allSolutions(sat) == expected);
+        }
+
+        void noSolutionTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            presets.place(1, coord(0, 0));
+            presets.place(6, coord(0, 2));
+            presets.place(1, coord(2, 1));
+            presets.place(6, coord(1, 1));
+            Sequence symbols(12, 2);
+
+            SatEngine<2> sat(grid, symbols);
+            sat.addPresets(presets);
+            CHECK(sat.nextSolution() == kNoSolution);
+
+            // Too many of one symbol.
+            SatEngine<2> overused(grid, symbols);
+            GridValues2D threes(grid.getSize());
+            threes.place(3, coord(0, 0));
+            threes.place(3, coord(2, 0));
+            threes.place(3, coord(0, 3));
+            overused.addPresets(threes);
+            CHECK(overused.nextSolution() == kNoSolution);
+        }
+
+        void alreadySolvedTest()
+        {
+            Grid2D band(coord(6, 2));
+            Sequence symbols(4, 3);
+            SatEngine<2> sat(band, symbols);
+            CHECK_ASSERT(sat.nextSolution() == kFoundSolution);
+
+            SatEngine<2> solved(band, symbols);
+            solved.addPresets(sat.getSolution());
+            CHECK(solved.nextSolution() == kAlreadySolved);
+            CHECK(solved.countSolutions(0) == 1);
+        }
+    };
+}
+
+DECLARE_TEST( SatEngineTest );
+
+#endif // BUILD_TESTS
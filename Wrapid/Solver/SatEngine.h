@@ -0,0 +1,306 @@
+#pragma once
+#ifndef SOLVER_SATENGINE_H__INCLUDED
+#define SOLVER_SATENGINE_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridValues.h"
+#include "Solver/Grid.h"
+#include "Solver/Topology.h"
+#include "Solver/Sequence.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/SatSolver.h"
+
+#include <vector>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class SatEngine;
+}
+
+// Solves grid puzzles by encoding them as CNF for the SatSolver, rather
+// than searching the grid directly. There is a variable for each cell
+// and symbol, saying the cell holds that symbol, and clauses for:
+//  - every cell holding exactly one symbol,
+//  - a symbol only being next to symbols adjacent to it in the sequence,
+//    across every open wall,
+//  - no symbol being used more often than the sequence allows (with a
+//    sequential counter), and
+//  - the presets.
+// Each solution found is blocked with a clause before looking for the
+// next one. None of the SearchOptions apply.
+template <int Dimensions>
+class Solver::SatEngine : public Solver::SolveEngine<Dimensions>
+{
+    PREVENT_COPY_AND_ASSIGNMENT(SatEngine);
+public:
+    typedef Grid<Dimensions> GridD;
+    typedef Coordinate<Dimensions> Coord;
+    typedef GridValues<Dimensions> Values;
+
+    SatEngine(const GridD& grid, const Sequence& sequence)
+        : mTopology(grid)
+        , mSequence(sequence)
+        , mValues(grid.getSize())
+        , mEncoded(false)
+        , mFound(false)
+    {
+        Sequence::SymbolSet symbols = sequence.getSymbols();
+        mSymbols.assign(symbols.begin(), symbols.end());
+    }
+
+    // Set the initial values on the grid prior to solve.
+    void addPreset(Symbol s, Coord location)
+    {
+        assert(!mEncoded);
+        mValues.place(s, location);
+    }
+
+    void addPresets(const Values& values)
+    {
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
+        {
+            addPreset(it->second, it->first);
+        }
+    }
+
+    SolveResult nextSolution()
+    {
+        if(!mEncoded)
+        {
+            if(mValues.valueCount() == mTopology.cellCount())
+            {
+                return kAlreadySolved;
+            }
+            encode();
+        }
+        else if(mFound)
+        {
+            blockSolution();
+        }
+
+        mFound = mSat.solve();
+        if(!mFound)
+        {
+            return kNoSolution;
+        }
+        for(int cell = 0; cell < mTopology.cellCount(); ++cell)
+        {
+            for(int i = 0; i < (int)mSymbols.size(); ++i)
+            {
+                if(mSat.value(variable(cell, i)))
+                {
+                    mValues.placeAt(mSymbols[i], cell);
+                }
+            }
+        }
+        return kFoundSolution;
+    }
+
+    SolutionCount countSolutions(SolutionCount limit = 0)
+    {
+        if(!mEncoded && mValues.valueCount() == mTopology.cellCount())
+        {
+            return 1;
+        }
+        SolutionCount count = 0;
+        while(nextSolution() == kFoundSolution)
+        {
+            ++count;
+            if(limit != 0 && count >= limit)
+            {
+                break;
+            }
+        }
+        return count;
+    }
+
+    const GridValues<Dimensions>& getSolution() const
+    {
+        return mValues;
+    }
+
+private:
+    typedef SatSolver::Clause Clause;
+
+    int variable(int cell, int symbolIndex) const
+    {
+        return 1 + cell * (int)mSymbols.size() + symbolIndex;
+    }
+
+    int indexOf(Symbol s) const
+    {
+        for(int i = 0; i < (int)mSymbols.size(); ++i)
+        {
+            if(mSymbols[i] == s)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void encode()
+    {
+        mEncoded = true;
+        int cellCount = mTopology.cellCount();
+        int symbolCount = (int)mSymbols.size();
+        for(int v = 0; v < cellCount * symbolCount; ++v)
+        {
+            mSat.newVariable();
+        }
+
+        mIsPreset.assign(cellCount, false);
+        for(int cell = 0; cell < cellCount; ++cell)
+        {
+            encodeCell(cell);
+            Symbol preset = mValues.atIndex(cell);
+            if(preset != Solver::kUnsetSymbol)
+            {
+                mIsPreset[cell] = true;
+                int i = indexOf(preset);
+                Clause unit;
+                if(i >= 0)
+                {
+                    unit.push_back(variable(cell, i));
+                }
+                // A symbol that isn't in the sequence can't be satisfied.
+                mSat.addClause(unit);
+            }
+        }
+        for(int i = 0; i < symbolCount; ++i)
+        {
+            encodeCount(i);
+        }
+    }
+
+    // Exactly one symbol, and each symbol only next to ones it is
+    // adjacent to in the sequence.
+    void encodeCell(int cell)
+    {
+        int symbolCount = (int)mSymbols.size();
+        Clause any;
+        for(int i = 0; i < symbolCount; ++i)
+        {
+            any.push_back(variable(cell, i));
+            for(int j = i + 1; j < symbolCount; ++j)
+            {
+                addClause(-variable(cell, i), -variable(cell, j));
+            }
+        }
+        mSat.addClause(any);
+
+        Topology::const_iterator end = mTopology.end(cell);
+        for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+        {
+            for(int i = 0; i < symbolCount; ++i)
+            {
+                SymbolMask adjacent = mSequence.getAdjacentMask(mSymbols[i]);
+                Clause supported;
+                supported.push_back(-variable(cell, i));
+                for(int j = 0; j < symbolCount; ++j)
+                {
+                    if(hasSymbol(adjacent, mSymbols[j]))
+                    {
+                        supported.push_back(variable(*n, j));
+                    }
+                }
+                mSat.addClause(supported);
+            }
+        }
+    }
+
+    // At most count(s) cells hold the symbol, using Sinz's sequential
+    // counter: counter[c][k] is true if at least k + 1 of the cells up
+    // to c hold it.
+    void encodeCount(int symbolIndex)
+    {
+        int cellCount = mTopology.cellCount();
+        int limit = mSequence.count(mSymbols[symbolIndex]);
+        if(limit >= cellCount)
+        {
+            return;
+        }
+        if(limit == 0)
+        {
+            for(int cell = 0; cell < cellCount; ++cell)
+            {
+                addClause(-variable(cell, symbolIndex));
+            }
+            return;
+        }
+
+        std::vector< std::vector<int> > counter(cellCount - 1, std::vector<int>(limit));
+        for(int cell = 0; cell < cellCount - 1; ++cell)
+        {
+            for(int k = 0; k < limit; ++k)
+            {
+                counter[cell][k] = mSat.newVariable();
+            }
+        }
+
+        addClause(-variable(0, symbolIndex), counter[0][0]);
+        for(int k = 1; k < limit; ++k)
+        {
+            addClause(-counter[0][k]);
+        }
+        for(int cell = 1; cell < cellCount - 1; ++cell)
+        {
+            int x = variable(cell, symbolIndex);
+            addClause(-x, counter[cell][0]);
+            addClause(-counter[cell - 1][0], counter[cell][0]);
+            for(int k = 1; k < limit; ++k)
+            {
+                addClause(-x, -counter[cell - 1][k - 1], counter[cell][k]);
+                addClause(-counter[cell - 1][k], counter[cell][k]);
+            }
+            addClause(-x, -counter[cell - 1][limit - 1]);
+        }
+        addClause(-variable(cellCount - 1, symbolIndex), -counter[cellCount - 2][limit - 1]);
+    }
+
+    // Rule out the solution just found. Presets can't change, so
+    // only the other cells need to be different.
+    void blockSolution()
+    {
+        Clause block;
+        for(int cell = 0; cell < mTopology.cellCount(); ++cell)
+        {
+            if(!mIsPreset[cell])
+            {
+                block.push_back(-variable(cell, indexOf(mValues.atIndex(cell))));
+            }
+        }
+        mSat.addClause(block);
+    }
+
+    void addClause(int a, int b = 0, int c = 0)
+    {
+        Clause clause;
+        clause.push_back(a);
+        if(b != 0)
+        {
+            clause.push_back(b);
+        }
+        if(c != 0)
+        {
+            clause.push_back(c);
+        }
+        mSat.addClause(clause);
+    }
+
+    Topology mTopology;
+    const Sequence& mSequence;
+    std::vector<Symbol> mSymbols;
+    Values mValues;
+    std::vector<bool> mIsPreset;
+    SatSolver mSat;
+    bool mEncoded;
+    bool mFound;
+};
+
+#endif // SOLVER_SATENGINE_H__INCLUDED
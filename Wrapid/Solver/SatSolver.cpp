@@ -0,0 +1,752 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/SatSolver.h"
+#include "Solver/Luby.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdlib.h>
+
+using Solver::SatSolver;
+
+namespace
+{
+    // Conflicts per unit of the Luby sequence between restarts.
+    const double kRestartBase = 100.0;
+
+    const double kVariableDecay = 0.95;
+    const double kClauseDecay = 0.999;
+
+    // Learnt clauses allowed, as a fraction of the problem clauses, to
+    // start with, and how much that grows by each time they are cut back.
+    const double kLearntFraction = 1.0 / 3.0;
+    const double kMinLearnts = 1000.0;
+    const double kLearntGrowth = 1.1;
+}
+
+SatSolver::SatSolver()
+    : mOk(true)
+    , mLearntCount(0)
+    , mMaxLearnts(0.0)
+    , mPropagated(0)
+    , mVariableIncrement(1.0)
+    , mClauseIncrement(1.0)
+    , mConflicts(0)
+{
+}
+
+SatSolver::~SatSolver()
+{
+}
+
+int SatSolver::newVariable()
+{
+    int variable = (int)mAssigns.size();
+    mAssigns.push_back(0);
+    mLevels.push_back(0);
+    mReasons.push_back(-1);
+    mPhases.push_back(false);
+    mActivity.push_back(0.0);
+    mSeen.push_back(0);
+    mHeapIndex.push_back(-1);
+    mWatches.resize(mWatches.size() + 2);
+    heapInsert(variable);
+    return variable + 1;
+}
+
+bool SatSolver::addClause(const Clause& clause)
+{
+    if(!mOk)
+    {
+        return false;
+    }
+    cancelUntil(0);
+
+    std::vector<int> lits;
+    for(Clause::const_iterator l = clause.begin(); l != clause.end(); ++l)
+    {
+        assert(*l != 0 && abs(*l) <= variableCount());
+        lits.push_back(toIndex(*l));
+    }
+    std::sort(lits.begin(), lits.end());
+
+    // Drop repeats and literals already false, and the whole clause if
+    // it is already true or has a literal and its negation (adjacent
+    // once sorted).
+    std::vector<int> kept;
+    int last = -1;
+    for(size_t i = 0; i < lits.size(); ++i)
+    {
+        int lit = lits[i];
+        if(valueOf(lit) == 1 || (last >= 0 && lit == (last ^ 1)))
+        {
+            return true;
+        }
+        if(lit != last && valueOf(lit) == 0)
+        {
+            kept.push_back(lit);
+        }
+        last = lit;
+    }
+
+    if(kept.empty())
+    {
+        mOk = false;
+    }
+    else if(kept.size() == 1)
+    {
+        assign(kept[0], -1);
+        mOk = propagate() < 0;
+    }
+    else
+    {
+        attachClause(kept, false);
+    }
+    return mOk;
+}
+
+bool SatSolver::solve()
+{
+    if(!mOk)
+    {
+        return false;
+    }
+    cancelUntil(0);
+    if(mMaxLearnts == 0.0)
+    {
+        mMaxLearnts = std::max(kMinLearnts, mClauses.size() * kLearntFraction);
+    }
+
+    int restarts = 0;
+    double restartLimit = Solver::lubyTerm(restarts) * kRestartBase;
+    double sinceRestart = 0;
+    std::vector<int> learnt;
+    for(;;)
+    {
+        int conflict = propagate();
+        if(conflict >= 0)
+        {
+            ++mConflicts;
+            ++sinceRestart;
+            if(decisionLevel() == 0)
+            {
+                mOk = false;
+                return false;
+            }
+
+            int level = 0;
+            analyse(conflict, learnt, level);
+            cancelUntil(level);
+            if(learnt.size() == 1)
+            {
+                assign(learnt[0], -1);
+            }
+            else
+            {
+                int clause = attachClause(learnt, true);
+                bumpClause(mClauses[clause]);
+                assign(learnt[0], clause);
+            }
+            mVariableIncrement /= kVariableDecay;
+            mClauseIncrement /= kClauseDecay;
+        }
+        else
+        {
+            if(sinceRestart >= restartLimit)
+            {
+                cancelUntil(0);
+                sinceRestart = 0;
+                restartLimit = Solver::lubyTerm(++restarts) * kRestartBase;
+            }
+            if(mLearntCount - (int)mTrail.size() >= mMaxLearnts)
+            {
+                reduceLearnts();
+                mMaxLearnts *= kLearntGrowth;
+            }
+
+            int next = pickBranch();
+            if(next < 0)
+            {
+                // Everything is assigned without a conflict.
+                mModel.resize(mAssigns.size());
+                for(size_t v = 0; v < mAssigns.size(); ++v)
+                {
+                    mModel[v] = mAssigns[v] > 0;
+                }
+                return true;
+            }
+            mTrailLimits.push_back((int)mTrail.size());
+            assign(next, -1);
+        }
+    }
+}
+
+int SatSolver::attachClause(const std::vector<int>& lits, bool learnt)
+{
+    assert(lits.size() >= 2);
+    StoredClause clause;
+    clause.lits = lits;
+    clause.learnt = learnt;
+    clause.deleted = false;
+    clause.activity = 0.0;
+
+    int index = (int)mClauses.size();
+    mClauses.push_back(clause);
+    mWatches[lits[0]].push_back(index);
+    mWatches[lits[1]].push_back(index);
+    if(learnt)
+    {
+        ++mLearntCount;
+    }
+    return index;
+}
+
+void SatSolver::assign(int lit, int reason)
+{
+    int variable = lit >> 1;
+    assert(mAssigns[variable] == 0);
+    mAssigns[variable] = (lit & 1) != 0 ? -1 : 1;
+    mLevels[variable] = decisionLevel();
+    mReasons[variable] = reason;
+    mTrail.push_back(lit);
+}
+
+// Returns the clause in conflict, or -1 if there isn't one. A clause
+// that implies a literal always has it first, which analyse relies on.
+int SatSolver::propagate()
+{
+    while(mPropagated < (int)mTrail.size())
+    {
+        int falseLit = mTrail[mPropagated++] ^ 1;
+        std::vector<int>& watching = mWatches[falseLit];
+        size_t kept = 0;
+        for(size_t i = 0; i < watching.size(); ++i)
+        {
+            int index = watching[i];
+            StoredClause& clause = mClauses[index];
+            if(clause.deleted)
+            {
+                continue;
+            }
+            std::vector<int>& lits = clause.lits;
+            if(lits[0] == falseLit)
+            {
+                std::swap(lits[0], lits[1]);
+            }
+            if(valueOf(lits[0]) == 1)
+            {
+                watching[kept++] = index;
+                continue;
+            }
+
+            // Look for another literal to watch instead.
+            bool moved = false;
+            for(size_t k = 2; k < lits.size(); ++k)
+            {
+                if(valueOf(lits[k]) != -1)
+                {
+                    std::swap(lits[1], lits[k]);
+                    mWatches[lits[1]].push_back(index);
+                    moved = true;
+                    break;
+                }
+            }
+            if(moved)
+            {
+                continue;
+            }
+
+            watching[kept++] = index;
+            if(valueOf(lits[0]) == -1)
+            {
+                for(++i; i < watching.size(); ++i)
+                {
+                    watching[kept++] = watching[i];
+                }
+                watching.resize(kept);
+                mPropagated = (int)mTrail.size();
+                return index;
+            }
+            assign(lits[0], index);
+        }
+        watching.resize(kept);
+    }
+    return -1;
+}
+
+// Work back from the conflict to the first unique implication point,
+// giving a clause that would have forced its negation earlier. The
+// literal to assert goes first, and the one from the level to jump back
+// to goes second, ready for watching.
+void SatSolver::analyse(int conflict, std::vector<int>& learnt, int& backtrackLevel)
+{
+    learnt.clear();
+    learnt.push_back(-1);
+    int pathCount = 0;
+    int lit = -1;
+    int index = (int)mTrail.size() - 1;
+    int clause = conflict;
+    do
+    {
+        StoredClause& reason = mClauses[clause];
+        if(reason.learnt)
+        {
+            bumpClause(reason);
+        }
+        for(size_t j = lit < 0 ? 0 : 1; j < reason.lits.size(); ++j)
+        {
+            int q = reason.lits[j];
+            int variable = q >> 1;
+            if(mSeen[variable] == 0 && mLevels[variable] > 0)
+            {
+                bumpVariable(variable);
+                mSeen[variable] = 1;
+                if(mLevels[variable] >= decisionLevel())
+                {
+                    ++pathCount;
+                }
+                else
+                {
+                    learnt.push_back(q);
+                }
+            }
+        }
+        while(mSeen[mTrail[index] >> 1] == 0)
+        {
+            --index;
+        }
+        lit = mTrail[index--];
+        clause = mReasons[lit >> 1];
+        mSeen[lit >> 1] = 0;
+        --pathCount;
+    } while(pathCount > 0);
+    learnt[0] = lit ^ 1;
+
+    // Drop literals implied by the others.
+    std::vector<int> marked(learnt.begin() + 1, learnt.end());
+    size_t kept = 1;
+    for(size_t i = 1; i < learnt.size(); ++i)
+    {
+        if(!isRedundant(learnt[i]))
+        {
+            learnt[kept++] = learnt[i];
+        }
+    }
+    learnt.resize(kept);
+    for(size_t i = 0; i < marked.size(); ++i)
+    {
+        mSeen[marked[i] >> 1] = 0;
+    }
+
+    backtrackLevel = 0;
+    if(learnt.size() > 1)
+    {
+        size_t deepest = 1;
+        for(size_t i = 2; i < learnt.size(); ++i)
+        {
+            if(mLevels[learnt[i] >> 1] > mLevels[learnt[deepest] >> 1])
+            {
+                deepest = i;
+            }
+        }
+        std::swap(learnt[1], learnt[deepest]);
+        backtrackLevel = mLevels[learnt[1] >> 1];
+    }
+}
+
+// A literal of the learnt clause is redundant if everything else in
+// the clause that implied it is already in the learnt clause.
+bool SatSolver::isRedundant(int lit) const
+{
+    int reason = mReasons[lit >> 1];
+    if(reason < 0)
+    {
+        return false;
+    }
+    const std::vector<int>& lits = mClauses[reason].lits;
+    for(size_t k = 1; k < lits.size(); ++k)
+    {
+        int variable = lits[k] >> 1;
+        if(mSeen[variable] == 0 && mLevels[variable] > 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SatSolver::cancelUntil(int level)
+{
+    if(decisionLevel() <= level)
+    {
+        return;
+    }
+    int start = mTrailLimits[level];
+    for(int i = (int)mTrail.size() - 1; i >= start; --i)
+    {
+        int variable = mTrail[i] >> 1;
+        mPhases[variable] = (mTrail[i] & 1) == 0;
+        mAssigns[variable] = 0;
+        mReasons[variable] = -1;
+        if(mHeapIndex[variable] < 0)
+        {
+            heapInsert(variable);
+        }
+    }
+    mTrail.resize(start);
+    mTrailLimits.resize(level);
+    mPropagated = (int)mTrail.size();
+}
+
+// The most active unassigned variable, with the value it last had.
+int SatSolver::pickBranch()
+{
+    while(!mHeap.empty())
+    {
+        int variable = heapPop();
+        if(mAssigns[variable] == 0)
+        {
+            return 2 * variable + (mPhases[variable] ? 0 : 1);
+        }
+    }
+    return -1;
+}
+
+bool SatSolver::isLocked(int clause) const
+{
+    int first = mClauses[clause].lits[0];
+    return mReasons[first >> 1] == clause && valueOf(first) == 1;
+}
+
+// Throw away the less active half of the learnt clauses, apart from
+// binary ones and those that are the reason for something on the
+// trail, then pack the rest down and rebuild the watches.
+void SatSolver::reduceLearnts()
+{
+    std::vector< std::pair<double, int> > learnts;
+    for(size_t i = 0; i < mClauses.size(); ++i)
+    {
+        if(mClauses[i].learnt)
+        {
+            learnts.push_back(std::make_pair(mClauses[i].activity, (int)i));
+        }
+    }
+    std::sort(learnts.begin(), learnts.end());
+    for(size_t i = 0; i < learnts.size() / 2; ++i)
+    {
+        int index = learnts[i].second;
+        if(mClauses[index].lits.size() > 2 && !isLocked(index))
+        {
+            mClauses[index].deleted = true;
+            --mLearntCount;
+        }
+    }
+
+    std::vector<int> moved(mClauses.size(), -1);
+    size_t kept = 0;
+    for(size_t i = 0; i < mClauses.size(); ++i)
+    {
+        if(!mClauses[i].deleted)
+        {
+            moved[i] = (int)kept;
+            if(kept != i)
+            {
+                mClauses[kept].lits.swap(mClauses[i].lits);
+                mClauses[kept].learnt = mClauses[i].learnt;
+                mClauses[kept].deleted = false;
+                mClauses[kept].activity = mClauses[i].activity;
+            }
+            ++kept;
+        }
+    }
+    mClauses.resize(kept);
+
+    for(size_t i = 0; i < mTrail.size(); ++i)
+    {
+        int& reason = mReasons[mTrail[i] >> 1];
+        if(reason >= 0)
+        {
+            reason = moved[reason];
+            assert(reason >= 0);
+        }
+    }
+    for(size_t lit = 0; lit < mWatches.size(); ++lit)
+    {
+        mWatches[lit].clear();
+    }
+    for(size_t i = 0; i < mClauses.size(); ++i)
+    {
+        mWatches[mClauses[i].lits[0]].push_back((int)i);
+        mWatches[mClauses[i].lits[1]].push_back((int)i);
+    }
+}
+
+void SatSolver::bumpVariable(int variable)
+{
+    mActivity[variable] += mVariableIncrement;
+    if(mActivity[variable] > 1e100)
+    {
+        for(size_t v = 0; v < mActivity.size(); ++v)
+        {
+            mActivity[v] *= 1e-100;
+        }
+        mVariableIncrement *= 1e-100;
+    }
+    if(mHeapIndex[variable] >= 0)
+    {
+        heapUp(mHeapIndex[variable]);
+    }
+}
+
+void SatSolver::bumpClause(StoredClause& clause)
+{
+    clause.activity += mClauseIncrement;
+    if(clause.activity > 1e20)
+    {
+        for(size_t i = 0; i < mClauses.size(); ++i)
+        {
+            mClauses[i].activity *= 1e-20;
+        }
+        mClauseIncrement *= 1e-20;
+    }
+}
+
+void SatSolver::heapInsert(int variable)
+{
+    mHeapIndex[variable] = (int)mHeap.size();
+    mHeap.push_back(variable);
+    heapUp((int)mHeap.size() - 1);
+}
+
+int SatSolver::heapPop()
+{
+    int top = mHeap[0];
+    int last = mHeap.back();
+    mHeap.pop_back();
+    mHeapIndex[top] = -1;
+    if(!mHeap.empty())
+    {
+        mHeap[0] = last;
+        mHeapIndex[last] = 0;
+        heapDown(0);
+    }
+    return top;
+}
+
+void SatSolver::heapUp(int position)
+{
+    int variable = mHeap[position];
+    while(position > 0)
+    {
+        int parent = (position - 1) / 2;
+        if(mActivity[mHeap[parent]] >= mActivity[variable])
+        {
+            break;
+        }
+        mHeap[position] = mHeap[parent];
+        mHeapIndex[mHeap[position]] = position;
+        position = parent;
+    }
+    mHeap[position] = variable;
+    mHeapIndex[variable] = position;
+}
+
+void SatSolver::heapDown(int position)
+{
+    int variable = mHeap[position];
+    int size = (int)mHeap.size();
+    for(;;)
+    {
+        int child = 2 * position + 1;
+        if(child >= size)
+        {
+            break;
+        }
+        if(child + 1 < size && mActivity[mHeap[child + 1]] > mActivity[mHeap[child]])
+        {
+            ++child;
+        }
+        if(mActivity[mHeap[child]] <= mActivity[variable])
+        {
+            break;
+        }
+        mHeap[position] = mHeap[child];
+        mHeapIndex[mHeap[position]] = position;
+        position = child;
+    }
+    mHeap[position] = variable;
+    mHeapIndex[variable] = position;
+}
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+
+namespace
+{
+    class SatSolverTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( simpleTest );
+            RUN( pigeonholeTest );
+            RUN( enumerateTest );
+            RUN( queensTest );
+        }
+
+        static SatSolver::Clause clause(int a, int b = 0, int c = 0)
+        {
+            SatSolver::Clause result;
+            result.push_back(a);
+            if(b != 0)
+            {
+                result.push_back(b);
+            }
+            if(c != 0)
+            {
+                result.push_back(c);
+            }
+            return result;
+        }
+
+        void simpleTest()
+        {
+            SatSolver sat;
+            int a = sat.newVariable();
+            int b = sat.newVariable();
+            CHECK(sat.addClause(clause(a, b)));
+            CHECK(sat.addClause(clause(-a, b)));
+            CHECK(sat.addClause(clause(a, -b)));
+            CHECK_ASSERT(sat.solve());
+            CHECK(sat.value(a) && sat.value(b));
+
+            CHECK(!sat.addClause(clause(-a, -b)));
+            CHECK(!sat.solve());
+        }
+
+        void pigeonholeTest()
+        {
+            // Five pigeons don't fit in four holes.
+            const int pigeons = 5;
+            const int holes = 4;
+            SatSolver sat;
+            int in[pigeons][holes];
+            for(int p = 0; p < pigeons; ++p)
+            {
+                SatSolver::Clause somewhere;
+                for(int h = 0; h < holes; ++h)
+                {
+                    in[p][h] = sat.newVariable();
+                    somewhere.push_back(in[p][h]);
+                }
+                sat.addClause(somewhere);
+            }
+            for(int h = 0; h < holes; ++h)
+            {
+                for(int p = 0; p < pigeons; ++p)
+                {
+                    for(int q = p + 1; q < pigeons; ++q)
+                    {
+                        sat.addClause(clause(-in[p][h], -in[q][h]));
+                    }
+                }
+            }
+            CHECK(!sat.solve());
+            CHECK(sat.conflictCount() > 0);
+        }
+
+        void enumerateTest()
+        {
+            // Exactly one of five, found one at a time by blocking each.
+            SatSolver sat;
+            SatSolver::Clause any;
+            for(int i = 0; i < 5; ++i)
+            {
+                any.push_back(sat.newVariable());
+            }
+            sat.addClause(any);
+            for(int i = 1; i <= 5; ++i)
+            {
+                for(int j = i + 1; j <= 5; ++j)
+                {
+                    sat.addClause(clause(-i, -j));
+                }
+            }
+
+            int found = 0;
+            while(sat.solve())
+            {
+                ++found;
+                SatSolver::Clause block;
+                for(int i = 1; i <= 5; ++i)
+                {
+                    block.push_back(sat.value(i) ? -i : i);
+                }
+                sat.addClause(block);
+            }
+            CHECK(found == 5);
+        }
+
+        void queensTest()
+        {
+            const int n = 8;
+            SatSolver sat;
+            int queen[n][n];
+            for(int r = 0; r < n; ++r)
+            {
+                SatSolver::Clause row;
+                for(int c = 0; c < n; ++c)
+                {
+                    queen[r][c] = sat.newVariable();
+                    row.push_back(queen[r][c]);
+                }
+                sat.addClause(row);
+            }
+            for(int r = 0; r < n; ++r)
+            {
+                for(int c = 0; c < n; ++c)
+                {
+                    for(int r2 = r; r2 < n; ++r2)
+                    {
+                        for(int c2 = 0; c2 < n; ++c2)
+                        {
+                            bool later = r2 > r || c2 > c;
+                            bool attacks = r2 == r || c2 == c || r2 - r == c2 - c || r2 - r == c - c2;
+                            if(later && attacks)
+                            {
+                                sat.addClause(clause(-queen[r][c], -queen[r2][c2]));
+                            }
+                        }
+                    }
+                }
+            }
+
+            int found = 0;
+            while(sat.solve())
+            {
+                ++found;
+                SatSolver::Clause block;
+                for(int r = 0; r < n; ++r)
+                {
+                    for(int c = 0; c < n; ++c)
+                    {
+                        if(sat.value(queen[r][c]))
+                        {
+                            block.push_back(-queen[r][c]);
+                        }
+                    }
+                }
+                sat.addClause(block);
+            }
+            CHECK(found == 92);
+        }
+    };
+}
+
+DECLARE_TEST( SatSolverTest );
+
+#endif // BUILD_TESTS
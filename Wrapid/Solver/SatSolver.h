@@ -0,0 +1,138 @@
+#pragma once
+#ifndef SOLVER_SATSOLVER_H__INCLUDED
+#define SOLVER_SATSOLVER_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include <vector>
+
+namespace Solver
+{
+    class SatSolver;
+}
+
+// A small conflict driven clause learning SAT solver. It watches two
+// literals of every clause for unit propagation, learns a clause from
+// the first unique implication point of every conflict, branches on the
+// most active variable (VSIDS) with the last phase it had, restarts on
+// the Luby sequence and throws away the least active learnt clauses
+// once there are too many.
+//
+// Clauses can be added between calls to solve, which is how the other
+// solutions are found: block the last one and solve again.
+class Solver::SatSolver
+{
+    PREVENT_COPY_AND_ASSIGNMENT(SatSolver);
+public:
+    // Literals are numbered as in DIMACS: variable v is v, and its
+    // negation is -v. Variables start at one.
+    typedef int Literal;
+    typedef std::vector<Literal> Clause;
+
+    SatSolver();
+    ~SatSolver();
+
+    int newVariable();
+
+    int variableCount() const
+    {
+        return (int)mAssigns.size();
+    }
+
+    // Returns false once the clauses can't all be satisfied.
+    bool addClause(const Clause& clause);
+
+    // Look for an assignment that satisfies every clause so far.
+    bool solve();
+
+    // The value of a variable in the assignment found by the last solve.
+    bool value(int variable) const
+    {
+        return mModel[variable - 1];
+    }
+
+    unsigned long long conflictCount() const
+    {
+        return mConflicts;
+    }
+
+private:
+    // Internally a literal is an index, 2 * (variable - 1) plus one if
+    // it is negated, so its negation is just the index xor one.
+    static int toIndex(Literal literal)
+    {
+        return literal > 0 ? 2 * (literal - 1) : 2 * (-literal - 1) + 1;
+    }
+
+    // 1 if true, -1 if false, 0 if unassigned.
+    int valueOf(int lit) const
+    {
+        int value = mAssigns[lit >> 1];
+        return (lit & 1) != 0 ? -value : value;
+    }
+
+    int decisionLevel() const
+    {
+        return (int)mTrailLimits.size();
+    }
+
+    struct StoredClause
+    {
+        std::vector<int> lits;
+        bool learnt;
+        bool deleted;
+        double activity;
+    };
+
+    int attachClause(const std::vector<int>& lits, bool learnt);
+    void assign(int lit, int reason);
+    int propagate();
+    void analyse(int conflict, std::vector<int>& learnt, int& backtrackLevel);
+    bool isRedundant(int lit) const;
+    void cancelUntil(int level);
+    int pickBranch();
+    void reduceLearnts();
+    bool isLocked(int clause) const;
+
+    void bumpVariable(int variable);
+    void bumpClause(StoredClause& clause);
+    void heapInsert(int variable);
+    int heapPop();
+    void heapUp(int position);
+    void heapDown(int position);
+
+    bool mOk;
+
+    // Per variable.
+    std::vector<signed char> mAssigns;
+    std::vector<int> mLevels;
+    std::vector<int> mReasons;
+    std::vector<bool> mPhases;
+    std::vector<double> mActivity;
+    std::vector<char> mSeen;
+    std::vector<bool> mModel;
+
+    // The decision heap, ordered by activity, and where each
+    // variable is in it (-1 if it isn't).
+    std::vector<int> mHeap;
+    std::vector<int> mHeapIndex;
+
+    // Per literal, the clauses watching it.
+    std::vector< std::vector<int> > mWatches;
+
+    std::vector<StoredClause> mClauses;
+    int mLearntCount;
+    double mMaxLearnts;
+
+    std::vector<int> mTrail;
+    std::vector<int> mTrailLimits;
+    int mPropagated;
+
+    double mVariableIncrement;
+    double mClauseIncrement;
+    unsigned long long mConflicts;
+};
+
+#endif // SOLVER_SATSOLVER_H__INCLUDED
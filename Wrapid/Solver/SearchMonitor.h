@@ -0,0 +1,38 @@
+#pragma once
+#ifndef SOLVER_SEARCHMONITOR_H__INCLUDED
+#define SOLVER_SEARCHMONITOR_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridValues.h"
+
+namespace Solver
+{
+    template <int Dimensions>
+    class SearchMonitor;
+}
+
+// Lets something outside a GridSolver steer a search that is in
+// progress. The solver checks in with its monitor every so often
+// while it is searching, so the checks need to be cheap.
+template <int Dimensions>
+class Solver::SearchMonitor
+{
+public:
+    virtual ~SearchMonitor()
+    {
+    }
+
+    // Return true to abandon the search.
+    virtual bool shouldStop() = 0;
+
+    // Return true if part of the remaining search should be handed over.
+    virtual bool wantsWork() = 0;
+
+    // Takes over the search of every completion of the partial solution.
+    virtual void takeWork(const GridValues<Dimensions>& partial) = 0;
+};
+
+#endif // SOLVER_SEARCHMONITOR_H__INCLUDED
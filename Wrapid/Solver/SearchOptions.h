@@ -0,0 +1,168 @@
+#pragma once
+#ifndef SOLVER_SEARCHOPTIONS_H__INCLUDED
+#define SOLVER_SEARCHOPTIONS_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+namespace Solver
+{
+    // Optional strategies for the GridSolver. With no flags set it is
+    // a plain backtracker. The flags can be combined.
+    enum SearchFlag
+    {
+        // Keep a live domain for every unset cell, and abandon a branch
+        // as soon as any cell has nothing left that it could hold.
+        kForwardChecking = 1 << 0,
+
+        // Branch on the unset cell with the fewest options left, preferring
+        // cells with more set neighbours when that's tied. This needs the
+        // live domains, so it implies kForwardChecking.
+        kSmallestDomainFirst = 1 << 1,
+
+        // After every placement, and once for the presets, keep removing
+        // symbols that no neighbour could sit next to until nothing changes
+        // (arc consistency). This builds on the live domains of
+        // kForwardChecking, and implies it.
+        kArcConsistency = 1 << 2,
+
+        // Only the first solution is wanted. A parallel search stops
+        // everything else as soon as any thread finds one.
+        kFirstSolutionOnly = 1 << 3,
+
+        // Find one solution out of each set that are the same up to a
+        // symmetry of the board and presets, such as turning a torus.
+        kBreakSymmetry = 1 << 4,
+
+        // As kBreakSymmetry, but then produce the rest of each set
+        // from the one that was found. It implies kBreakSymmetry.
+        kExpandSymmetry = 1 << 5,
+
+        // Find one solution out of each set that are the same up to
+        // swapping symbols in a way that keeps the sequence the same, such
+        // as turning the clock face. Symbols already on the board are left
+        // alone. This is ignored when breaking board symmetry, as the two
+        // could each keep a different solution out of a set.
+        kBreakValueSymmetry = 1 << 6,
+
+        // When a cell runs out of options, jump straight back to the
+        // deepest earlier placement that helped rule them out, rather
+        // than just the last one (conflict-directed backjumping).
+        kBackjumping = 1 << 7,
+
+        // As kBackjumping, and also remember the small sets of placements
+        // found to rule each other out, so that they are turned down at
+        // once when they come round again. It implies kBackjumping.
+        kRecordNogoods = 1 << 8,
+
+        // Don't search the grid at all, but encode the puzzle as a SAT
+        // problem and hand it to the SatSolver. The other flags and the
+        // thread count don't apply to it.
+        kSatBackend = 1 << 9,
+
+        // Treat the symbol counts as one global constraint over the live
+        // domains: fail as soon as the symbols left can't cover the unset
+        // cells, and place a symbol in the only cells that can still take
+        // it when it needs all of them (hidden singles). This builds on
+        // the live domains of kForwardChecking, and implies it.
+        kCardinality = 1 << 10,
+
+        // After every placement, check that each set cell it touches still
+        // has enough symbols left that could sit next to it to fill in
+        // all of its unset neighbours.
+        kNeighbourCapacity = 1 << 11,
+
+        // Fill in each corridor of unset cells with exactly two neighbours
+        // in one go, as a walk through the sequence between the cells at
+        // its ends, rather than one cell at a time. This is ignored with
+        // kSmallestDomainFirst, kBackjumping and kBreakValueSymmetry.
+        kCompressChains = 1 << 12,
+
+        // When the walls split the board into parts with no way through
+        // from one to another, search each part by itself for all the ways
+        // of filling it in, and put them together by the symbols they use
+        // (see ComponentSolver). The parts are searched with one thread,
+        // and without breaking symmetry.
+        kSplitComponents = 1 << 13,
+
+        // When counting, as soon as the set cells cut the unset cells up
+        // into islands, count the ways of filling in each island by itself
+        // and put them together by the symbols they use, rather than
+        // searching every combination of them. This is ignored when
+        // breaking either kind of symmetry.
+        kSplitIslands = 1 << 14,
+
+        // As kSplitIslands, and remember what each island came to, keyed on
+        // its cells, the values around it and the symbols left for it, so
+        // an island reached again by a different route isn't searched again
+        // (see SubproblemCache).
+        kCacheIslands = 1 << 15,
+
+        // Count by sweeping across the board a layer at a time, keeping the
+        // number of ways of reaching each state of the frontier rather than
+        // searching (see TransferCounter). This suits narrow boards, such
+        // as the hour puzzle. Stepping through the solutions still searches.
+        kTransferCount = 1 << 16,
+
+        // When the unset cells are only loosely joined up, solve by dynamic
+        // programming over a tree decomposition of them rather than by
+        // searching (see TreeSolver). The board is checked first, and is
+        // searched as usual if it is too tangled for that to pay.
+        kTreeDecomposition = 1 << 17,
+
+        // Sweep across the board as kTransferCount does, and keep every
+        // solution as a decision diagram (see SolutionDiagram). Counting
+        // and stepping through the solutions then come from the diagram.
+        kSolutionDiagram = 1 << 18,
+
+        // When a few open walls are enough to cut a slice off the board,
+        // such as a level of a card puzzle with its tunnels, search both
+        // sides by themselves for every way of filling them in, and match
+        // them up by the values either side of the cut and the symbols
+        // they use (see CutSolver). The sides are searched with one
+        // thread, and without breaking symmetry.
+        kCutJoin = 1 << 19,
+
+        // Break ties in the order of the cells and the symbols at random,
+        // and start the search again from the top each time it has used
+        // up a budget of steps without finding a solution, with budgets
+        // following the Luby sequence. This cuts off the long runs that
+        // an unlucky fixed order can get stuck in. With kRecordNogoods
+        // the nogoods are kept from one start to the next. Once the first
+        // solution is found the search carries on without restarting, so
+        // the rest are still found once each. The order comes from the
+        // seed, so a run can be repeated. This is ignored in parallel and
+        // with kBreakValueSymmetry.
+        kRestarts = 1 << 20
+    };
+
+    struct SearchOptions
+    {
+        // With more than one thread the search is split up and run in
+        // parallel. Zero threads means one for each core. The seed
+        // is for the random choices made with kRestarts.
+        SearchOptions(int searchFlags = 0, int threadCount = 1, unsigned randomSeed = 0)
+            : flags(searchFlags)
+            , threads(threadCount)
+            , seed(randomSeed)
+        {
+        }
+
+        bool isParallel() const
+        {
+            return threads != 1;
+        }
+
+        bool has(SearchFlag flag) const
+        {
+            return (flags & flag) != 0;
+        }
+
+        int flags;
+        int threads;
+        unsigned seed;
+    };
+}
+
+#endif // SOLVER_SEARCHOPTIONS_H__INCLUDED
@@ -13,6 +13,8 @@ using Solver::Sequence;
 
 Sequence::Sequence()
     : mNextSymbol(Solver::kFirstSymbol)
+    , mAdjacentMasks(Solver::kFirstSymbol, 0)
+    , mSymbolMask(0)
 {
 }
 
@@ -22,7 +24,11 @@ Sequence::~Sequence()
 
 Sequence::Sequence(int symbolCount, int repeatCount)
     : mNextSymbol(Solver::kFirstSymbol)
+    , mAdjacentMasks(Solver::kFirstSymbol, 0)
+    , mSymbolMask(0)
 {
+    assert(symbolCount <= Solver::kMaxMaskSymbol);
+    symbolCount = std::min<int>(symbolCount, Solver::kMaxMaskSymbol);
     for(int i = 0; i < symbolCount; ++i)
     {
         addSymbol(repeatCount);
@@ -37,9 +43,17 @@ Sequence::Sequence(int symbolCount, int repeatCount)
 
 Symbol Sequence::addSymbol(int count)
 {
+    // Each symbol needs a bit of its own in the masks.
+    assert(mNextSymbol <= Solver::kMaxMaskSymbol);
+    if(mNextSymbol > Solver::kMaxMaskSymbol)
+    {
+        return Solver::kUnsetSymbol;
+    }
     Symbol next = mNextSymbol;
     ++mNextSymbol;
     mSymbols[next].first = count;
+    mAdjacentMasks.push_back(0);
+    mSymbolMask |= Solver::symbolBit(next);
     return next;
 }
 
@@ -56,18 +70,32 @@ void Sequence::addJoker()
     makeAdjacentDirected(joker, joker);
 }
 
+Symbol Sequence::addWildcard(int count)
+{
+    Symbol wildcard = addSymbol(count);
+    for(Symbol s = Solver::kFirstSymbol; s <= wildcard; ++s)
+    {
+        makeAdjacent(wildcard, s);
+    }
+    return wildcard;
+}
+
 void Sequence::makeAdjacentDirected(Symbol s, Symbol t)
 {
     assert(mSymbols.find(s) != mSymbols.end());
     assert(std::find(mSymbols[s].second.begin(), mSymbols[s].second.end(), t) == mSymbols[s].second.end());
 
     mSymbols[s].second.insert(t);
+    mAdjacentMasks[s] |= Solver::symbolBit(t);
 }
 
 void Sequence::makeAdjacent(Symbol s, Symbol t)
 {
     makeAdjacentDirected(s, t);
-    makeAdjacentDirected(t, s);
+    if(t != s)
+    {
+        makeAdjacentDirected(t, s);
+    }
 }
 
 Sequence::SymbolSet Sequence::getSymbols() const
@@ -81,6 +109,11 @@ Sequence::SymbolSet Sequence::getSymbols() const
     return symbols;
 }
 
+Solver::SymbolMask Sequence::getSymbolMask() const
+{
+    return mSymbolMask;
+}
+
 const int Sequence::count(Symbol s) const
 {
     assert(mSymbols.find(s) != mSymbols.end());
@@ -7,10 +7,12 @@
  * --------------------------------------------------------------- */
 
 #include "Solver/Symbol.h"
+#include "Solver/SymbolMask.h"
 
 #include <vector>
 #include <set>
 #include <map>
+#include <assert.h>
 
 namespace Solver
 {
@@ -31,28 +33,45 @@ public:
 
     ~Sequence();
 
-    // Construct a simple circular sequence.
+    // Construct a simple circular sequence. A sequence can have at most
+    // kMaxMaskSymbol symbols, so symbolCount is cut down to that.
     Sequence(int symbolCount, int repeatCount);
 
     // Produce a new symbol for the sequence which
     // is allowed the specified number of times.
-    // Initially adjacent to nothing.
+    // Initially adjacent to nothing. Returns kUnsetSymbol,
+    // adding nothing, once there are kMaxMaskSymbol symbols.
     Symbol addSymbol(int count);
 
     // Utility method for adding the joker to the card sequence.
     // Jokers are adjacent to every symbol (including itself).
     void addJoker();
 
+    // Produce a new symbol that is adjacent to every
+    // symbol so far, including itself.
+    Symbol addWildcard(int count);
+
     // Allow the two symbols to sit touching each
-    // other on the game board.
+    // other on the game board. They can be the same.
     void makeAdjacent(Symbol s, Symbol t);
 
     // Get a collection of all of the symbols.
     SymbolSet getSymbols() const;
 
+    // All of the symbols as a mask. This is kept up to date
+    // as symbols are added, so it is cheap to call.
+    SymbolMask getSymbolMask() const;
+
     const int count(Symbol s) const;
     const SymbolSet& getAdjacent(Symbol s) const;
 
+    // The symbols adjacent to s as a mask.
+    SymbolMask getAdjacentMask(Symbol s) const
+    {
+        assert(s >= Solver::kFirstSymbol && s < mNextSymbol);
+        return mAdjacentMasks[s];
+    }
+
 private:
     void makeAdjacentDirected(Symbol s, Symbol t);
 
@@ -60,6 +79,10 @@ private:
 
     SymbolMap mSymbols;
     Symbol mNextSymbol;
+
+    // Indexed by symbol.
+    std::vector<SymbolMask> mAdjacentMasks;
+    SymbolMask mSymbolMask;
 };
 
 #endif // SOLVER_SEQUENCE_H__INCLUDED
@@ -0,0 +1,259 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/SolutionDiagram.h"
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+#include "Solver/HourPuzzleIO.h"
+#include "Solver/PuzzleIOUtils.h"
+
+#include <set>
+
+using namespace Solver;
+
+namespace
+{
+    class SolutionDiagramTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( countTest );
+            RUN( steppingTest );
+            RUN( indexTest );
+            RUN( optionsTest );
+            RUN( presetTest );
+        }
+
+        typedef std::vector<Symbol> Flat;
+
+        template <int D>
+        static Flat flatten(const Topology& topology, const GridValues<D>& values)
+        {
+            Flat flat;
+            for(int cell = 0; cell < topology.cellCount(); ++cell)
+            {
+                flat.push_back(values.atIndex(cell));
+            }
+            return flat;
+        }
+
+        // All the solutions, as found by searching.
+        template <int D>
+        static std::set<Flat> searchAll(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets
+        )
+        {
+            Topology topology(grid);
+            GridSolver<D> solver(grid, symbols);
+            solver.addPresets(presets);
+            std::set<Flat> solutions;
+            while(solver.nextSolution() == kFoundSolution)
+            {
+                solutions.insert(flatten(topology, solver.getSolution()));
+            }
+            return solutions;
+        }
+
+        // The lessConstrained hour puzzle.
+        void buildHourGrid(Grid2D& grid, GridValues2D& presets)
+        {
+            const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+            ParseResult result = parse(grid, presets, asStrings(puzzle, grid.getSize()));
+            CHECK_ASSERT(result == kParseSucceed);
+        }
+
+        void countTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            buildHourGrid(grid, presets);
+            Sequence symbols(12, 2);
+            SolutionDiagram<2> diagram(grid, symbols);
+            diagram.addPresets(presets);
+            CHECK(diagram.countSolutions(0) == 48);
+            CHECK(diagram.countSolutions(5) == 5);
+            CHECK(diagram.isBuilt());
+
+            // Far fewer nodes than 48 solutions of 24 cells.
+            CHECK(diagram.nodeCount() < 48 * 24);
+
+            Grid2D band(coord(6, 2));
+            Sequence fours(4, 3);
+            SolutionDiagram<2> bandDiagram(band, fours);
+            bandDiagram.addPresets(GridValues2D(band.getSize()));
+            CHECK(bandDiagram.countSolutions(0) == 800);
+
+            Grid<3> levels(coord(2, 2, 3));
+            levels.unwrap(2);
+            GridValues<3> corner(levels.getSize());
+            corner.place(1, coord(0, 0, 0));
+            SolutionDiagram<3> levelsDiagram(levels, fours);
+            levelsDiagram.addPresets(corner);
+            CHECK(levelsDiagram.countSolutions(0) == 200);
+        }
+
+        void steppingTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            buildHourGrid(grid, presets);
+            Sequence symbols(12, 2);
+            std::set<Flat> expected = searchAll(grid, symbols, presets);
+            CHECK(expected.size() == 48);
+
+            Topology topology(grid);
+            SolutionDiagram<2> diagram(grid, symbols);
+            diagram.addPresets(presets);
+            std::set<Flat> stepped;
+            while(diagram.nextSolution() == kFoundSolution)
+            {
+                stepped.insert(flatten(topology, diagram.getSolution()));
+            }
+            CHECK(stepped == expected);
+            CHECK(diagram.nextSolution() == kNoSolution);
+
+            // The wrapped board, with more solutions.
+            Grid2D torus(coord(4, 6));
+            GridValues2D two(torus.getSize());
+            two.place(1, coord(0, 0));
+            two.place(7, coord(2, 3));
+            expected = searchAll(torus, symbols, two);
+            SolutionDiagram<2> torusDiagram(torus, symbols);
+            torusDiagram.addPresets(two);
+            CHECK(torusDiagram.countSolutions(0) == expected.size());
+            stepped.clear();
+            SolutionCount count = 0;
+            while(torusDiagram.nextSolution() == kFoundSolution)
+            {
+                stepped.insert(flatten(topology, torusDiagram.getSolution()));
+                ++count;
+            }
+            CHECK(count == expected.size());
+            CHECK(stepped == expected);
+        }
+
+        void indexTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            buildHourGrid(grid, presets);
+            Sequence symbols(12, 2);
+            Topology topology(grid);
+
+            // The solutions by index come in the order they are stepped through.
+            SolutionDiagram<2> diagram(grid, symbols);
+            diagram.addPresets(presets);
+            CHECK_ASSERT(diagram.build());
+            SolutionCount index = 0;
+            while(diagram.nextSolution() == kFoundSolution)
+            {
+                GridValues2D values(grid.getSize());
+                diagram.solutionAt(index, values);
+                CHECK(flatten(topology, values) == flatten(topology, diagram.getSolution()));
+                ++index;
+            }
+            CHECK(index == diagram.solutionCount());
+
+            // Sampling with a fixed seed gives the same solutions each time,
+            // and given enough draws reaches most of them.
+            std::set<Flat> expected = searchAll(grid, symbols, presets);
+            std::set<Flat> sampled;
+            std::mt19937 random(12);
+            for(int i = 0; i < 400; ++i)
+            {
+                GridValues2D values(grid.getSize());
+                diagram.sample(random, values);
+                Flat flat = flatten(topology, values);
+                CHECK(expected.count(flat) == 1);
+                sampled.insert(flat);
+            }
+            CHECK(sampled.size() > 40);
+        }
+
+        void optionsTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            buildHourGrid(grid, presets);
+            Sequence symbols(12, 2);
+            std::set<Flat> solutions = searchAll(grid, symbols, presets);
+
+            SolutionDiagram<2> diagram(grid, symbols);
+            diagram.addPresets(presets);
+            CHECK_ASSERT(diagram.build());
+            CoordinateOrder<2> order(grid.getSize());
+            for(int cell = 0; cell < 24; ++cell)
+            {
+                SymbolMask expected = 0;
+                std::set<Flat>::const_iterator end = solutions.end();
+                for(std::set<Flat>::const_iterator it = solutions.begin(); it != end; ++it)
+                {
+                    expected |= symbolBit((*it)[cell]);
+                }
+                CHECK(diagram.options(order.coordinate(cell)) == expected);
+            }
+            CHECK(diagram.canHave(coord(0, 0), 12));
+            CHECK(!diagram.canHave(coord(0, 0), 1));
+        }
+
+        void presetTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            buildHourGrid(grid, presets);
+            Sequence symbols(12, 2);
+
+            // Neighbouring presets that can't go together.
+            GridValues2D clash(grid.getSize());
+            clash.place(1, coord(0, 1));
+            clash.place(5, coord(0, 2));
+            SolutionDiagram<2> none(grid, symbols);
+            none.addPresets(clash);
+            CHECK(none.countSolutions(0) == 0);
+            CHECK(none.nextSolution() == kNoSolution);
+
+            // A filled in board is already solved.
+            GridValues2D solved(grid.getSize());
+            Symbol solution[4][6] = {
+                {12,  7,  6,  5,  8,  7},
+                {11,  8,  1,  4,  5,  6},
+                {10,  9,  2,  3,  4,  3},
+                { 9, 10, 11, 12,  1,  2}
+            };
+            for(int i = 0; i < 4; ++i)
+            {
+                for(int j = 0; j < 6; ++j)
+                {
+                    solved.place(solution[i][j], coord(i, j));
+                }
+            }
+            SolutionDiagram<2> one(grid, symbols);
+            one.addPresets(solved);
+            CHECK(one.countSolutions(0) == 1);
+            CHECK(one.nextSolution() == kAlreadySolved);
+            CHECK(isMatch(solved, one.getSolution()));
+            CHECK(one.nextSolution() == kNoSolution);
+        }
+    };
+}
+
+DECLARE_TEST( SolutionDiagramTest );
+
+#endif // BUILD_TESTS
@@ -0,0 +1,467 @@
+#pragma once
+#ifndef SOLVER_SOLUTIONDIAGRAM_H__INCLUDED
+#define SOLVER_SOLUTIONDIAGRAM_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridSolver.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/Topology.h"
+#include "Solver/SweepPlan.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <random>
+#include <assert.h>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class SolutionDiagram;
+}
+
+// All of the solutions of a board at once, as a zero-suppressed decision
+// diagram (ZDD) over the choices "this cell holds this symbol". Each node
+// asks about one choice: its hi branch takes it and its lo branch goes on
+// to the next symbol for the same cell. The choices are ordered by the
+// cells in the order a SweepPlan fills them in, so two partial solutions
+// that leave the same frontier values and symbols behind share the rest
+// of the diagram below them, and identical nodes are only kept once.
+//
+// The diagram is built by sweeping across the board as the TransferCounter
+// does, keeping which state leads to which, and then turning the states
+// into nodes from the last cell back to the first. Once it's built it can
+// count the solutions, pick out the solution at any index or a uniformly
+// random one, say what each cell can hold in any solution, and step
+// through the solutions one at a time, all without keeping more than the
+// nodes and one solution. If the sweep outgrows kMaxStates, it gives up
+// and a GridSolver searches the board instead.
+template <int Dimensions>
+class Solver::SolutionDiagram : public Solver::SolveEngine<Dimensions>
+{
+    PREVENT_COPY_AND_ASSIGNMENT(SolutionDiagram);
+public:
+    typedef Grid<Dimensions> GridD;
+    typedef GridValues<Dimensions> Values;
+    typedef Coordinate<Dimensions> Coord;
+
+    SolutionDiagram(const GridD& grid, const Sequence& sequence, SearchOptions options = SearchOptions())
+        : mTopology(grid)
+        , mSequence(sequence)
+        , mValues(grid.getSize())
+        , mSolution(grid.getSize())
+        , mSearch(grid, sequence, options)
+        , mPlan(grid, mTopology)
+        , mSymbolRange(highestSymbol(sequence.getSymbolMask()) + 1)
+        , mBuilt(kUnbuilt)
+        , mRoot(kEmpty)
+        , mStarted(false)
+    {
+    }
+
+    ~SolutionDiagram()
+    {
+    }
+
+    void addPresets(const Values& values)
+    {
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
+        {
+            mValues.place(it->second, it->first);
+        }
+        mSearch.addPresets(values);
+    }
+
+    // Steps through the solutions in the order of the diagram.
+    SolveResult nextSolution()
+    {
+        if(!build())
+        {
+            return mSearch.nextSolution();
+        }
+        if(!mStarted)
+        {
+            mStarted = true;
+            if(mRoot == kEmpty)
+            {
+                return kNoSolution;
+            }
+            descend(mRoot);
+            return (mValues.valueCount() == mTopology.cellCount()) ? kAlreadySolved : kFoundSolution;
+        }
+        return advance() ? kFoundSolution : kNoSolution;
+    }
+
+    SolutionCount countSolutions(SolutionCount limit)
+    {
+        if(!build())
+        {
+            return mSearch.countSolutions(limit);
+        }
+        SolutionCount count = solutionCount();
+        return (limit != 0 && count > limit) ? limit : count;
+    }
+
+    const Values& getSolution() const
+    {
+        return isBuilt() ? mSolution : mSearch.getSolution();
+    }
+
+    // Build the diagram if that hasn't been tried yet. Returns false if
+    // it was too big, in which case only the SolveEngine calls work.
+    bool build()
+    {
+        if(mBuilt == kUnbuilt)
+        {
+            mBuilt = sweep() ? kBuilt : kTooBig;
+        }
+        return isBuilt();
+    }
+
+    bool isBuilt() const
+    {
+        return mBuilt == kBuilt;
+    }
+
+    // The nodes in the diagram, including the two terminals.
+    int nodeCount() const
+    {
+        assert(isBuilt());
+        return (int)mNodes.size();
+    }
+
+    SolutionCount solutionCount() const
+    {
+        assert(isBuilt());
+        return mCounts[mRoot];
+    }
+
+    // Fill in the solution at an index below solutionCount, in the
+    // same order as nextSolution steps through them.
+    void solutionAt(SolutionCount index, Values& values) const
+    {
+        assert(isBuilt() && index < solutionCount());
+        int node = mRoot;
+        while(node != kBase)
+        {
+            const Node& at = mNodes[node];
+            if(index < mCounts[at.hi])
+            {
+                values.placeAt(symbolOf(at.variable), cellOf(at.variable));
+                node = at.hi;
+            }
+            else
+            {
+                index -= mCounts[at.hi];
+                node = at.lo;
+            }
+        }
+    }
+
+    // Fill in a solution, with each one as likely as any other.
+    template <class Random>
+    void sample(Random& random, Values& values) const
+    {
+        assert(isBuilt() && solutionCount() > 0);
+        std::uniform_int_distribution<SolutionCount> pick(0, solutionCount() - 1);
+        solutionAt(pick(random), values);
+    }
+
+    // The symbols a cell holds in at least one solution.
+    SymbolMask options(const Coord& c) const
+    {
+        assert(isBuilt());
+        return mOptions[mValues.indexOf(c)];
+    }
+
+    bool canHave(const Coord& c, Symbol s) const
+    {
+        return hasSymbol(options(c), s);
+    }
+
+private:
+    enum
+    {
+        kMaxStates = 1 << 22
+    };
+
+    enum BuildState
+    {
+        kUnbuilt,
+        kBuilt,
+        kTooBig
+    };
+
+    // The two terminals: no solutions, and the one solution that has
+    // nothing left to fill in.
+    enum
+    {
+        kEmpty = 0,
+        kBase = 1
+    };
+
+    // The variable is the choice a node asks about, the position of the
+    // cell in the sweep times the symbol range plus the symbol.
+    struct Node
+    {
+        int variable;
+        int lo;
+        int hi;
+
+        bool operator==(const Node& other) const
+        {
+            return variable == other.variable && lo == other.lo && hi == other.hi;
+        }
+    };
+    struct NodeHash
+    {
+        size_t operator()(const Node& node) const
+        {
+            return (size_t)node.variable * 0x9E3779B1u
+                ^ (size_t)node.lo * 0x85EBCA77u
+                ^ (size_t)node.hi * 0xC2B2AE3Du;
+        }
+    };
+    typedef std::unordered_map<Node, int, NodeHash> UniqueTable;
+
+    // The states after each step are numbered, and each state lists the
+    // symbols that can go in the next cell and the state each one leads
+    // to, in increasing order of symbol.
+    struct Edge
+    {
+        Symbol symbol;
+        int next;
+    };
+    struct Layer
+    {
+        std::vector<int> first;
+        std::vector<Edge> edges;
+    };
+
+    // As in the TransferCounter, a state is the frontier values followed
+    // by how many of each symbol are left.
+    typedef std::string State;
+    typedef std::unordered_map<State, int> StateNumbers;
+    typedef SweepPlan<Dimensions> Plan;
+    typedef typename Plan::Step Step;
+
+    int cellOf(int variable) const
+    {
+        return mPlan.step(variable / mSymbolRange).cell;
+    }
+
+    Symbol symbolOf(int variable) const
+    {
+        return (Symbol)(variable % mSymbolRange);
+    }
+
+    // Returns false if there were too many states to finish.
+    bool sweep()
+    {
+        std::vector<State> states(1);
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            int left = hasSymbol(mSequence.getSymbolMask(), s) ? mSequence.count(s) : 0;
+            assert(left < 256);
+            states[0].push_back((char)left);
+        }
+
+        SymbolMask all = mSequence.getSymbolMask();
+        int stepCount = mPlan.stepCount();
+        std::vector<Layer> layers(stepCount);
+        std::vector<State> next;
+        StateNumbers numbers;
+        State after;
+        int total = 1;
+        for(int i = 0; i < stepCount; ++i)
+        {
+            const Step& step = mPlan.step(i);
+            Layer& layer = layers[i];
+            Symbol preset = mValues.atIndex(step.cell);
+            SymbolMask options = (preset != Solver::kUnsetSymbol) ? symbolBit(preset) : all;
+            int width = (int)step.sources.size();
+
+            next.clear();
+            numbers.clear();
+            for(size_t k = 0; k < states.size(); ++k)
+            {
+                const State& before = states[k];
+                int frontier = (int)before.size() - (mSymbolRange - Solver::kFirstSymbol);
+                layer.first.push_back((int)layer.edges.size());
+
+                SymbolMask allowed = options;
+                for(size_t n = 0; n < step.neighbours.size(); ++n)
+                {
+                    allowed &= mSequence.getAdjacentMask((Symbol)(unsigned char)before[step.neighbours[n]]);
+                }
+                for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+                {
+                    if(!hasSymbol(allowed, s) || before[frontier + s - Solver::kFirstSymbol] == 0)
+                    {
+                        continue;
+                    }
+                    after.clear();
+                    for(int slot = 0; slot < width; ++slot)
+                    {
+                        int source = step.sources[slot];
+                        after.push_back(source == Plan::kNewCell ? (char)s : before[source]);
+                    }
+                    after.append(before, frontier, std::string::npos);
+                    --after[width + s - Solver::kFirstSymbol];
+
+                    StateNumbers::const_iterator found = numbers.find(after);
+                    Edge edge = { s, (int)next.size() };
+                    if(found != numbers.end())
+                    {
+                        edge.next = found->second;
+                    }
+                    else
+                    {
+                        numbers[after] = edge.next;
+                        next.push_back(after);
+                    }
+                    layer.edges.push_back(edge);
+                }
+            }
+            layer.first.push_back((int)layer.edges.size());
+            states.swap(next);
+            total += (int)states.size();
+            if(total > kMaxStates)
+            {
+                return false;
+            }
+        }
+
+        // Every state left has filled in the whole board.
+        std::vector<int> below(states.size(), (int)kBase);
+        states.clear();
+        numbers.clear();
+        reduce(layers, below);
+        findOptions();
+        return true;
+    }
+
+    // Turn the states into nodes, from the last step back to the first.
+    void reduce(std::vector<Layer>& layers, std::vector<int>& below)
+    {
+        int terminal = (int)layers.size() * mSymbolRange;
+        Node empty = { terminal, kEmpty, kEmpty };
+        Node base = { terminal, kBase, kBase };
+        mNodes.push_back(empty);
+        mNodes.push_back(base);
+        mCounts.push_back(0);
+        mCounts.push_back(1);
+
+        UniqueTable unique;
+        std::vector<int> above;
+        for(int i = (int)layers.size() - 1; i >= 0; --i)
+        {
+            Layer& layer = layers[i];
+            int stateCount = (int)layer.first.size() - 1;
+            above.assign(stateCount, (int)kEmpty);
+            for(int k = 0; k < stateCount; ++k)
+            {
+                // The highest symbol is asked about last, so it's made first.
+                int node = kEmpty;
+                for(int e = layer.first[k + 1] - 1; e >= layer.first[k]; --e)
+                {
+                    int hi = below[layer.edges[e].next];
+                    if(hi != kEmpty)
+                    {
+                        node = makeNode(unique, i * mSymbolRange + layer.edges[e].symbol, node, hi);
+                    }
+                }
+                above[k] = node;
+            }
+            below.swap(above);
+            Layer().edges.swap(layer.edges);
+            Layer().first.swap(layer.first);
+        }
+        mRoot = below.empty() ? (int)kEmpty : below[0];
+    }
+
+    int makeNode(UniqueTable& unique, int variable, int lo, int hi)
+    {
+        Node node = { variable, lo, hi };
+        typename UniqueTable::const_iterator found = unique.find(node);
+        if(found != unique.end())
+        {
+            return found->second;
+        }
+        int index = (int)mNodes.size();
+        unique[node] = index;
+        mNodes.push_back(node);
+        mCounts.push_back(mCounts[lo] + mCounts[hi]);
+        return index;
+    }
+
+    // Every node below the root is made before it, so going down the
+    // indexes from the root visits each node after everything above it.
+    void findOptions()
+    {
+        mOptions.assign(mTopology.cellCount(), 0);
+        std::vector<bool> reached(mNodes.size(), false);
+        reached[mRoot] = true;
+        for(int node = mRoot; node > kBase; --node)
+        {
+            if(reached[node])
+            {
+                const Node& at = mNodes[node];
+                mOptions[cellOf(at.variable)] |= symbolBit(symbolOf(at.variable));
+                reached[at.lo] = true;
+                reached[at.hi] = true;
+            }
+        }
+    }
+
+    // Take the hi branch all the way down. Every node that isn't a
+    // terminal has a solution on its hi branch.
+    void descend(int node)
+    {
+        while(node != kBase)
+        {
+            const Node& at = mNodes[node];
+            mSolution.placeAt(symbolOf(at.variable), cellOf(at.variable));
+            mPath.push_back(node);
+            node = at.hi;
+        }
+    }
+
+    // Back up to the deepest choice with another symbol to try. Each
+    // cell is filled in again on the way down, so nothing is cleared.
+    bool advance()
+    {
+        while(!mPath.empty())
+        {
+            int lo = mNodes[mPath.back()].lo;
+            mPath.pop_back();
+            if(lo != kEmpty)
+            {
+                descend(lo);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Topology mTopology;
+    const Sequence& mSequence;
+    Values mValues;
+    Values mSolution;
+    GridSolver<Dimensions> mSearch;
+    Plan mPlan;
+    int mSymbolRange;
+    BuildState mBuilt;
+    std::vector<Node> mNodes;
+    std::vector<SolutionCount> mCounts;
+    std::vector<SymbolMask> mOptions;
+    int mRoot;
+    std::vector<int> mPath;
+    bool mStarted;
+};
+
+#endif // SOLVER_SOLUTIONDIAGRAM_H__INCLUDED
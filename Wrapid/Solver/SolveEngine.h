@@ -0,0 +1,43 @@
+#pragma once
+#ifndef SOLVER_SOLVEENGINE_H__INCLUDED
+#define SOLVER_SOLVEENGINE_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridValues.h"
+#include "Solver/SolveResult.h"
+
+namespace Solver
+{
+    template <int Dimensions>
+    class SolveEngine;
+}
+
+// The interface the puzzles use to step through the solutions of a
+// grid, so they don't need to know how the search is being done.
+template <int Dimensions>
+class Solver::SolveEngine
+{
+public:
+    virtual ~SolveEngine()
+    {
+    }
+
+    // Set all initial values on the grid prior to solve.
+    virtual void addPresets(const GridValues<Dimensions>& values) = 0;
+
+    virtual SolveResult nextSolution() = 0;
+
+    // Count the solutions without producing them, stopping early
+    // once the limit is reached if it isn't zero. A limit of two is
+    // enough to tell whether the solution is unique. This is instead
+    // of stepping through with nextSolution, not as well as it.
+    virtual SolutionCount countSolutions(SolutionCount limit) = 0;
+
+    // The most recent solution found.
+    virtual const GridValues<Dimensions>& getSolution() const = 0;
+};
+
+#endif // SOLVER_SOLVEENGINE_H__INCLUDED
@@ -19,6 +19,9 @@ namespace Solver
         // The constraints cannot be satisfied.
         kNoSolution
     };
+
+    // Solution counts can get too large for an int.
+    typedef unsigned long long SolutionCount;
 }
 
 #endif // SOLVER_SOLVERESULT_H__INCLUDED
@@ -7,6 +7,15 @@
  * --------------------------------------------------------------- */
 
 #include "Test.h"
+#include "Solver/SearchOptions.h"
+#include "Solver/ParseResult.h"
+#include "Solver/GridSolver.h"
+
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+
 namespace Solver
 {
     class SolverTest : public UnitTest::Framework
@@ -18,10 +27,11 @@ namespace Solver
             const std::string& target,
             int targetCount,
             int maxSolves,
-            bool logSolutions = false
+            bool logSolutions = false,
+            SearchOptions options = SearchOptions()
         )
         {
-            SolverT solver;
+            SolverT solver(options);
             CHECK_ASSERT(solver.parse(puzzle) == Solver::kParseSucceed);
 
             bool foundSolution = false;
@@ -49,6 +59,135 @@ namespace Solver
             CHECK(foundSolution);
             CHECK(count == targetCount);
         }
+
+        // Walled boards for the hour puzzle on a 4 by 6 grid.
+        static void buildSolve2DGrid(Grid2D& grid)
+        {
+            grid.unwrap(0);
+            grid.unwrap(1);
+
+            grid.setWall(coord(0, 1), coord(1, 1), true);
+            grid.setWall(coord(0, 4), coord(1, 4), true);
+            grid.setWall(coord(1, 0), coord(2, 0), true);
+            grid.setWall(coord(1, 3), coord(2, 3), true);
+            grid.setWall(coord(2, 1), coord(3, 1), true);
+            grid.setWall(coord(2, 4), coord(3, 4), true);
+            
+            grid.setWall(coord(0, 2), coord(0, 3), true);
+            grid.setWall(coord(1, 1), coord(1, 2), true);
+            grid.setWall(coord(1, 4), coord(1, 5), true);
+            grid.setWall(coord(2, 1), coord(2, 2), true);
+            grid.setWall(coord(2, 2), coord(2, 3), true);
+            grid.setWall(coord(2, 4), coord(2, 5), true);
+            grid.setWall(coord(3, 2), coord(3, 3), true);
+        }
+
+        static void buildChallengeGrid(Grid2D& grid)
+        {
+            grid.unwrap(0);
+            grid.unwrap(1);
+
+            grid.setWall(coord(0, 2), coord(1, 2), true);
+            grid.setWall(coord(0, 4), coord(1, 4), true);
+            grid.setWall(coord(1, 4), coord(2, 4), true);
+            grid.setWall(coord(1, 5), coord(2, 5), true);
+            grid.setWall(coord(2, 0), coord(3, 0), true);
+            grid.setWall(coord(2, 2), coord(3, 2), true);
+            grid.setWall(coord(2, 3), coord(3, 3), true);
+            grid.setWall(coord(2, 4), coord(3, 4), true);
+
+            grid.setWall(coord(0, 0), coord(0, 1), true);
+            grid.setWall(coord(0, 3), coord(0, 4), true);
+            grid.setWall(coord(1, 0), coord(1, 1), true);
+            grid.setWall(coord(1, 1), coord(1, 2), true);
+            grid.setWall(coord(1, 2), coord(1, 3), true);
+            grid.setWall(coord(2, 1), coord(2, 2), true);
+        }
+
+        // One long corridor, snaking along the rows of a 4 by 6 board.
+        static void buildSnake(Grid2D& grid)
+        {
+            grid.unwrap(0);
+            grid.unwrap(1);
+            for(int row = 0; row < 3; ++row)
+            {
+                for(int column = 0; column < 6; ++column)
+                {
+                    if(column != (row % 2 == 0 ? 5 : 0))
+                    {
+                        grid.setWall(coord(row, column), coord(row + 1, column), true);
+                    }
+                }
+            }
+        }
+
+        typedef std::vector<Symbol> Board;
+        typedef std::vector<Board> Boards;
+
+        // The values in coordinate order, so that boards can be
+        // compared and sorted.
+        template <int D>
+        static Board asBoard(const GridValues<D>& values)
+        {
+            Board board;
+            Coordinate<D> c;
+            while(c != values.getSize())
+            {
+                board.push_back(values[c]);
+                c = Solver::next(c, values.getSize());
+            }
+            return board;
+        }
+
+        // Every solution the engine has left to step through, sorted.
+        template <int D>
+        static Boards allSolutions(SolveEngine<D>& engine)
+        {
+            Boards solutions;
+            while(engine.nextSolution() == Solver::kFoundSolution)
+            {
+                solutions.push_back(asBoard(engine.getSolution()));
+            }
+            std::sort(solutions.begin(), solutions.end());
+            return solutions;
+        }
+
+        // Every solution the backtracker finds with the options, sorted.
+        template <int D>
+        static Boards searchAll(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets,
+            SearchOptions options = SearchOptions()
+        )
+        {
+            GridSolver<D> solver(grid, symbols, options);
+            solver.addPresets(presets);
+            return allSolutions(solver);
+        }
+
+        // Checks that the engine steps through and counts the same
+        // solutions as the plain backtracker, in whatever order.
+        // Returns how many there are.
+        template <template <int> class Engine, int D>
+        size_t checkSameSolutionSet(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets,
+            SearchOptions options
+        )
+        {
+            Boards expected = searchAll(grid, symbols, presets);
+
+            Engine<D> engine(grid, symbols, options);
+            engine.addPresets(presets);
+            CHECK(allSolutions(engine) == expected);
+
+            Engine<D> counter(grid, symbols, options);
+            counter.addPresets(presets);
+            CHECK(counter.countSolutions(0) == expected.size());
+            return expected.size();
+        }
     };
 }
 
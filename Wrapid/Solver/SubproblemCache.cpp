@@ -0,0 +1,232 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/SubproblemCache.h"
+
+using Solver::SubproblemCache;
+
+SubproblemCache::SubproblemCache(int budget)
+    : mBudget(budget)
+    , mCost(0)
+    , mHand(0)
+    , mHits(0)
+    , mMisses(0)
+{
+}
+
+SubproblemCache::~SubproblemCache()
+{
+}
+
+bool SubproblemCache::findCount(const Key& key, SolutionCount& count)
+{
+    Entry* entry = find(key);
+    if(entry == NULLPTR)
+    {
+        return false;
+    }
+    count = entry->count;
+    return true;
+}
+
+bool SubproblemCache::findUsage(const Key& key, UsageCounts& usage)
+{
+    Entry* entry = find(key);
+    if(entry == NULLPTR)
+    {
+        return false;
+    }
+    usage = entry->usage;
+    return true;
+}
+
+void SubproblemCache::storeCount(const Key& key, SolutionCount count)
+{
+    Entry* entry = store(key, (int)key.size() + 2);
+    if(entry != NULLPTR)
+    {
+        entry->count = count;
+    }
+}
+
+void SubproblemCache::storeUsage(const Key& key, const UsageCounts& usage)
+{
+    int length = usage.empty() ? 0 : (int)usage.begin()->first.size();
+    Entry* entry = store(key, (int)key.size() + (int)usage.size() * (length + 2) + 1);
+    if(entry != NULLPTR)
+    {
+        entry->usage = usage;
+    }
+}
+
+SubproblemCache::Entry* SubproblemCache::find(const Key& key)
+{
+    std::map<Key, int>::const_iterator it = mIndex.find(key);
+    if(it == mIndex.end())
+    {
+        ++mMisses;
+        return NULLPTR;
+    }
+    ++mHits;
+    Entry& entry = mEntries[it->second];
+    entry.referenced = true;
+    return &entry;
+}
+
+// Makes room for the key and returns its entry, or returns
+// null if it would never fit or is already there.
+SubproblemCache::Entry* SubproblemCache::store(const Key& key, int cost)
+{
+    if(cost > mBudget || mIndex.find(key) != mIndex.end())
+    {
+        return NULLPTR;
+    }
+    while(mCost + cost > mBudget)
+    {
+        evict();
+    }
+
+    int slot = (int)mEntries.size();
+    if(mFree.empty())
+    {
+        mEntries.push_back(Entry());
+    }
+    else
+    {
+        slot = mFree.back();
+        mFree.pop_back();
+    }
+    Entry& entry = mEntries[slot];
+    entry.key = key;
+    entry.cost = cost;
+    entry.referenced = false;
+    mIndex[key] = slot;
+    mCost += cost;
+    return &entry;
+}
+
+void SubproblemCache::evict()
+{
+    for(;;)
+    {
+        if(mHand >= (int)mEntries.size())
+        {
+            mHand = 0;
+        }
+        Entry& entry = mEntries[mHand++];
+        if(entry.cost == 0)
+        {
+            continue;
+        }
+        if(entry.referenced)
+        {
+            entry.referenced = false;
+            continue;
+        }
+
+        mIndex.erase(entry.key);
+        mCost -= entry.cost;
+        mFree.push_back(mHand - 1);
+        entry = Entry();
+        return;
+    }
+}
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+
+using Solver::SolutionCount;
+using Solver::SymbolUsage;
+using Solver::UsageCounts;
+
+namespace
+{
+    class SubproblemCacheTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( storeTest );
+            RUN( evictTest );
+            RUN( secondChanceTest );
+        }
+
+        static SubproblemCache::Key key(int a, int b)
+        {
+            SubproblemCache::Key result;
+            result.push_back(a);
+            result.push_back(b);
+            return result;
+        }
+
+        void storeTest()
+        {
+            SubproblemCache cache(1000);
+            SolutionCount count = 0;
+            CHECK(!cache.findCount(key(1, 2), count));
+            cache.storeCount(key(1, 2), 42);
+            CHECK(cache.findCount(key(1, 2), count));
+            CHECK(count == 42);
+            CHECK(!cache.findCount(key(2, 1), count));
+
+            UsageCounts usage;
+            usage[SymbolUsage(3, 1)] = 5;
+            usage[SymbolUsage(3, 0)] = 7;
+            cache.storeUsage(key(3, 4), usage);
+            UsageCounts found;
+            CHECK(cache.findUsage(key(3, 4), found));
+            CHECK(found == usage);
+
+            CHECK(cache.size() == 2);
+            CHECK(cache.hits() == 2);
+            CHECK(cache.misses() == 2);
+
+            // Too big to ever fit.
+            SubproblemCache small(3);
+            small.storeCount(key(1, 2), 1);
+            CHECK(small.size() == 0);
+        }
+
+        void evictTest()
+        {
+            // Room for three counts, each costing four.
+            SubproblemCache cache(12);
+            for(int i = 0; i < 10; ++i)
+            {
+                cache.storeCount(key(i, i), i);
+                CHECK(cache.cost() <= 12);
+            }
+            CHECK(cache.size() == 3);
+
+            // The newest are kept.
+            SolutionCount count = 0;
+            CHECK(cache.findCount(key(9, 9), count));
+            CHECK(count == 9);
+            CHECK(!cache.findCount(key(0, 0), count));
+        }
+
+        void secondChanceTest()
+        {
+            SubproblemCache cache(12);
+            cache.storeCount(key(0, 0), 0);
+            cache.storeCount(key(1, 1), 1);
+            cache.storeCount(key(2, 2), 2);
+
+            // The first entry has been looked up, so the second goes.
+            SolutionCount count = 0;
+            CHECK(cache.findCount(key(0, 0), count));
+            cache.storeCount(key(3, 3), 3);
+            CHECK(cache.findCount(key(0, 0), count));
+            CHECK(!cache.findCount(key(1, 1), count));
+            CHECK(cache.findCount(key(2, 2), count));
+            CHECK(cache.findCount(key(3, 3), count));
+        }
+    };
+}
+
+DECLARE_TEST( SubproblemCacheTest );
+
+#endif // BUILD_TESTS
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef SOLVER_SUBPROBLEMCACHE_H__INCLUDED
+#define SOLVER_SUBPROBLEMCACHE_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/SymbolUsage.h"
+#include "Solver/SolveResult.h"
+
+#include <vector>
+#include <map>
+
+namespace Solver
+{
+    class SubproblemCache;
+}
+
+// Remembers the answers to parts of a search that can come round again
+// by different routes, such as the number of ways of filling in an
+// island of unset cells. The key is whatever decides the answer, such as
+// the cells, the values around them and the symbols left for them.
+//
+// The memory is bounded by a budget, counted in the ints held in the keys
+// and the symbol usages. Once it is full, entries are thrown out with the
+// clock algorithm: a hand goes round the entries, giving any that have
+// been looked up since it last passed a second chance and throwing out
+// the first that hasn't been.
+class Solver::SubproblemCache
+{
+    PREVENT_COPY_AND_ASSIGNMENT(SubproblemCache);
+public:
+    typedef std::vector<int> Key;
+
+    explicit SubproblemCache(int budget);
+    ~SubproblemCache();
+
+    // Each returns false if the key isn't in the cache.
+    bool findCount(const Key& key, SolutionCount& count);
+    bool findUsage(const Key& key, UsageCounts& usage);
+
+    void storeCount(const Key& key, SolutionCount count);
+    void storeUsage(const Key& key, const UsageCounts& usage);
+
+    int size() const
+    {
+        return (int)mIndex.size();
+    }
+
+    int cost() const
+    {
+        return mCost;
+    }
+
+    unsigned long long hits() const
+    {
+        return mHits;
+    }
+
+    unsigned long long misses() const
+    {
+        return mMisses;
+    }
+
+private:
+    struct Entry
+    {
+        Entry()
+            : count(0)
+            , cost(0)
+            , referenced(false)
+        {
+        }
+
+        Key key;
+        UsageCounts usage;
+        SolutionCount count;
+
+        // Zero when the slot is free.
+        int cost;
+        bool referenced;
+    };
+
+    Entry* find(const Key& key);
+    Entry* store(const Key& key, int cost);
+    void evict();
+
+    int mBudget;
+    int mCost;
+    std::vector<Entry> mEntries;
+    std::vector<int> mFree;
+    std::map<Key, int> mIndex;
+    int mHand;
+    unsigned long long mHits;
+    unsigned long long mMisses;
+};
+
+#endif // SOLVER_SUBPROBLEMCACHE_H__INCLUDED
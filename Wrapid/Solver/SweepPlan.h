@@ -0,0 +1,160 @@
+#pragma once
+#ifndef SOLVER_SWEEPPLAN_H__INCLUDED
+#define SOLVER_SWEEPPLAN_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/Grid.h"
+#include "Solver/Topology.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class SweepPlan;
+}
+
+// The order to fill in the cells of a board a layer at a time along one
+// of its dimensions, and what that means for the frontier: the filled in
+// cells that still have empty neighbours. Of the dimensions, the one that
+// keeps the frontier narrowest is used.
+//
+// Each step fills in one cell. It lists the slots of the frontier before
+// it that are next to the cell, and where each slot of the frontier after
+// it comes from, with kNewCell for the cell itself.
+template <int Dimensions>
+class Solver::SweepPlan
+{
+public:
+    enum
+    {
+        kNewCell = -1
+    };
+    struct Step
+    {
+        int cell;
+        std::vector<int> neighbours;
+        std::vector<int> sources;
+    };
+
+    SweepPlan(const Grid<Dimensions>& grid, const Topology& topology)
+    {
+        int best = -1;
+        for(int d = 0; d < Dimensions; ++d)
+        {
+            std::vector<Step> steps;
+            plan(grid, topology, d, steps);
+            int widest = width(steps);
+            if(best < 0 || widest < best)
+            {
+                best = widest;
+                mSteps.swap(steps);
+            }
+        }
+    }
+
+    ~SweepPlan()
+    {
+    }
+
+    int stepCount() const
+    {
+        return (int)mSteps.size();
+    }
+
+    const Step& step(int i) const
+    {
+        return mSteps[i];
+    }
+
+    // The most cells on the frontier at once.
+    int width() const
+    {
+        return width(mSteps);
+    }
+
+private:
+    static int width(const std::vector<Step>& steps)
+    {
+        int widest = 0;
+        for(size_t i = 0; i < steps.size(); ++i)
+        {
+            widest = std::max(widest, (int)steps[i].sources.size());
+        }
+        return widest;
+    }
+
+    static void plan(
+        const Grid<Dimensions>& grid,
+        const Topology& topology,
+        int dimension,
+        std::vector<Step>& steps
+    )
+    {
+        // Order the cells by layer, and within a layer as they are stored.
+        CoordinateOrder<Dimensions> order(grid.getSize());
+        int total = topology.cellCount();
+        std::vector< std::pair<int, int> > layered;
+        for(int cell = 0; cell < total; ++cell)
+        {
+            layered.push_back(std::make_pair(order.coordinate(cell)[dimension], cell));
+        }
+        std::sort(layered.begin(), layered.end());
+        std::vector<int> position(total);
+        for(int i = 0; i < total; ++i)
+        {
+            position[layered[i].second] = i;
+        }
+
+        // A cell leaves the frontier once its last neighbour is filled in.
+        std::vector<int> last(total);
+        for(int cell = 0; cell < total; ++cell)
+        {
+            last[cell] = position[cell];
+            Topology::const_iterator end = topology.end(cell);
+            for(Topology::const_iterator n = topology.begin(cell); n != end; ++n)
+            {
+                last[cell] = std::max(last[cell], position[*n]);
+            }
+        }
+
+        steps.assign(total, Step());
+        std::vector<int> frontier;
+        for(int i = 0; i < total; ++i)
+        {
+            Step& step = steps[i];
+            step.cell = layered[i].second;
+            for(size_t slot = 0; slot < frontier.size(); ++slot)
+            {
+                if(topology.isAdjacent(step.cell, frontier[slot]))
+                {
+                    step.neighbours.push_back((int)slot);
+                }
+            }
+
+            std::vector<int> next;
+            for(size_t slot = 0; slot < frontier.size(); ++slot)
+            {
+                if(last[frontier[slot]] > i)
+                {
+                    next.push_back(frontier[slot]);
+                    step.sources.push_back((int)slot);
+                }
+            }
+            if(last[step.cell] > i)
+            {
+                next.push_back(step.cell);
+                step.sources.push_back(kNewCell);
+            }
+            frontier.swap(next);
+        }
+    }
+
+    std::vector<Step> mSteps;
+};
+
+#endif // SOLVER_SWEEPPLAN_H__INCLUDED
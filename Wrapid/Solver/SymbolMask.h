@@ -0,0 +1,100 @@
+#pragma once
+#ifndef SOLVER_SYMBOLMASK_H__INCLUDED
+#define SOLVER_SYMBOLMASK_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/Symbol.h"
+
+#include <assert.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Solver
+{
+    // A set of symbols with one bit per symbol, indexed by the symbol
+    // value itself. Bit zero (kUnsetSymbol) is never used.
+    typedef unsigned long long SymbolMask;
+
+    enum
+    {
+        kMaxMaskSymbol = 63
+    };
+
+    inline SymbolMask symbolBit(Symbol s)
+    {
+        assert(s >= kFirstSymbol && s <= kMaxMaskSymbol);
+        return 1ULL << s;
+    }
+
+    inline bool hasSymbol(SymbolMask mask, Symbol s)
+    {
+        return (mask & symbolBit(s)) != 0;
+    }
+
+    inline int countSymbols(SymbolMask mask)
+    {
+        mask = mask - ((mask >> 1) & 0x5555555555555555ULL);
+        mask = (mask & 0x3333333333333333ULL) + ((mask >> 2) & 0x3333333333333333ULL);
+        mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (int)((mask * 0x0101010101010101ULL) >> 56);
+    }
+
+    // The symbol of the highest set bit. The mask must not be empty.
+    inline Symbol highestSymbol(SymbolMask mask)
+    {
+        assert(mask != 0);
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        unsigned long high = (unsigned long)(mask >> 32);
+        if(high != 0)
+        {
+            _BitScanReverse(&index, high);
+            return (Symbol)index + 32;
+        }
+        _BitScanReverse(&index, (unsigned long)mask);
+        return (Symbol)index;
+#elif defined(__GNUC__)
+        return 63 - __builtin_clzll(mask);
+#else
+        Symbol s = kMaxMaskSymbol;
+        while((mask & (1ULL << s)) == 0)
+        {
+            --s;
+        }
+        return s;
+#endif
+    }
+
+    // The symbol of the lowest set bit. The mask must not be empty.
+    inline Symbol lowestSymbol(SymbolMask mask)
+    {
+        assert(mask != 0);
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        unsigned long low = (unsigned long)mask;
+        if(low != 0)
+        {
+            _BitScanForward(&index, low);
+            return (Symbol)index;
+        }
+        _BitScanForward(&index, (unsigned long)(mask >> 32));
+        return (Symbol)index + 32;
+#elif defined(__GNUC__)
+        return __builtin_ctzll(mask);
+#else
+        Symbol s = 0;
+        while((mask & (1ULL << s)) == 0)
+        {
+            ++s;
+        }
+        return s;
+#endif
+    }
+}
+
+#endif // SOLVER_SYMBOLMASK_H__INCLUDED
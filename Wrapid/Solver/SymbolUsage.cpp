@@ -0,0 +1,175 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/SymbolUsage.h"
+#include "Solver/Sequence.h"
+
+#include <assert.h>
+
+using Solver::Symbol;
+using Solver::SymbolUsage;
+using Solver::UsageCounts;
+
+void Solver::joinUsage(
+    const UsageCounts& first,
+    const UsageCounts& second,
+    const SymbolUsage& limits,
+    UsageCounts& joined
+)
+{
+    joined.clear();
+    SymbolUsage sum(limits.size(), 0);
+    UsageCounts::const_iterator firstEnd = first.end();
+    UsageCounts::const_iterator secondEnd = second.end();
+    for(UsageCounts::const_iterator a = first.begin(); a != firstEnd; ++a)
+    {
+        for(UsageCounts::const_iterator b = second.begin(); b != secondEnd; ++b)
+        {
+            bool fits = true;
+            for(int s = 0; s < (int)limits.size() && fits; ++s)
+            {
+                sum[s] = a->first[s] + b->first[s];
+                fits = sum[s] <= limits[s];
+            }
+            if(fits)
+            {
+                joined[sum] += a->second * b->second;
+            }
+        }
+    }
+}
+
+Solver::SolutionCount Solver::totalCount(const UsageCounts& counts)
+{
+    SolutionCount total = 0;
+    UsageCounts::const_iterator end = counts.end();
+    for(UsageCounts::const_iterator it = counts.begin(); it != end; ++it)
+    {
+        total += it->second;
+    }
+    return total;
+}
+
+SymbolUsage Solver::leftOver(const SymbolUsage& remaining, const SymbolUsage& used)
+{
+    SymbolUsage left(remaining);
+    for(int s = 0; s < (int)left.size(); ++s)
+    {
+        left[s] -= used[s];
+    }
+    return left;
+}
+
+Symbol Solver::makeRegionSequence(
+    const Sequence& sequence,
+    const SymbolUsage& limits,
+    int fillerCount,
+    Sequence& region
+)
+{
+    Sequence::SymbolSet symbols = sequence.getSymbols();
+    Sequence::SymbolSet::const_iterator end = symbols.end();
+    for(Sequence::SymbolSet::const_iterator s = symbols.begin(); s != end; ++s)
+    {
+        Symbol added = region.addSymbol(limits[*s]);
+        assert(added == *s);
+    }
+    for(Sequence::SymbolSet::const_iterator s = symbols.begin(); s != end; ++s)
+    {
+        const Sequence::SymbolSet& adjacent = sequence.getAdjacent(*s);
+        Sequence::SymbolSet::const_iterator adjacentEnd = adjacent.end();
+        for(Sequence::SymbolSet::const_iterator t = adjacent.begin(); t != adjacentEnd; ++t)
+        {
+            // Each pair once.
+            if(*t >= *s)
+            {
+                region.makeAdjacent(*s, *t);
+            }
+        }
+    }
+    return region.addWildcard(fillerCount);
+}
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+
+using Solver::Sequence;
+using Solver::joinUsage;
+using Solver::totalCount;
+using Solver::leftOver;
+using Solver::makeRegionSequence;
+
+namespace
+{
+    class SymbolUsageTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( joinTest );
+            RUN( regionSequenceTest );
+        }
+
+        static SymbolUsage usage(int a, int b)
+        {
+            SymbolUsage result(3, 0);
+            result[1] = a;
+            result[2] = b;
+            return result;
+        }
+
+        void joinTest()
+        {
+            UsageCounts first;
+            first[usage(1, 0)] = 2;
+            first[usage(0, 1)] = 3;
+            UsageCounts second;
+            second[usage(1, 0)] = 5;
+            second[usage(0, 1)] = 7;
+
+            UsageCounts joined;
+            joinUsage(first, second, usage(1, 1), joined);
+            CHECK(joined.size() == 1);
+            CHECK(joined[usage(1, 1)] == 2 * 7 + 3 * 5);
+
+            joinUsage(first, second, usage(2, 2), joined);
+            CHECK(joined.size() == 3);
+            CHECK(joined[usage(2, 0)] == 10);
+            CHECK(joined[usage(0, 2)] == 21);
+            CHECK(totalCount(joined) == 60);
+
+            UsageCounts empty;
+            joinUsage(first, empty, usage(2, 2), joined);
+            CHECK(joined.empty());
+
+            CHECK(leftOver(usage(2, 2), usage(1, 0)) == usage(1, 2));
+        }
+
+        void regionSequenceTest()
+        {
+            Sequence cards(13, 4);
+            cards.addJoker();
+            SymbolUsage limits(Solver::kCardPuzzleJoker + 1, 1);
+            limits[5] = 3;
+
+            Sequence region;
+            Symbol filler = makeRegionSequence(cards, limits, 10, region);
+            CHECK(filler == Solver::kCardPuzzleJoker + 1);
+            CHECK(region.count(5) == 3);
+            CHECK(region.count(6) == 1);
+            CHECK(region.count(filler) == 10);
+            for(Symbol s = Solver::kFirstSymbol; s <= Solver::kCardPuzzleJoker; ++s)
+            {
+                CHECK(region.getAdjacentMask(s) == (cards.getAdjacentMask(s) | Solver::symbolBit(filler)));
+            }
+            CHECK(region.getAdjacentMask(filler) == region.getSymbolMask());
+        }
+    };
+}
+
+DECLARE_TEST( SymbolUsageTest );
+
+#endif // BUILD_TESTS
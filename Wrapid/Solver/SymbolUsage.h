@@ -0,0 +1,56 @@
+#pragma once
+#ifndef SOLVER_SYMBOLUSAGE_H__INCLUDED
+#define SOLVER_SYMBOLUSAGE_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/Symbol.h"
+#include "Solver/SolveResult.h"
+
+#include <vector>
+#include <map>
+
+namespace Solver
+{
+    class Sequence;
+
+    // How many of each symbol a part of the board uses, indexed by symbol.
+    typedef std::vector<int> SymbolUsage;
+
+    // The number of ways of filling in a part of the board, by the
+    // symbols each way uses.
+    typedef std::map<SymbolUsage, SolutionCount> UsageCounts;
+
+    // Combine the ways of filling in two parts of the board that don't
+    // touch each other into the ways of filling in both, keeping those
+    // that use no more of each symbol than the limits allow. This is a
+    // knapsack over the symbol counts.
+    void joinUsage(
+        const UsageCounts& first,
+        const UsageCounts& second,
+        const SymbolUsage& limits,
+        UsageCounts& joined
+    );
+
+    SolutionCount totalCount(const UsageCounts& counts);
+
+    // What is left of the remaining symbols once some have been used.
+    SymbolUsage leftOver(const SymbolUsage& remaining, const SymbolUsage& used);
+
+    // Fill in an empty sequence with the same symbols and adjacency as
+    // another, each allowed as often as the limits say, and then one more
+    // symbol that can sit next to anything, allowed fillerCount times.
+    // Presetting the filler on every cell outside a region leaves a
+    // puzzle that is just the region, as long as the filler is kept off
+    // the region by the walls or by set cells around it. Returns the filler.
+    Symbol makeRegionSequence(
+        const Sequence& sequence,
+        const SymbolUsage& limits,
+        int fillerCount,
+        Sequence& region
+    );
+}
+
+#endif // SOLVER_SYMBOLUSAGE_H__INCLUDED
@@ -0,0 +1,193 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/Symmetry.h"
+
+using Solver::Symmetry;
+
+Symmetry::~Symmetry()
+{
+}
+
+// The map is a bijection on a finite graph, so if every adjacency maps
+// to an adjacency then none can be left over to map to a non-adjacency.
+bool Symmetry::preservesAdjacency(const Cells& map, const Topology& topology)
+{
+    int cellCount = (int)map.size();
+    for(int cell = 0; cell < cellCount; ++cell)
+    {
+        int image = map[cell];
+        if(topology.degree(image) != topology.degree(cell))
+        {
+            return false;
+        }
+        Topology::const_iterator end = topology.end(cell);
+        for(Topology::const_iterator n = topology.begin(cell); n != end; ++n)
+        {
+            if(!topology.isAdjacent(image, map[*n]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Different isometries can move the cells the same way, for instance
+// reflecting and translating along an axis of size two. Keep one of
+// each, and drop the identity.
+void Symmetry::removeDuplicates(int cellCount)
+{
+    std::sort(mMaps.begin(), mMaps.end());
+    mMaps.erase(std::unique(mMaps.begin(), mMaps.end()), mMaps.end());
+
+    Cells identity(cellCount);
+    for(int cell = 0; cell < cellCount; ++cell)
+    {
+        identity[cell] = cell;
+    }
+    Maps::iterator found = std::lower_bound(mMaps.begin(), mMaps.end(), identity);
+    if(found != mMaps.end() && *found == identity)
+    {
+        mMaps.erase(found);
+    }
+}
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+
+using Solver::Grid2D;
+using Solver::Grid;
+using Solver::GridValues;
+using Solver::Topology;
+using Solver::coord;
+
+namespace
+{
+    class SymmetryTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( torusTest );
+            RUN( presetTest );
+            RUN( wallTest );
+            RUN( cubeTest );
+            RUN( leaderTest );
+        }
+
+        static int symmetryCount(const Grid2D& grid, const GridValues<2>& presets)
+        {
+            Topology topology(grid);
+            Symmetry symmetry(grid, topology, presets);
+            return symmetry.size();
+        }
+
+        void torusTest()
+        {
+            // 24 translations, each with or without reflecting either axis.
+            Grid2D grid(coord(4, 6));
+            GridValues<2> presets(grid.getSize());
+            CHECK(symmetryCount(grid, presets) == 24 * 4 - 1);
+
+            // A square can also be rotated, doubling it.
+            Grid2D square(coord(4, 4));
+            GridValues<2> squarePresets(square.getSize());
+            CHECK(symmetryCount(square, squarePresets) == 16 * 8 - 1);
+
+            // Unwrapping an axis stops translating along it.
+            grid.unwrap(0);
+            CHECK(symmetryCount(grid, presets) == 6 * 4 - 1);
+        }
+
+        void presetTest()
+        {
+            // Only the reflections through the preset are left.
+            Grid2D grid(coord(4, 6));
+            GridValues<2> presets(grid.getSize());
+            presets.place(3, coord(1, 2));
+            CHECK(symmetryCount(grid, presets) == 3);
+
+            // Matching presets half way round are swapped by a translation.
+            presets.place(3, coord(3, 5));
+            CHECK(symmetryCount(grid, presets) == 7);
+
+            // Nothing moves a preset with a different value to everything else
+            // without also moving the others.
+            presets.place(4, coord(2, 3));
+            CHECK(symmetryCount(grid, presets) == 0);
+        }
+
+        void wallTest()
+        {
+            Grid2D grid(coord(4, 6));
+            grid.setWall(coord(0, 0), coord(0, 1), true);
+            GridValues<2> presets(grid.getSize());
+
+            // Reflections along the wall, and across it.
+            CHECK(symmetryCount(grid, presets) == 3);
+        }
+
+        void cubeTest()
+        {
+            // Six ways to order the axes, eight reflections, 27 translations.
+            Grid<3> grid(coord(3, 3, 3));
+            GridValues<3> presets(grid.getSize());
+            Topology topology(grid);
+            Symmetry symmetry(grid, topology, presets);
+            CHECK(symmetry.size() == 6 * 8 * 27 - 1);
+        }
+
+        void leaderTest()
+        {
+            // A triangular prism: each column is a pair, and the rows wrap.
+            Grid2D grid(coord(2, 3));
+            GridValues<2> values(grid.getSize());
+            Topology topology(grid);
+            Symmetry symmetry(grid, topology, values);
+            CHECK_ASSERT(symmetry.size() == 11);
+            CHECK(symmetry.allows(values));
+
+            values.place(1, coord(0, 0));
+            values.place(2, coord(0, 1));
+            values.place(3, coord(0, 2));
+            values.place(4, coord(1, 0));
+            values.place(5, coord(1, 1));
+            values.place(6, coord(1, 2));
+            std::vector< GridValues<2> > images;
+            symmetry.images(values, images);
+            CHECK_ASSERT(images.size() == 12);
+            CHECK(Solver::isMatch(images[0], values));
+
+            // Exactly one of them is the leader.
+            int leaders = 0;
+            for(size_t i = 0; i < images.size(); ++i)
+            {
+                if(symmetry.allows(images[i]))
+                {
+                    ++leaders;
+                }
+            }
+            CHECK(leaders == 1);
+
+            // Partial solutions are only ruled out once they can't lead. The
+            // first cell can be anything, but swapping the columns would
+            // put something bigger there.
+            GridValues<2> partial(grid.getSize());
+            partial.place(1, coord(0, 0));
+            CHECK(symmetry.allows(partial));
+            partial.place(6, coord(1, 0));
+            CHECK(!symmetry.allows(partial));
+            partial.place(6, coord(0, 0));
+            partial.place(1, coord(1, 0));
+            CHECK(symmetry.allows(partial));
+        }
+    };
+}
+
+DECLARE_TEST( SymmetryTest );
+
+#endif // BUILD_TESTS
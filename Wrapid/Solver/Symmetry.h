@@ -0,0 +1,246 @@
+#pragma once
+#ifndef SOLVER_SYMMETRY_H__INCLUDED
+#define SOLVER_SYMMETRY_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/Grid.h"
+#include "Solver/GridValues.h"
+#include "Solver/Topology.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace Solver
+{
+    class Symmetry;
+}
+
+// The symmetries of a board: the ways of moving every cell to another
+// that keep the same cells adjacent and the presets where they were.
+// On a torus these include the translations along every wrapped axis,
+// and then reflections, and rotations between axes of the same size.
+//
+// Every solution has an image under each symmetry which is also a
+// solution. To only find one out of each such set, the search can
+// insist that a solution is the lexicographically greatest of its
+// images, as laid out in cell index order (the lex-leader).
+class Solver::Symmetry
+{
+    PREVENT_COPY_AND_ASSIGNMENT(Symmetry);
+public:
+    typedef std::vector<int> Cells;
+
+    // Cells are indexed as in the Topology built from the grid.
+    template <int Dimensions>
+    Symmetry(const Grid<Dimensions>& grid, const Topology& topology, const GridValues<Dimensions>& presets)
+    {
+        Coordinate<Dimensions> size = grid.getSize();
+        CoordinateOrder<Dimensions> order(size);
+        int cellCount = topology.cellCount();
+
+        // Try every isometry of the torus: permute the axes, reflect
+        // some of them and then translate.
+        int axes[Dimensions];
+        for(int d = 0; d < Dimensions; ++d)
+        {
+            axes[d] = d;
+        }
+        Cells map(cellCount);
+        do
+        {
+            if(!hasMatchingSizes(size, axes))
+            {
+                continue;
+            }
+            for(int reflections = 0; reflections < (1 << Dimensions); ++reflections)
+            {
+                Coordinate<Dimensions> shift;
+                while(shift != size)
+                {
+                    for(int cell = 0; cell < cellCount; ++cell)
+                    {
+                        Coordinate<Dimensions> c = order.coordinate(cell);
+                        Coordinate<Dimensions> image;
+                        for(int d = 0; d < Dimensions; ++d)
+                        {
+                            int value = c[axes[d]];
+                            if((reflections & (1 << d)) != 0)
+                            {
+                                value = size[d] - 1 - value;
+                            }
+                            image[d] = (value + shift[d]) % size[d];
+                        }
+                        map[cell] = (int)order(image);
+                    }
+                    if(isSymmetry(map, topology, presets))
+                    {
+                        mMaps.push_back(map);
+                    }
+                    shift = next(shift, size);
+                }
+            }
+        } while(std::next_permutation(axes, axes + Dimensions));
+
+        removeDuplicates(cellCount);
+    }
+
+    ~Symmetry();
+
+    // The number of symmetries, not counting the identity.
+    int size() const
+    {
+        return (int)mMaps.size();
+    }
+
+    // Symmetry i moves the contents of cell map(i)[c] to cell c.
+    const Cells& map(int i) const
+    {
+        return mMaps[i];
+    }
+
+    // Checks a partial solution against the lex-leader constraint for every
+    // symmetry. It only fails once there is a set cell which is smaller than
+    // its image, with all of the cells before it set and equal to theirs.
+    template <class Values>
+    bool allows(const Values& values) const
+    {
+        for(Maps::const_iterator m = mMaps.begin(); m != mMaps.end(); ++m)
+        {
+            const Cells& map = *m;
+            int cellCount = (int)map.size();
+            for(int cell = 0; cell < cellCount; ++cell)
+            {
+                Symbol s = values.atIndex(cell);
+                Symbol image = values.atIndex(map[cell]);
+                if(s == Solver::kUnsetSymbol || image == Solver::kUnsetSymbol)
+                {
+                    // Can't tell yet.
+                    break;
+                }
+                if(s != image)
+                {
+                    if(s < image)
+                    {
+                        return false;
+                    }
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    // All of the distinct images of a complete solution, starting
+    // with the solution itself.
+    template <class Values>
+    void images(const Values& solution, std::vector<Values>& result) const
+    {
+        Boards boards;
+        distinctImages(solution, boards);
+
+        int cellCount = solution.valueCount();
+        Board original = asBoard(solution);
+        result.clear();
+        result.push_back(solution);
+        for(Boards::const_iterator b = boards.begin(); b != boards.end(); ++b)
+        {
+            if(*b != original)
+            {
+                Values image(solution.getSize());
+                for(int cell = 0; cell < cellCount; ++cell)
+                {
+                    image.placeAt((*b)[cell], cell);
+                }
+                result.push_back(image);
+            }
+        }
+    }
+
+    // The number of distinct images of a complete solution, including itself.
+    template <class Values>
+    int orbitSize(const Values& solution) const
+    {
+        Boards boards;
+        distinctImages(solution, boards);
+        Board original = asBoard(solution);
+        bool hasOriginal = std::binary_search(boards.begin(), boards.end(), original);
+        return (int)boards.size() + (hasOriginal ? 0 : 1);
+    }
+
+private:
+    typedef std::vector<Cells> Maps;
+    typedef std::vector<Symbol> Board;
+    typedef std::vector<Board> Boards;
+
+    template <class Values>
+    static Board asBoard(const Values& solution)
+    {
+        int cellCount = solution.valueCount();
+        Board board(cellCount);
+        for(int cell = 0; cell < cellCount; ++cell)
+        {
+            board[cell] = solution.atIndex(cell);
+        }
+        return board;
+    }
+
+    // The images under the symmetries other than the identity,
+    // sorted and without repeats.
+    template <class Values>
+    void distinctImages(const Values& solution, Boards& boards) const
+    {
+        int cellCount = solution.valueCount();
+        boards.clear();
+        boards.reserve(mMaps.size());
+        for(Maps::const_iterator m = mMaps.begin(); m != mMaps.end(); ++m)
+        {
+            Board board(cellCount);
+            for(int cell = 0; cell < cellCount; ++cell)
+            {
+                board[cell] = solution.atIndex((*m)[cell]);
+            }
+            boards.push_back(board);
+        }
+        std::sort(boards.begin(), boards.end());
+        boards.erase(std::unique(boards.begin(), boards.end()), boards.end());
+    }
+
+    // Axes can only be swapped if they are the same size.
+    template <int Dimensions>
+    static bool hasMatchingSizes(const Coordinate<Dimensions>& size, const int* axes)
+    {
+        for(int d = 0; d < Dimensions; ++d)
+        {
+            if(size[d] != size[axes[d]])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <int Dimensions>
+    static bool isSymmetry(const Cells& map, const Topology& topology, const GridValues<Dimensions>& presets)
+    {
+        int cellCount = (int)map.size();
+        for(int cell = 0; cell < cellCount; ++cell)
+        {
+            if(presets.atIndex(map[cell]) != presets.atIndex(cell))
+            {
+                return false;
+            }
+        }
+        return preservesAdjacency(map, topology);
+    }
+
+    static bool preservesAdjacency(const Cells& map, const Topology& topology);
+
+    void removeDuplicates(int cellCount);
+
+    Maps mMaps;
+};
+
+#endif // SOLVER_SYMMETRY_H__INCLUDED
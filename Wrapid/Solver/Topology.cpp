@@ -0,0 +1,124 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/Topology.h"
+
+#include <algorithm>
+
+using Solver::Topology;
+
+Topology::Topology(const Adjacency& adjacency)
+{
+    build(adjacency);
+}
+
+Topology::~Topology()
+{
+}
+
+bool Topology::isAdjacent(int cell, int other) const
+{
+    return std::find(begin(cell), end(cell), other) != end(cell);
+}
+
+void Topology::build(const Adjacency& adjacency)
+{
+    mOffsets.clear();
+    mNeighbours.clear();
+    mOffsets.reserve(adjacency.size() + 1);
+
+    for(Adjacency::const_iterator cell = adjacency.begin(); cell != adjacency.end(); ++cell)
+    {
+        mOffsets.push_back((int)mNeighbours.size());
+        for(Cells::const_iterator n = cell->begin(); n != cell->end(); ++n)
+        {
+            // A grid axis of size two wraps around to the same neighbour
+            // in both directions, but it is still only one neighbour.
+            if(std::find(mNeighbours.begin() + mOffsets.back(), mNeighbours.end(), *n) == mNeighbours.end())
+            {
+                mNeighbours.push_back(*n);
+            }
+        }
+    }
+    mOffsets.push_back((int)mNeighbours.size());
+}
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+
+using Solver::Grid2D;
+using Solver::coord;
+
+namespace
+{
+    class TopologyTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( gridTest );
+            RUN( adjacencyTest );
+        }
+
+        void gridTest()
+        {
+            Grid2D grid(coord(3, 4));
+            grid.unwrap(0);
+            grid.setWall(coord(1, 1), coord(1, 2), true);
+
+            Topology topology(grid);
+            CHECK_ASSERT(topology.cellCount() == grid.getTotalSize());
+
+            Solver::CoordinateOrder<2> order(grid.getSize());
+            Solver::Coordinate2D c;
+            while(c != grid.getSize())
+            {
+                int cell = (int)order(c);
+                Topology::const_iterator it = topology.begin(cell);
+                Grid2D::Neighbours n = grid.getNeighbours(c, false);
+                while(n.advance())
+                {
+                    CHECK_ASSERT(it != topology.end(cell));
+                    CHECK(*it == (int)order(n.current()));
+                    ++it;
+                }
+                CHECK(it == topology.end(cell));
+                c = Solver::next(c, grid.getSize());
+            }
+
+            CHECK(topology.degree((int)order(coord(0, 0))) == 3);
+            CHECK(topology.degree((int)order(coord(1, 1))) == 3);
+            CHECK(!topology.isAdjacent((int)order(coord(1, 1)), (int)order(coord(1, 2))));
+            CHECK(topology.isAdjacent((int)order(coord(0, 0)), (int)order(coord(0, 3))));
+        }
+
+        void adjacencyTest()
+        {
+            // A triangle with a tail, where one neighbour is listed twice.
+            Topology::Adjacency adjacency(4);
+            adjacency[0].push_back(1);
+            adjacency[0].push_back(2);
+            adjacency[1].push_back(0);
+            adjacency[1].push_back(2);
+            adjacency[2].push_back(0);
+            adjacency[2].push_back(1);
+            adjacency[2].push_back(3);
+            adjacency[3].push_back(2);
+            adjacency[3].push_back(2);
+
+            Topology topology(adjacency);
+            CHECK(topology.cellCount() == 4);
+            CHECK(topology.degree(2) == 3);
+            CHECK(topology.degree(3) == 1);
+            CHECK(topology.isAdjacent(3, 2));
+            CHECK(!topology.isAdjacent(3, 0));
+        }
+    };
+}
+
+DECLARE_TEST( TopologyTest );
+
+#endif // BUILD_TESTS
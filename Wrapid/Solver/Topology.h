@@ -0,0 +1,90 @@
+#pragma once
+#ifndef SOLVER_TOPOLOGY_H__INCLUDED
+#define SOLVER_TOPOLOGY_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/Grid.h"
+
+#include <vector>
+
+namespace Solver
+{
+    class Topology;
+}
+
+// A frozen, compiled form of the adjacency of a board. Cells are
+// identified by their linear index, and the neighbours of every
+// cell are stored contiguously (compressed sparse rows), so visiting
+// them is a tight loop over a small array.
+//
+// It is built once the walls are final. Nothing in it depends on the
+// board being a grid, so other topologies can be described directly
+// with adjacency lists.
+class Solver::Topology
+{
+public:
+    typedef std::vector<int> Cells;
+    typedef std::vector<Cells> Adjacency;
+    typedef Cells::const_iterator const_iterator;
+
+    // Build from explicit adjacency lists, one per cell.
+    // Repeated neighbours are only kept once.
+    explicit Topology(const Adjacency& adjacency);
+
+    // Build from the walls of a grid, with cells indexed in CoordinateOrder.
+    // The neighbours of each cell are in the same order as Grid::Neighbours.
+    template <int Dimensions>
+    explicit Topology(const Grid<Dimensions>& grid)
+    {
+        CoordinateOrder<Dimensions> order(grid.getSize());
+        Adjacency adjacency(grid.getTotalSize());
+        Coordinate<Dimensions> c;
+        while(c != grid.getSize())
+        {
+            Cells& cells = adjacency[order(c)];
+            typename Grid<Dimensions>::Neighbours n = grid.getNeighbours(c, false);
+            while(n.advance())
+            {
+                cells.push_back((int)order(n.current()));
+            }
+            c = next(c, grid.getSize());
+        }
+        build(adjacency);
+    }
+
+    ~Topology();
+
+    int cellCount() const
+    {
+        return (int)mOffsets.size() - 1;
+    }
+
+    int degree(int cell) const
+    {
+        return mOffsets[cell + 1] - mOffsets[cell];
+    }
+
+    // The neighbours of a cell are in [begin(cell), end(cell)).
+    const_iterator begin(int cell) const
+    {
+        return mNeighbours.begin() + mOffsets[cell];
+    }
+
+    const_iterator end(int cell) const
+    {
+        return mNeighbours.begin() + mOffsets[cell + 1];
+    }
+
+    bool isAdjacent(int cell, int other) const;
+
+private:
+    void build(const Adjacency& adjacency);
+
+    Cells mOffsets;
+    Cells mNeighbours;
+};
+
+#endif // SOLVER_TOPOLOGY_H__INCLUDED
@@ -0,0 +1,176 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/TransferCounter.h"
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+#include "Solver/HourPuzzleIO.h"
+#include "Solver/PuzzleIOUtils.h"
+
+using namespace Solver;
+
+namespace
+{
+    class TransferCounterTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( hourTest );
+            RUN( wrapTest );
+            RUN( presetTest );
+            RUN( levelsTest );
+        }
+
+        template <int D>
+        static SolutionCount searchCount(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets
+        )
+        {
+            GridSolver<D> solver(grid, symbols);
+            solver.addPresets(presets);
+            return solver.countSolutions(0);
+        }
+
+        template <int D>
+        static SolutionCount transferCount(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets,
+            SolutionCount limit = 0
+        )
+        {
+            TransferCounter<D> counter(grid, symbols);
+            counter.addPresets(presets);
+            return counter.countSolutions(limit);
+        }
+
+        // The lessConstrained hour puzzle.
+        void buildHourGrid(Grid2D& grid, GridValues2D& presets)
+        {
+            const char* puzzle[9] = {
+                "+----+----+----+----+----+----+",
+                "| 12 |              |         |",
+                "+    +    +----+    +----+    +",
+                "|    |    |    |              |",
+                "+    +    +    +----+----+----+",
+                "|         |                   |",
+                "+----+    +----+----+----+    +",
+                "|                             |",
+                "+----+----+----+----+----+----+"
+            };
+            ParseResult result = parse(grid, presets, asStrings(puzzle, grid.getSize()));
+            CHECK_ASSERT(result == kParseSucceed);
+        }
+
+        void hourTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            buildHourGrid(grid, presets);
+            Sequence symbols(12, 2);
+
+            SolutionCount expected = searchCount(grid, symbols, presets);
+            CHECK(expected == 48);
+            CHECK(transferCount(grid, symbols, presets) == expected);
+            CHECK(transferCount(grid, symbols, presets, 3) == 3);
+
+            // The sweep goes along the rows, so the frontier is a column.
+            TransferCounter<2> counter(grid, symbols);
+            CHECK(counter.frontierWidth() <= 4);
+
+            // Stepping through is left to the search.
+            counter.addPresets(presets);
+            SolutionCount stepped = 0;
+            while(counter.nextSolution() == kFoundSolution)
+            {
+                CHECK(counter.getSolution()[coord(0, 0)] == 12);
+                ++stepped;
+            }
+            CHECK(stepped == expected);
+        }
+
+        void wrapTest()
+        {
+            // With no walls the board wraps round both ways, and the
+            // first column stays on the frontier until the end.
+            Grid2D grid(coord(4, 6));
+            Sequence symbols(12, 2);
+            GridValues2D presets(grid.getSize());
+            presets.place(1, coord(0, 0));
+            presets.place(7, coord(2, 3));
+
+            TransferCounter<2> counter(grid, symbols);
+            CHECK(counter.frontierWidth() <= 8);
+            CHECK(transferCount(grid, symbols, presets) == searchCount(grid, symbols, presets));
+
+            Grid2D band(coord(6, 2));
+            Sequence fours(4, 3);
+            GridValues2D none(band.getSize());
+            CHECK(transferCount(band, fours, none) == 800);
+        }
+
+        void presetTest()
+        {
+            Grid2D grid(coord(4, 6));
+            GridValues2D presets(grid.getSize());
+            buildHourGrid(grid, presets);
+            Sequence symbols(12, 2);
+
+            // Neighbouring presets that can't go together.
+            GridValues2D clash(grid.getSize());
+            clash.place(1, coord(0, 1));
+            clash.place(5, coord(0, 2));
+            CHECK(transferCount(grid, symbols, clash) == 0);
+            TransferCounter<2> stepping(grid, symbols);
+            stepping.addPresets(clash);
+            CHECK(stepping.nextSolution() == kNoSolution);
+
+            // More of a symbol than the sequence has.
+            GridValues2D overused(grid.getSize());
+            overused.place(3, coord(0, 0));
+            overused.place(3, coord(3, 3));
+            overused.place(3, coord(2, 5));
+            CHECK(transferCount(grid, symbols, overused) == 0);
+
+            // A filled in board is one solution.
+            GridValues2D solved(grid.getSize());
+            Symbol solution[4][6] = {
+                {12,  7,  6,  5,  8,  7},
+                {11,  8,  1,  4,  5,  6},
+                {10,  9,  2,  3,  4,  3},
+                { 9, 10, 11, 12,  1,  2}
+            };
+            for(int i = 0; i < 4; ++i)
+            {
+                for(int j = 0; j < 6; ++j)
+                {
+                    solved.place(solution[i][j], coord(i, j));
+                }
+            }
+            CHECK(transferCount(grid, symbols, solved) == 1);
+        }
+
+        void levelsTest()
+        {
+            // Nothing in it is particular to two dimensions.
+            Grid<3> grid(coord(2, 2, 3));
+            grid.unwrap(2);
+            Sequence symbols(4, 3);
+            GridValues<3> presets(grid.getSize());
+            CHECK(transferCount(grid, symbols, presets) == 800);
+            presets.place(1, coord(0, 0, 0));
+            CHECK(transferCount(grid, symbols, presets) == 200);
+        }
+    };
+}
+
+DECLARE_TEST( TransferCounterTest );
+
+#endif // BUILD_TESTS
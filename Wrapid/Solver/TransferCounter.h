@@ -0,0 +1,196 @@
+#pragma once
+#ifndef SOLVER_TRANSFERCOUNTER_H__INCLUDED
+#define SOLVER_TRANSFERCOUNTER_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridSolver.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/Topology.h"
+#include "Solver/SweepPlan.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <assert.h>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class TransferCounter;
+}
+
+// Counts the solutions of a narrow board without searching them. The
+// cells are filled in a layer at a time along the board's longest way,
+// and rather than following each partial solution it keeps the number of
+// ways of reaching each state of the frontier: the values in the filled
+// in cells that still have empty neighbours, and the symbols left. Two
+// partial solutions that agree on both can be finished in the same ways,
+// so they are counted together. With the 4 x N hour puzzle the frontier
+// is a column, or the first and last columns when the board wraps round.
+//
+// Only counting works this way. Stepping through the solutions is handed
+// to a GridSolver, as is counting if the states outgrow kMaxStates.
+template <int Dimensions>
+class Solver::TransferCounter : public Solver::SolveEngine<Dimensions>
+{
+    PREVENT_COPY_AND_ASSIGNMENT(TransferCounter);
+public:
+    typedef Grid<Dimensions> GridD;
+    typedef GridValues<Dimensions> Values;
+    typedef Coordinate<Dimensions> Coord;
+
+    TransferCounter(const GridD& grid, const Sequence& sequence, SearchOptions options = SearchOptions())
+        : mTopology(grid)
+        , mSequence(sequence)
+        , mValues(grid.getSize())
+        , mSearch(grid, sequence, options)
+        , mPlan(grid, mTopology)
+        , mSymbolRange(highestSymbol(sequence.getSymbolMask()) + 1)
+        , mStateCount(0)
+    {
+    }
+
+    ~TransferCounter()
+    {
+    }
+
+    void addPresets(const Values& values)
+    {
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
+        {
+            mValues.place(it->second, it->first);
+        }
+        mSearch.addPresets(values);
+    }
+
+    SolveResult nextSolution()
+    {
+        return mSearch.nextSolution();
+    }
+
+    SolutionCount countSolutions(SolutionCount limit)
+    {
+        SolutionCount count = 0;
+        if(!sweep(count))
+        {
+            return mSearch.countSolutions(limit);
+        }
+        return (limit != 0 && count > limit) ? limit : count;
+    }
+
+    const Values& getSolution() const
+    {
+        return mSearch.getSolution();
+    }
+
+    // The most states held at once by the last count.
+    int stateCount() const
+    {
+        return mStateCount;
+    }
+
+    // The most cells on the frontier at once.
+    int frontierWidth() const
+    {
+        return mPlan.width();
+    }
+
+private:
+    enum
+    {
+        kMaxStates = 1 << 22
+    };
+
+    // A state is kept as a string of bytes, the frontier values followed
+    // by how many of each symbol are left, so it can be hashed as it is.
+    typedef std::string State;
+    typedef std::unordered_map<State, SolutionCount> States;
+    typedef SweepPlan<Dimensions> Plan;
+    typedef typename Plan::Step Step;
+
+    // Returns false if there were too many states to finish.
+    bool sweep(SolutionCount& count)
+    {
+        States states;
+        State start;
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            int left = hasSymbol(mSequence.getSymbolMask(), s) ? mSequence.count(s) : 0;
+            assert(left < 256);
+            start.push_back((char)left);
+        }
+        states[start] = 1;
+        mStateCount = 1;
+
+        SymbolMask all = mSequence.getSymbolMask();
+        States next;
+        State after;
+        for(int i = 0; i < mPlan.stepCount() && !states.empty(); ++i)
+        {
+            const Step& step = mPlan.step(i);
+            Symbol preset = mValues.atIndex(step.cell);
+            SymbolMask options = (preset != Solver::kUnsetSymbol) ? symbolBit(preset) : all;
+            int width = (int)step.sources.size();
+
+            next.clear();
+            typename States::const_iterator end = states.end();
+            for(typename States::const_iterator it = states.begin(); it != end; ++it)
+            {
+                const State& before = it->first;
+                int frontier = (int)before.size() - (mSymbolRange - Solver::kFirstSymbol);
+
+                // The symbols that are left and go next to the neighbours.
+                SymbolMask allowed = options;
+                for(size_t n = 0; n < step.neighbours.size(); ++n)
+                {
+                    allowed &= mSequence.getAdjacentMask((Symbol)(unsigned char)before[step.neighbours[n]]);
+                }
+                for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+                {
+                    if(!hasSymbol(allowed, s) || before[frontier + s - Solver::kFirstSymbol] == 0)
+                    {
+                        continue;
+                    }
+                    after.clear();
+                    for(int slot = 0; slot < width; ++slot)
+                    {
+                        int source = step.sources[slot];
+                        after.push_back(source == Plan::kNewCell ? (char)s : before[source]);
+                    }
+                    after.append(before, frontier, std::string::npos);
+                    --after[width + s - Solver::kFirstSymbol];
+                    next[after] += it->second;
+                }
+            }
+            states.swap(next);
+            mStateCount = std::max(mStateCount, (int)states.size());
+            if(mStateCount > kMaxStates)
+            {
+                return false;
+            }
+        }
+
+        count = 0;
+        typename States::const_iterator end = states.end();
+        for(typename States::const_iterator it = states.begin(); it != end; ++it)
+        {
+            count += it->second;
+        }
+        return true;
+    }
+
+    Topology mTopology;
+    const Sequence& mSequence;
+    Values mValues;
+    GridSolver<Dimensions> mSearch;
+    Plan mPlan;
+    int mSymbolRange;
+    int mStateCount;
+};
+
+#endif // SOLVER_TRANSFERCOUNTER_H__INCLUDED
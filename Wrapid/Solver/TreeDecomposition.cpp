@@ -0,0 +1,249 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/TreeDecomposition.h"
+
+#include <algorithm>
+
+using Solver::TreeDecomposition;
+
+TreeDecomposition::TreeDecomposition(const Topology& topology, const std::vector<bool>& included)
+    : mNodes(topology.cellCount(), -1)
+    , mWidth(0)
+{
+    // The graph that is left, with the edges added along the way.
+    int total = topology.cellCount();
+    std::vector< std::vector<bool> > joined(total, std::vector<bool>(total, false));
+    std::vector<Nodes> neighbours(total);
+    std::vector<bool> left(included);
+    int leftCount = 0;
+    for(int cell = 0; cell < total; ++cell)
+    {
+        if(!included[cell])
+        {
+            continue;
+        }
+        ++leftCount;
+        Topology::const_iterator end = topology.end(cell);
+        for(Topology::const_iterator n = topology.begin(cell); n != end; ++n)
+        {
+            if(*n != cell && included[*n] && !joined[cell][*n])
+            {
+                joined[cell][*n] = true;
+                neighbours[cell].push_back(*n);
+            }
+        }
+    }
+
+    std::vector<Nodes> separatorCells;
+    while(leftCount > 0)
+    {
+        int best = -1;
+        int bestFill = 0;
+        int bestDegree = 0;
+        for(int cell = 0; cell < total; ++cell)
+        {
+            if(!left[cell])
+            {
+                continue;
+            }
+            const Nodes& around = neighbours[cell];
+            int fill = 0;
+            for(size_t i = 0; i < around.size(); ++i)
+            {
+                for(size_t j = i + 1; j < around.size(); ++j)
+                {
+                    if(!joined[around[i]][around[j]])
+                    {
+                        ++fill;
+                    }
+                }
+            }
+            int degree = (int)around.size();
+            if(best < 0 || fill < bestFill || (fill == bestFill && degree < bestDegree))
+            {
+                best = cell;
+                bestFill = fill;
+                bestDegree = degree;
+            }
+        }
+
+        // Join up its neighbours, and take it out.
+        Nodes around = neighbours[best];
+        for(size_t i = 0; i < around.size(); ++i)
+        {
+            for(size_t j = i + 1; j < around.size(); ++j)
+            {
+                int a = around[i];
+                int b = around[j];
+                if(!joined[a][b])
+                {
+                    joined[a][b] = joined[b][a] = true;
+                    neighbours[a].push_back(b);
+                    neighbours[b].push_back(a);
+                }
+            }
+            Nodes& theirs = neighbours[around[i]];
+            theirs.erase(std::find(theirs.begin(), theirs.end(), best));
+        }
+        left[best] = false;
+        --leftCount;
+
+        mNodes[best] = (int)mCells.size();
+        mCells.push_back(best);
+        separatorCells.push_back(around);
+        mWidth = std::max(mWidth, (int)around.size());
+    }
+
+    // The cells in a separator are all taken out later, so they
+    // have their nodes by now.
+    mSeparators.resize(mCells.size());
+    mChildren.resize(mCells.size());
+    for(int node = 0; node < nodeCount(); ++node)
+    {
+        Nodes& separator = mSeparators[node];
+        for(size_t i = 0; i < separatorCells[node].size(); ++i)
+        {
+            separator.push_back(mNodes[separatorCells[node][i]]);
+        }
+        std::sort(separator.begin(), separator.end());
+        if(!separator.empty())
+        {
+            mChildren[separator.front()].push_back(node);
+        }
+    }
+}
+
+TreeDecomposition::~TreeDecomposition()
+{
+}
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+#include "Solver/Grid.h"
+
+using Solver::Topology;
+using Solver::coord;
+
+namespace
+{
+    class TreeDecompositionTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( pathTest );
+            RUN( cycleTest );
+            RUN( gridTest );
+            RUN( excludedTest );
+        }
+
+        static Topology path(int length, bool closed)
+        {
+            Topology::Adjacency adjacency(length);
+            for(int i = 0; i + 1 < length || (closed && i < length); ++i)
+            {
+                int j = (i + 1) % length;
+                adjacency[i].push_back(j);
+                adjacency[j].push_back(i);
+            }
+            return Topology(adjacency);
+        }
+
+        // Every edge is inside some bag, and every node's
+        // separator is inside its parent's bag.
+        void checkDecomposition(const Topology& topology, const TreeDecomposition& tree)
+        {
+            for(int node = 0; node < tree.nodeCount(); ++node)
+            {
+                const TreeDecomposition::Nodes& separator = tree.separator(node);
+                int cell = tree.cell(node);
+                Topology::const_iterator end = topology.end(cell);
+                for(Topology::const_iterator n = topology.begin(cell); n != end; ++n)
+                {
+                    int other = tree.node(*n);
+                    if(other > node)
+                    {
+                        CHECK(std::find(separator.begin(), separator.end(), other) != separator.end());
+                    }
+                }
+
+                int parent = tree.parent(node);
+                if(parent < 0)
+                {
+                    continue;
+                }
+                CHECK(parent > node);
+                const TreeDecomposition::Nodes& above = tree.separator(parent);
+                for(size_t i = 1; i < separator.size(); ++i)
+                {
+                    CHECK(std::find(above.begin(), above.end(), separator[i]) != above.end());
+                }
+            }
+        }
+
+        void pathTest()
+        {
+            Topology topology(path(10, false));
+            TreeDecomposition tree(topology, std::vector<bool>(10, true));
+            CHECK(tree.nodeCount() == 10);
+            CHECK(tree.width() == 1);
+            checkDecomposition(topology, tree);
+
+            int roots = 0;
+            for(int node = 0; node < tree.nodeCount(); ++node)
+            {
+                roots += tree.parent(node) < 0 ? 1 : 0;
+            }
+            CHECK(roots == 1);
+        }
+
+        void cycleTest()
+        {
+            Topology topology(path(10, true));
+            TreeDecomposition tree(topology, std::vector<bool>(10, true));
+            CHECK(tree.width() == 2);
+            checkDecomposition(topology, tree);
+        }
+
+        void gridTest()
+        {
+            // A 3 x 8 board with no wrapping has a path
+            // decomposition of width three.
+            Solver::Grid2D grid(coord(3, 8));
+            grid.unwrap(0);
+            grid.unwrap(1);
+            Topology topology(grid);
+            TreeDecomposition tree(topology, std::vector<bool>(24, true));
+            CHECK(tree.width() >= 3);
+            CHECK(tree.width() <= 4);
+            checkDecomposition(topology, tree);
+        }
+
+        void excludedTest()
+        {
+            // Leaving out the middle of a path splits it in two.
+            Topology topology(path(9, false));
+            std::vector<bool> included(9, true);
+            included[4] = false;
+            TreeDecomposition tree(topology, included);
+            CHECK(tree.nodeCount() == 8);
+            CHECK(tree.node(4) == -1);
+            checkDecomposition(topology, tree);
+
+            int roots = 0;
+            for(int node = 0; node < tree.nodeCount(); ++node)
+            {
+                roots += tree.parent(node) < 0 ? 1 : 0;
+            }
+            CHECK(roots == 2);
+        }
+    };
+}
+
+DECLARE_TEST( TreeDecompositionTest );
+
+#endif // BUILD_TESTS
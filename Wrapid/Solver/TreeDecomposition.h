@@ -0,0 +1,86 @@
+#pragma once
+#ifndef SOLVER_TREEDECOMPOSITION_H__INCLUDED
+#define SOLVER_TREEDECOMPOSITION_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/Topology.h"
+
+#include <vector>
+
+namespace Solver
+{
+    class TreeDecomposition;
+}
+
+// A tree decomposition of the graph a topology gives some of its cells,
+// found by eliminating the cells one at a time with the min-fill
+// heuristic: each time, take the cell whose neighbours need the fewest
+// new edges to join them all up, join them up, and take it out.
+//
+// Each cell becomes a node, numbered in the order they were taken out.
+// Its separator is the nodes it was still joined to when it was taken
+// out, which between them cut it and the nodes before it that hang off
+// it from the rest of the graph. Its parent is the first of those, and
+// a node with none is the root of a connected piece. The width is the
+// size of the biggest separator, so the bags of the decomposition (a
+// node with its separator) are one bigger.
+class Solver::TreeDecomposition
+{
+public:
+    typedef std::vector<int> Nodes;
+
+    // Decompose the cells that are included, with the edges the
+    // topology has between them.
+    TreeDecomposition(const Topology& topology, const std::vector<bool>& included);
+    ~TreeDecomposition();
+
+    int nodeCount() const
+    {
+        return (int)mCells.size();
+    }
+
+    int cell(int node) const
+    {
+        return mCells[node];
+    }
+
+    // The node for a cell, or -1 if it wasn't included.
+    int node(int cell) const
+    {
+        return mNodes[cell];
+    }
+
+    // In increasing order.
+    const Nodes& separator(int node) const
+    {
+        return mSeparators[node];
+    }
+
+    // -1 for a root.
+    int parent(int node) const
+    {
+        return mSeparators[node].empty() ? -1 : mSeparators[node].front();
+    }
+
+    const Nodes& children(int node) const
+    {
+        return mChildren[node];
+    }
+
+    int width() const
+    {
+        return mWidth;
+    }
+
+private:
+    Nodes mCells;
+    Nodes mNodes;
+    std::vector<Nodes> mSeparators;
+    std::vector<Nodes> mChildren;
+    int mWidth;
+};
+
+#endif // SOLVER_TREEDECOMPOSITION_H__INCLUDED
@@ -0,0 +1,218 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/TreeSolver.h"
+
+#ifdef BUILD_TESTS
+
+#include "Solver/SolverTest.h"
+
+using namespace Solver;
+
+namespace
+{
+    class TreeSolverTest : public Solver::SolverTest
+    {
+    public:
+        void run()
+        {
+            RUN( countTest );
+            RUN( witnessTest );
+            RUN( noSolutionTest );
+            RUN( steppingTest );
+            RUN( widthTest );
+        }
+
+        template <int D>
+        static SolutionCount searchCount(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets
+        )
+        {
+            GridSolver<D> solver(grid, symbols);
+            solver.addPresets(presets);
+            return solver.countSolutions(0);
+        }
+
+        template <int D>
+        static SolutionCount treeCount(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets
+        )
+        {
+            TreeSolver<D> solver(grid, symbols);
+            solver.addPresets(presets);
+            return solver.countSolutions(0);
+        }
+
+        // Every cell is filled in, next to symbols it can go next to, with
+        // no more of each symbol than the sequence has and the presets kept.
+        template <int D>
+        static bool isSolution(
+            const Grid<D>& grid,
+            const Sequence& symbols,
+            const GridValues<D>& presets,
+            const GridValues<D>& values
+        )
+        {
+            Topology topology(grid);
+            for(int cell = 0; cell < topology.cellCount(); ++cell)
+            {
+                Symbol s = values.atIndex(cell);
+                if(s == kUnsetSymbol || !hasSymbol(symbols.getSymbolMask(), s))
+                {
+                    return false;
+                }
+                if(presets.atIndex(cell) != kUnsetSymbol && presets.atIndex(cell) != s)
+                {
+                    return false;
+                }
+                Topology::const_iterator end = topology.end(cell);
+                for(Topology::const_iterator n = topology.begin(cell); n != end; ++n)
+                {
+                    if(!hasSymbol(symbols.getAdjacentMask(s), values.atIndex(*n)))
+                    {
+                        return false;
+                    }
+                }
+            }
+            for(Symbol s = kFirstSymbol; s <= highestSymbol(symbols.getSymbolMask()); ++s)
+            {
+                if(values.symbolCount(s) > symbols.count(s))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void countTest()
+        {
+            Grid<3> levels(coord(2, 2, 3));
+            levels.blockAll(2);
+            Sequence fours(4, 3);
+            GridValues<3> corner(levels.getSize());
+            corner.place(1, coord(0, 0, 0));
+            CHECK(treeCount(levels, fours, corner) == 800);
+
+            Grid<3> tunnels(coord(2, 2, 3));
+            tunnels.unwrap(2);
+            CHECK(treeCount(tunnels, fours, corner) == 200);
+            CHECK(treeCount(tunnels, fours, GridValues<3>(tunnels.getSize())) == 800);
+
+            Grid2D band(coord(6, 2));
+            CHECK(treeCount(band, fours, GridValues2D(band.getSize())) == 800);
+
+            // A long corridor, where the counts of each symbol matter.
+            Grid2D snake(coord(4, 6));
+            buildSnake(snake);
+            Sequence symbols(12, 2);
+            GridValues2D middle(snake.getSize());
+            middle.place(12, coord(1, 2));
+            middle.place(6, coord(2, 3));
+            SolutionCount expected = searchCount(snake, symbols, middle);
+            CHECK(expected > 0);
+            CHECK(treeCount(snake, symbols, middle) == expected);
+            GridValues2D one(snake.getSize());
+            one.place(1, coord(0, 0));
+            CHECK(treeCount(snake, symbols, one) == searchCount(snake, symbols, one));
+
+            TreeSolver<2> limited(snake, symbols);
+            limited.addPresets(middle);
+            CHECK(limited.countSolutions(3) == 3);
+            CHECK(limited.width() == 1);
+        }
+
+        void witnessTest()
+        {
+            Grid2D snake(coord(4, 6));
+            buildSnake(snake);
+            Sequence symbols(12, 2);
+            GridValues2D middle(snake.getSize());
+            middle.place(12, coord(1, 2));
+            middle.place(6, coord(2, 3));
+
+            TreeSolver<2> solver(snake, symbols, SearchOptions(kFirstSolutionOnly));
+            solver.addPresets(middle);
+            CHECK_ASSERT(solver.nextSolution() == kFoundSolution);
+            CHECK(isSolution(snake, symbols, middle, solver.getSolution()));
+            CHECK(solver.nextSolution() == kNoSolution);
+
+            Grid<3> tunnels(coord(2, 2, 3));
+            tunnels.unwrap(2);
+            Sequence fours(4, 3);
+            GridValues<3> corner(tunnels.getSize());
+            corner.place(1, coord(0, 0, 0));
+            TreeSolver<3> cube(tunnels, fours, SearchOptions(kFirstSolutionOnly));
+            cube.addPresets(corner);
+            CHECK_ASSERT(cube.nextSolution() == kFoundSolution);
+            CHECK(isSolution(tunnels, fours, corner, cube.getSolution()));
+        }
+
+        void noSolutionTest()
+        {
+            // Four levels that can each be filled in, but
+            // not enough symbols for all of them.
+            Grid<3> levels(coord(2, 2, 4));
+            levels.blockAll(2);
+            Sequence fours(4, 3);
+            GridValues<3> none(levels.getSize());
+            CHECK(treeCount(levels, fours, none) == 0);
+
+            TreeSolver<3> solver(levels, fours, SearchOptions(kFirstSolutionOnly));
+            solver.addPresets(none);
+            CHECK(solver.nextSolution() == kNoSolution);
+
+            // Presets next to each other that can't be.
+            Grid2D snake(coord(4, 6));
+            buildSnake(snake);
+            Sequence symbols(12, 2);
+            GridValues2D clash(snake.getSize());
+            clash.place(1, coord(0, 0));
+            clash.place(5, coord(0, 1));
+            CHECK(checkSameSolutionSet<TreeSolver>(snake, symbols, clash, 0) == 0);
+        }
+
+        void steppingTest()
+        {
+            // Without kFirstSolutionOnly the solutions are searched for.
+            Grid<3> tunnels(coord(2, 2, 3));
+            tunnels.unwrap(2);
+            Sequence fours(4, 3);
+            GridValues<3> corner(tunnels.getSize());
+            corner.place(1, coord(0, 0, 0));
+            TreeSolver<3> solver(tunnels, fours);
+            solver.addPresets(corner);
+            SolutionCount count = 0;
+            while(solver.nextSolution() == kFoundSolution)
+            {
+                CHECK(isSolution(tunnels, fours, corner, solver.getSolution()));
+                ++count;
+            }
+            CHECK(count == 200);
+        }
+
+        void widthTest()
+        {
+            Grid2D snake(coord(4, 6));
+            buildSnake(snake);
+            GridValues2D none(snake.getSize());
+            CHECK(TreeSolver<2>::estimateWidth(snake, none) == 1);
+            CHECK(TreeSolver<2>::suits(snake, none, SearchOptions(kTreeDecomposition)));
+            CHECK(!TreeSolver<2>::suits(snake, none, SearchOptions()));
+            CHECK(!TreeSolver<2>::suits(snake, none, SearchOptions(kTreeDecomposition | kBreakSymmetry)));
+
+            // An open torus is too tangled.
+            Grid2D torus(coord(6, 6));
+            CHECK(TreeSolver<2>::estimateWidth(torus, GridValues2D(torus.getSize())) > TreeSolver<2>::kMaxAutomaticWidth);
+        }
+    };
+}
+
+DECLARE_TEST( TreeSolverTest );
+
+#endif // BUILD_TESTS
@@ -0,0 +1,646 @@
+#pragma once
+#ifndef SOLVER_TREESOLVER_H__INCLUDED
+#define SOLVER_TREESOLVER_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/GridSolver.h"
+#include "Solver/SolveEngine.h"
+#include "Solver/SymbolUsage.h"
+#include "Solver/Topology.h"
+#include "Solver/TreeDecomposition.h"
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <assert.h>
+
+namespace Solver
+{
+    template <int Dimensions>
+    class TreeSolver;
+}
+
+// Solves a board whose unset cells are only loosely joined up, such as
+// a card puzzle with a few tunnels between its levels, by dynamic
+// programming over a tree decomposition of them (see TreeDecomposition)
+// rather than by searching.
+//
+// The cells are taken out in the decomposition's order. Taking out a
+// cell works out, for each way of filling in its separator, the ways of
+// filling in it and everything hanging off it, counted by the symbols
+// they use, from what the cells before it worked out. The symbol counts
+// are what ties the pieces together, so they are carried along as part
+// of the state and never allowed past what the sequence has left. The
+// presets are not part of the graph. They just narrow down the symbols
+// their neighbours can hold and use up their own.
+//
+// Counting and finding a solution both come from the same tables: the
+// count by putting the pieces together at the roots, and a solution by
+// going back down the tree picking any choice the tables say leads to
+// one. Only that one solution is found this way, so when more than the
+// first are wanted nextSolution hands over to a GridSolver.
+//
+// A narrow board can still have far too many ways of using the symbols,
+// as when every symbol in a card puzzle is needed exactly. The tables
+// stop growing after a set amount of work, and the board is searched
+// by the GridSolver instead.
+template <int Dimensions>
+class Solver::TreeSolver : public Solver::SolveEngine<Dimensions>
+{
+    PREVENT_COPY_AND_ASSIGNMENT(TreeSolver);
+public:
+    typedef Grid<Dimensions> GridD;
+    typedef GridValues<Dimensions> Values;
+
+    enum
+    {
+        // With kTreeDecomposition, PuzzleSolver uses this engine
+        // for boards no wider than this.
+        kMaxAutomaticWidth = 3,
+
+        // How many symbol usages the tables can be built from before
+        // the board is handed over to the search instead. A search for
+        // one solution is usually quick, so that gives up much sooner
+        // than counting, where searching can take far longer.
+        kMaxSolveWork = 1 << 18,
+        kMaxCountWork = 1 << 26
+    };
+
+    TreeSolver(const GridD& grid, const Sequence& sequence, SearchOptions options = SearchOptions())
+        : mGrid(grid)
+        , mTopology(grid)
+        , mSequence(sequence)
+        , mOptions(options)
+        , mPresets(grid.getSize())
+        , mSolution(grid.getSize())
+        , mSearch(grid, sequence, options)
+        , mSymbolRange(highestSymbol(sequence.getSymbolMask()) + 1)
+        , mSolved(false)
+        , mReported(false)
+        , mWork(0)
+        , mTooBig(false)
+    {
+    }
+
+    ~TreeSolver()
+    {
+    }
+
+    // The width of the decomposition of the cells the presets leave,
+    // for deciding whether this engine suits a board.
+    static int estimateWidth(const GridD& grid, const Values& presets)
+    {
+        Topology topology(grid);
+        return TreeDecomposition(topology, unsetCells(presets, topology.cellCount())).width();
+    }
+
+    // Whether PuzzleSolver should use this engine for the board. It
+    // doesn't break symmetry, so it isn't used when that is asked for.
+    static bool suits(const GridD& grid, const Values& presets, SearchOptions options)
+    {
+        return options.has(kTreeDecomposition)
+            && !options.has(kBreakSymmetry)
+            && !options.has(kExpandSymmetry)
+            && !options.has(kBreakValueSymmetry)
+            && estimateWidth(grid, presets) <= kMaxAutomaticWidth;
+    }
+
+    void addPresets(const Values& values)
+    {
+        assert(!mSolved);
+        typename Values::const_iterator end = values.end();
+        for(typename Values::const_iterator it = values.begin(); it != end; ++it)
+        {
+            mPresets.place(it->second, it->first);
+        }
+        mSearch.addPresets(values);
+    }
+
+    SolveResult nextSolution()
+    {
+        if(!mOptions.has(kFirstSolutionOnly))
+        {
+            return mSearch.nextSolution();
+        }
+        if(mReported)
+        {
+            return kNoSolution;
+        }
+        mReported = true;
+        if(mPresets.valueCount() == mTopology.cellCount())
+        {
+            mSolution = mPresets;
+            return kAlreadySolved;
+        }
+        solve(kMaxSolveWork);
+        if(mTooBig)
+        {
+            mSolution = mPresets;
+            SolveResult result = mSearch.nextSolution();
+            if(result == kFoundSolution)
+            {
+                mSolution = mSearch.getSolution();
+            }
+            return result;
+        }
+        return findWitness() ? kFoundSolution : kNoSolution;
+    }
+
+    SolutionCount countSolutions(SolutionCount limit)
+    {
+        solve(kMaxCountWork);
+        if(mTooBig)
+        {
+            return mSearch.countSolutions(limit);
+        }
+        SolutionCount count = totalCount(mTotal);
+        return (limit != 0 && count > limit) ? limit : count;
+    }
+
+    const Values& getSolution() const
+    {
+        return mOptions.has(kFirstSolutionOnly) ? mSolution : mSearch.getSolution();
+    }
+
+    // The width of the decomposition used, once solved.
+    int width() const
+    {
+        return mTree.get() != NULLPTR ? mTree->width() : -1;
+    }
+
+    // Whether building the tables took too much work, so that
+    // the board was handed over to the search.
+    bool isTooBig() const
+    {
+        return mTooBig;
+    }
+
+private:
+    // The values of the nodes of a scope, in the same order.
+    typedef std::vector<Symbol> Assignment;
+    typedef std::map<Assignment, UsageCounts> Table;
+
+    // What taking out a node worked out, for each way of filling in its
+    // separator.
+    struct Message
+    {
+        TreeDecomposition::Nodes scope;
+        Table table;
+    };
+
+    static std::vector<bool> unsetCells(const Values& presets, int total)
+    {
+        std::vector<bool> unset(total);
+        for(int cell = 0; cell < total; ++cell)
+        {
+            unset[cell] = presets.atIndex(cell) == Solver::kUnsetSymbol;
+        }
+        return unset;
+    }
+
+    void solve(double maxWork)
+    {
+        if(mSolved)
+        {
+            return;
+        }
+        mSolved = true;
+        mTree.reset(new TreeDecomposition(mTopology, unsetCells(mPresets, mTopology.cellCount())));
+
+        mRemaining.assign(mSymbolRange, 0);
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            if(hasSymbol(mSequence.getSymbolMask(), s))
+            {
+                mRemaining[s] = mSequence.count(s) - mPresets.symbolCount(s);
+                if(mRemaining[s] < 0)
+                {
+                    // The presets use too many already.
+                    return;
+                }
+            }
+        }
+        if(!presetsFit() || !findDomains())
+        {
+            return;
+        }
+
+        int nodes = mTree->nodeCount();
+        mMessages.assign(nodes, Message());
+        for(int node = 0; node < nodes; ++node)
+        {
+            if(!takeOut(node, maxWork))
+            {
+                mTooBig = true;
+                return;
+            }
+        }
+
+        mTotal[SymbolUsage(mSymbolRange, 0)] = 1;
+        UsageCounts joined;
+        for(int node = 0; node < nodes && !mTotal.empty(); ++node)
+        {
+            if(mTree->parent(node) < 0)
+            {
+                joinUsage(mTotal, rootUsage(node), mRemaining, joined);
+                mTotal.swap(joined);
+            }
+        }
+    }
+
+    bool presetsFit() const
+    {
+        for(int cell = 0; cell < mTopology.cellCount(); ++cell)
+        {
+            Symbol preset = mPresets.atIndex(cell);
+            Topology::const_iterator end = mTopology.end(cell);
+            for(Topology::const_iterator n = mTopology.begin(cell); n != end && preset != Solver::kUnsetSymbol; ++n)
+            {
+                Symbol other = mPresets.atIndex(*n);
+                if(other != Solver::kUnsetSymbol && !hasSymbol(mSequence.getAdjacentMask(preset), other))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // The symbols each unset cell could hold next to the presets. Only
+    // the counts of symbols there might not be enough of are tracked.
+    bool findDomains()
+    {
+        int nodes = mTree->nodeCount();
+        mDomains.assign(nodes, 0);
+        std::vector<int> wanted(mSymbolRange, 0);
+        SymbolMask left = 0;
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            if(mRemaining[s] > 0)
+            {
+                left |= symbolBit(s);
+            }
+        }
+        for(int node = 0; node < nodes; ++node)
+        {
+            int cell = mTree->cell(node);
+            SymbolMask domain = left;
+            Topology::const_iterator end = mTopology.end(cell);
+            for(Topology::const_iterator n = mTopology.begin(cell); n != end; ++n)
+            {
+                Symbol preset = mPresets.atIndex(*n);
+                if(preset != Solver::kUnsetSymbol)
+                {
+                    domain &= mSequence.getAdjacentMask(preset);
+                }
+            }
+            if(domain == 0)
+            {
+                return false;
+            }
+            mDomains[node] = domain;
+            for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+            {
+                wanted[s] += hasSymbol(domain, s) ? 1 : 0;
+            }
+        }
+
+        mTracked.assign(mSymbolRange, false);
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            mTracked[s] = wanted[s] > mRemaining[s];
+        }
+        return true;
+    }
+
+    SymbolUsage usageOf(Symbol s) const
+    {
+        SymbolUsage usage(mSymbolRange, 0);
+        if(mTracked[s])
+        {
+            usage[s] = 1;
+        }
+        return usage;
+    }
+
+    bool isNeighbour(int node, int other) const
+    {
+        return mTopology.isAdjacent(mTree->cell(node), mTree->cell(other));
+    }
+
+    // Join up what the node's children worked out, over its bag, and
+    // sum out the node itself to leave its message over its separator.
+    // Returns false if the tables grow too big.
+    bool takeOut(int node, double maxWork)
+    {
+        const TreeDecomposition::Nodes& separator = mTree->separator(node);
+        TreeDecomposition::Nodes bag(1, node);
+        bag.insert(bag.end(), separator.begin(), separator.end());
+
+        Table partial;
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            if(hasSymbol(mDomains[node], s))
+            {
+                Assignment values(bag.size(), Solver::kUnsetSymbol);
+                values[0] = s;
+                partial[values][usageOf(s)] = 1;
+            }
+        }
+
+        const TreeDecomposition::Nodes& children = mTree->children(node);
+        std::vector<bool> covered(bag.size(), false);
+        covered[0] = true;
+        Table next;
+        UsageCounts joined;
+        for(size_t c = 0; c < children.size() && !partial.empty(); ++c)
+        {
+            const Message& message = mMessages[children[c]];
+            std::vector<int> at(message.scope.size());
+            for(size_t i = 0; i < at.size(); ++i)
+            {
+                at[i] = (int)(std::find(bag.begin(), bag.end(), message.scope[i]) - bag.begin());
+                assert(at[i] < (int)bag.size());
+            }
+
+            next.clear();
+            typename Table::const_iterator end = partial.end();
+            for(typename Table::const_iterator p = partial.begin(); p != end; ++p)
+            {
+                typename Table::const_iterator messageEnd = message.table.end();
+                for(typename Table::const_iterator m = message.table.begin(); m != messageEnd; ++m)
+                {
+                    Assignment values(p->first);
+                    bool agrees = true;
+                    for(size_t i = 0; i < at.size() && agrees; ++i)
+                    {
+                        Symbol& value = values[at[i]];
+                        agrees = value == Solver::kUnsetSymbol || value == m->first[i];
+                        value = m->first[i];
+                    }
+                    if(!agrees)
+                    {
+                        continue;
+                    }
+                    mWork += (double)p->second.size() * m->second.size();
+                    if(mWork > maxWork)
+                    {
+                        return false;
+                    }
+                    joinUsage(p->second, m->second, mRemaining, joined);
+                    if(!joined.empty())
+                    {
+                        addUsage(next[values], joined);
+                    }
+                }
+            }
+            partial.swap(next);
+            for(size_t i = 0; i < at.size(); ++i)
+            {
+                covered[at[i]] = true;
+            }
+        }
+
+        // The rest of the separator are neighbours of the node that no
+        // child has filled in. The node's own neighbours are checked here.
+        for(size_t i = 1; i < bag.size() && !partial.empty(); ++i)
+        {
+            if(!isNeighbour(node, bag[i]))
+            {
+                assert(covered[i]);
+                continue;
+            }
+            next.clear();
+            typename Table::const_iterator end = partial.end();
+            for(typename Table::const_iterator p = partial.begin(); p != end; ++p)
+            {
+                SymbolMask fits = mSequence.getAdjacentMask(p->first[0]);
+                if(covered[i])
+                {
+                    if(hasSymbol(fits, p->first[i]))
+                    {
+                        addUsage(next[p->first], p->second);
+                    }
+                    continue;
+                }
+                fits &= mDomains[bag[i]];
+                for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+                {
+                    if(hasSymbol(fits, s))
+                    {
+                        Assignment values(p->first);
+                        values[i] = s;
+                        addUsage(next[values], p->second);
+                        mWork += (double)p->second.size();
+                    }
+                }
+            }
+            partial.swap(next);
+            covered[i] = true;
+            if(mWork > maxWork)
+            {
+                return false;
+            }
+        }
+
+        Message& message = mMessages[node];
+        message.scope = separator;
+        typename Table::const_iterator end = partial.end();
+        for(typename Table::const_iterator p = partial.begin(); p != end; ++p)
+        {
+            Assignment values(p->first.begin() + 1, p->first.end());
+            addUsage(message.table[values], p->second);
+        }
+        return true;
+    }
+
+    static void addUsage(UsageCounts& total, const UsageCounts& more)
+    {
+        UsageCounts::const_iterator end = more.end();
+        for(UsageCounts::const_iterator it = more.begin(); it != end; ++it)
+        {
+            total[it->first] += it->second;
+        }
+    }
+
+    const UsageCounts& rootUsage(int node) const
+    {
+        static const UsageCounts none;
+        const Table& table = mMessages[node].table;
+        return table.empty() ? none : table.begin()->second;
+    }
+
+    // Pick a symbol usage for each part, from the ones it can use, that
+    // fit in what is left (or use it up exactly).
+    static bool chooseUsage(
+        const std::vector<const UsageCounts*>& parts,
+        size_t part,
+        SymbolUsage& left,
+        bool exactly,
+        std::vector<SymbolUsage>& chosen
+    )
+    {
+        if(part == parts.size())
+        {
+            return !exactly || std::count(left.begin(), left.end(), 0) == (int)left.size();
+        }
+        UsageCounts::const_iterator end = parts[part]->end();
+        for(UsageCounts::const_iterator it = parts[part]->begin(); it != end; ++it)
+        {
+            const SymbolUsage& usage = it->first;
+            bool fits = true;
+            for(size_t s = 0; s < left.size() && fits; ++s)
+            {
+                fits = usage[s] <= left[s];
+            }
+            if(!fits)
+            {
+                continue;
+            }
+            for(size_t s = 0; s < left.size(); ++s)
+            {
+                left[s] -= usage[s];
+            }
+            bool found = chooseUsage(parts, part + 1, left, exactly, chosen);
+            for(size_t s = 0; s < left.size(); ++s)
+            {
+                left[s] += usage[s];
+            }
+            if(found)
+            {
+                chosen[part] = usage;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool findWitness()
+    {
+        if(mTotal.empty())
+        {
+            return false;
+        }
+        std::vector<int> roots;
+        std::vector<const UsageCounts*> parts;
+        for(int node = 0; node < mTree->nodeCount(); ++node)
+        {
+            if(mTree->parent(node) < 0)
+            {
+                roots.push_back(node);
+                parts.push_back(&rootUsage(node));
+            }
+        }
+        std::vector<SymbolUsage> chosen(parts.size());
+        SymbolUsage left(mRemaining);
+        if(!chooseUsage(parts, 0, left, false, chosen))
+        {
+            return false;
+        }
+
+        mChosen.assign(mTree->nodeCount(), Solver::kUnsetSymbol);
+        for(size_t i = 0; i < roots.size(); ++i)
+        {
+            if(!fillIn(roots[i], chosen[i]))
+            {
+                return false;
+            }
+        }
+
+        mSolution = mPresets;
+        for(int node = 0; node < mTree->nodeCount(); ++node)
+        {
+            mSolution.placeAt(mChosen[node], mTree->cell(node));
+        }
+        return true;
+    }
+
+    // Fill in the node and everything hanging off it with exactly the
+    // usage given, with its separator already filled in.
+    bool fillIn(int node, const SymbolUsage& usage)
+    {
+        const TreeDecomposition::Nodes& separator = mTree->separator(node);
+        const TreeDecomposition::Nodes& children = mTree->children(node);
+        std::vector<const UsageCounts*> parts(children.size());
+        std::vector<SymbolUsage> chosen(children.size());
+        for(Symbol s = Solver::kFirstSymbol; s < mSymbolRange; ++s)
+        {
+            if(!hasSymbol(mDomains[node], s) || usageOf(s)[s] > usage[s])
+            {
+                continue;
+            }
+            bool fits = true;
+            for(size_t i = 0; i < separator.size() && fits; ++i)
+            {
+                fits = !isNeighbour(node, separator[i])
+                    || hasSymbol(mSequence.getAdjacentMask(s), mChosen[separator[i]]);
+            }
+            mChosen[node] = s;
+            for(size_t c = 0; c < children.size() && fits; ++c)
+            {
+                const Message& message = mMessages[children[c]];
+                Assignment values(message.scope.size());
+                for(size_t i = 0; i < values.size(); ++i)
+                {
+                    values[i] = mChosen[message.scope[i]];
+                }
+                typename Table::const_iterator found = message.table.find(values);
+                fits = found != message.table.end();
+                parts[c] = fits ? &found->second : NULLPTR;
+            }
+            if(!fits)
+            {
+                continue;
+            }
+
+            SymbolUsage left(usage);
+            left[s] -= usageOf(s)[s];
+            if(!chooseUsage(parts, 0, left, true, chosen))
+            {
+                continue;
+            }
+            for(size_t c = 0; c < children.size(); ++c)
+            {
+                if(!fillIn(children[c], chosen[c]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        mChosen[node] = Solver::kUnsetSymbol;
+        return false;
+    }
+
+    const GridD& mGrid;
+    Topology mTopology;
+    const Sequence& mSequence;
+    SearchOptions mOptions;
+    Values mPresets;
+    Values mSolution;
+    GridSolver<Dimensions> mSearch;
+    int mSymbolRange;
+    bool mSolved;
+    bool mReported;
+    double mWork;
+    bool mTooBig;
+
+    // The decomposition of the unset cells, the symbols each node could
+    // hold, the symbols whose counts matter and what is left of them,
+    // and what taking out each node worked out.
+    std::auto_ptr<TreeDecomposition> mTree;
+    std::vector<SymbolMask> mDomains;
+    std::vector<bool> mTracked;
+    SymbolUsage mRemaining;
+    std::vector<Message> mMessages;
+    UsageCounts mTotal;
+
+    // The solution being filled in, by node.
+    std::vector<Symbol> mChosen;
+};
+
+#endif // SOLVER_TREESOLVER_H__INCLUDED
@@ -0,0 +1,201 @@
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Top.h"
+#include "Solver/ValueSymmetry.h"
+#include "Solver/Sequence.h"
+
+using Solver::ValueSymmetry;
+using Solver::SymbolMask;
+
+ValueSymmetry::ValueSymmetry(const Sequence& sequence)
+{
+    Sequence::SymbolSet symbolSet = sequence.getSymbols();
+    std::vector<Symbol> symbols(symbolSet.begin(), symbolSet.end());
+    if(symbols.empty())
+    {
+        return;
+    }
+
+    Permutation permutation(symbols.back() + 1, Solver::kUnsetSymbol);
+    search(sequence, symbols, 0, permutation, 0);
+}
+
+ValueSymmetry::~ValueSymmetry()
+{
+}
+
+SymbolMask ValueSymmetry::representatives(SymbolMask options, SymbolMask used) const
+{
+    SymbolMask result = 0;
+    while(options != 0)
+    {
+        Symbol s = highestSymbol(options);
+        options &= ~symbolBit(s);
+        result |= symbolBit(s);
+
+        for(int i = 0; i < size() && options != 0; ++i)
+        {
+            if((mMoved[i] & used) == 0)
+            {
+                options &= ~symbolBit(mPermutations[i][s]);
+            }
+        }
+    }
+    return result;
+}
+
+// Build the permutations up one symbol at a time, only mapping a symbol to
+// one with the same count that is adjacent to the images of the symbols
+// mapped so far in exactly the same way.
+void ValueSymmetry::search(
+    const Sequence& sequence,
+    const std::vector<Symbol>& symbols,
+    int next,
+    Permutation& permutation,
+    SymbolMask taken
+)
+{
+    if((int)mPermutations.size() >= kMaxSymmetries)
+    {
+        return;
+    }
+    if(next == (int)symbols.size())
+    {
+        SymbolMask moved = 0;
+        for(int i = 0; i < (int)symbols.size(); ++i)
+        {
+            if(permutation[symbols[i]] != symbols[i])
+            {
+                moved |= symbolBit(symbols[i]);
+            }
+        }
+        if(moved != 0)
+        {
+            mPermutations.push_back(permutation);
+            mMoved.push_back(moved);
+        }
+        return;
+    }
+
+    Symbol s = symbols[next];
+    SymbolMask adjacent = sequence.getAdjacentMask(s);
+    for(int c = 0; c < (int)symbols.size(); ++c)
+    {
+        Symbol t = symbols[c];
+        if(hasSymbol(taken, t) || sequence.count(t) != sequence.count(s))
+        {
+            continue;
+        }
+        SymbolMask imageAdjacent = sequence.getAdjacentMask(t);
+        bool matches = countSymbols(imageAdjacent) == countSymbols(adjacent)
+            && hasSymbol(imageAdjacent, t) == hasSymbol(adjacent, s);
+        for(int j = 0; matches && j < next; ++j)
+        {
+            matches = hasSymbol(adjacent, symbols[j]) == hasSymbol(imageAdjacent, permutation[symbols[j]]);
+        }
+        if(matches)
+        {
+            permutation[s] = t;
+            search(sequence, symbols, next + 1, permutation, taken | symbolBit(t));
+        }
+    }
+    permutation[s] = Solver::kUnsetSymbol;
+}
+
+#ifdef BUILD_TESTS
+
+#include "Test.h"
+
+using Solver::Sequence;
+using Solver::symbolBit;
+using Solver::Symbol;
+
+namespace
+{
+    class ValueSymmetryTest : public UnitTest::Framework
+    {
+    public:
+        void run()
+        {
+            RUN( circleTest );
+            RUN( jokerTest );
+            RUN( countTest );
+            RUN( representativesTest );
+        }
+
+        void circleTest()
+        {
+            // Twelve rotations, each with or without a reflection.
+            Sequence hours(12, 2);
+            ValueSymmetry symmetry(hours);
+            CHECK(symmetry.size() == 23);
+
+            for(int i = 0; i < symmetry.size(); ++i)
+            {
+                Symbol one = symmetry.apply(i, 1);
+                Symbol two = symmetry.apply(i, 2);
+                CHECK(hours.getAdjacent(one).count(two) == 1);
+            }
+        }
+
+        void jokerTest()
+        {
+            Sequence cards(13, 4);
+            cards.addJoker();
+            ValueSymmetry symmetry(cards);
+            CHECK(symmetry.size() == 25);
+            for(int i = 0; i < symmetry.size(); ++i)
+            {
+                CHECK(symmetry.apply(i, Solver::kCardPuzzleJoker) == Solver::kCardPuzzleJoker);
+            }
+        }
+
+        void countTest()
+        {
+            // A line of four, where the ends can be swapped, but
+            // not if they are allowed different numbers of times.
+            Sequence line;
+            Symbol a = line.addSymbol(2);
+            Symbol b = line.addSymbol(2);
+            Symbol c = line.addSymbol(2);
+            Symbol d = line.addSymbol(2);
+            line.makeAdjacent(a, b);
+            line.makeAdjacent(b, c);
+            line.makeAdjacent(c, d);
+            ValueSymmetry symmetric(line);
+            CHECK(symmetric.size() == 1);
+
+            Symbol e = line.addSymbol(3);
+            line.makeAdjacent(d, e);
+            ValueSymmetry lopsided(line);
+            CHECK(lopsided.size() == 0);
+        }
+
+        void representativesTest()
+        {
+            Sequence hours(12, 2);
+            ValueSymmetry symmetry(hours);
+            SymbolMask all = hours.getSymbolMask();
+
+            // On an empty board every hour is the same as every other.
+            CHECK(symmetry.representatives(all, 0) == symbolBit(12));
+
+            // Once 12 is used, only the reflection through it is left.
+            SymbolMask expected = 0;
+            for(Symbol s = 6; s <= 12; ++s)
+            {
+                expected |= symbolBit(s);
+            }
+            CHECK(symmetry.representatives(all, symbolBit(12)) == expected);
+
+            // With two used that aren't opposite, nothing is left.
+            CHECK(symmetry.representatives(all, symbolBit(12) | symbolBit(3)) == all);
+        }
+    };
+}
+
+DECLARE_TEST( ValueSymmetryTest );
+
+#endif // BUILD_TESTS
@@ -0,0 +1,77 @@
+#pragma once
+#ifndef SOLVER_VALUESYMMETRY_H__INCLUDED
+#define SOLVER_VALUESYMMETRY_H__INCLUDED
+
+/* ---------------------------------------------------------------
+ * Copyright (c) Adrian Smith.
+ * --------------------------------------------------------------- */
+
+#include "Solver/Symbol.h"
+#include "Solver/SymbolMask.h"
+
+#include <vector>
+
+namespace Solver
+{
+    class Sequence;
+    class ValueSymmetry;
+}
+
+// The symmetries of a sequence: the ways of swapping symbols around that
+// keep the same symbols adjacent and the same number of each. For the
+// circular sequences these are the rotations and reflections of the
+// circle, and the joker stays where it is.
+//
+// If a symmetry leaves every symbol already on the board alone, then
+// trying one option at a cell leads to the same solutions as trying its
+// image, with the symbols swapped. So only one option out of each set
+// that such symmetries swap around needs to be tried.
+class Solver::ValueSymmetry
+{
+    PREVENT_COPY_AND_ASSIGNMENT(ValueSymmetry);
+public:
+    explicit ValueSymmetry(const Sequence& sequence);
+    ~ValueSymmetry();
+
+    // The number of symmetries found, not counting the identity. Very
+    // symmetric sequences have too many to list, so only the first
+    // kMaxSymmetries are kept, which just means pruning less.
+    int size() const
+    {
+        return (int)mPermutations.size();
+    }
+
+    enum
+    {
+        kMaxSymmetries = 4096
+    };
+
+    // The image of a symbol under symmetry i.
+    Symbol apply(int i, Symbol s) const
+    {
+        return mPermutations[i][s];
+    }
+
+    // Reduce the options to one out of each set that are swapped by the
+    // symmetries leaving the used symbols alone. The highest symbol of
+    // each set is kept, as that is the one that would be tried first.
+    SymbolMask representatives(SymbolMask options, SymbolMask used) const;
+
+private:
+    typedef std::vector<Symbol> Permutation;
+
+    void search(
+        const Sequence& sequence,
+        const std::vector<Symbol>& symbols,
+        int next,
+        Permutation& permutation,
+        SymbolMask taken
+    );
+
+    std::vector<Permutation> mPermutations;
+
+    // The symbols each permutation moves.
+    std::vector<SymbolMask> mMoved;
+};
+
+#endif // SOLVER_VALUESYMMETRY_H__INCLUDED
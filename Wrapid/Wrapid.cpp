@@ -11,6 +11,7 @@
 
 #include <iostream>
 #include <vector>
+#include <ctime>
 #include <tchar.h>
 #include <assert.h>
 
@@ -25,7 +26,21 @@ namespace
           "CoordinateNextTest",
           "GridTest",
           "GridValuesTest",
+          "TopologyTest",
+          "SymmetryTest",
+          "ValueSymmetryTest",
           "GridSolverTest",
+          "ParallelSolverTest",
+          "SatSolverTest",
+          "SatEngineTest",
+          "SymbolUsageTest",
+          "ComponentSolverTest",
+          "CutSolverTest",
+          "SubproblemCacheTest",
+          "TransferCounterTest",
+          "SolutionDiagramTest",
+          "TreeDecompositionTest",
+          "TreeSolverTest",
           "HourPuzzleIOTest",
           "HourPuzzleTest",
           "CardPuzzle3DIOTest",
@@ -98,8 +113,47 @@ namespace
         return result;
     }
 
+    // Rather than showing the first solution, just say how many there are.
+    struct CountMode
+    {
+        CountMode()
+            : enabled(false)
+            , limit(0)
+        {
+        }
+
+        bool enabled;
+
+        // Stop counting here, unless it's zero.
+        Solver::SolutionCount limit;
+    };
+
     template <class Puzzle>
-    int solvePuzzle()
+    int showCount(Puzzle& puzzle, Solver::SolutionCount limit)
+    {
+        std::cout << "Counting . . . . ";
+
+        Utils::Stopwatch watch;
+
+        Solver::SolutionCount count = puzzle.countSolutions(limit);
+
+        double time = watch.elapsed();
+
+        std::cout << " " << time << " ms\n" << std::endl;
+        if(limit != 0 && count == limit)
+        {
+            std::cout << "There are at least " << count << " solutions." << std::endl;
+        }
+        else
+        {
+            std::cout << "There are " << count << " solutions." << std::endl;
+        }
+        pauseForInput();
+        return count > 0 ? 0 : -Solver::kNoSolution;
+    }
+
+    template <class Puzzle>
+    int solvePuzzle(Solver::SearchOptions options, const CountMode& countMode)
     {
         const int kMaxLineLength = 1000;
         char buffer[kMaxLineLength];
@@ -116,9 +170,15 @@ namespace
             lines.push_back(line);
         }
 
-        Puzzle puzzle;
+        // Only the first solution is shown.
+        options.flags |= Solver::kFirstSolutionOnly;
+        Puzzle puzzle(options);
         Solver::ParseResult result = puzzle.parse(lines);
-        if(result == Solver::kParseSucceed)
+        if(result == Solver::kParseSucceed && countMode.enabled)
+        {
+            return showCount(puzzle, countMode.limit);
+        }
+        else if(result == Solver::kParseSucceed)
         {
             Solver::SolveResult nextResult = showSolving(puzzle);
 
@@ -170,7 +230,196 @@ namespace
                      "  -Card4D\n"
                      "      The 4D puzzle with 3 rows, 3 columns, 3 levels and 2 volumes.\n\n"
                      "  -UnitTest\n"
-                     "      Runs the unit test suite, which may be excluded at compile time." << std::endl;
+                     "      Runs the unit test suite, which may be excluded at compile time.\n\n"
+                     "The puzzle option must come last. It can be preceded by these\n"
+                     "options:\n\n"
+                     "  -ForwardCheck\n"
+                     "      Track the options left for every empty cell, and back out\n"
+                     "      as soon as any of them runs out.\n\n"
+                     "  -SmallestDomain\n"
+                     "      Always fill in the empty cell with the fewest options left next.\n"
+                     "      This implies -ForwardCheck.\n\n"
+                     "  -ArcConsistency\n"
+                     "      After each placement keep removing options that no neighbour\n"
+                     "      could sit next to, until nothing more changes.\n\n"
+                     "  -BreakSymmetry\n"
+                     "      Only look for one solution out of each set that are the same\n"
+                     "      when the board is turned, shifted or reflected.\n\n"
+                     "  -ExpandSymmetry\n"
+                     "      As -BreakSymmetry, but then turn each solution found back\n"
+                     "      into all of the others like it.\n\n"
+                     "  -BreakValueSymmetry\n"
+                     "      Only look for one solution out of each set that are the same\n"
+                     "      when the symbols are swapped around, such as by turning the\n"
+                     "      clock face. This does nothing with the board symmetry options.\n\n"
+                     "  -Cardinality\n"
+                     "      Back out as soon as the symbols left can't fill the empty\n"
+                     "      cells, and fill in a symbol wherever it has to go because\n"
+                     "      nowhere else is left for it. This implies -ForwardCheck.\n\n"
+                     "  -NeighbourCapacity\n"
+                     "      Back out as soon as a filled in cell has more empty\n"
+                     "      neighbours than there are symbols left to go next to it.\n\n"
+                     "  -Chains\n"
+                     "      Fill in each corridor of empty cells all at once. This does\n"
+                     "      nothing with -SmallestDomain, -Backjump or -BreakValueSymmetry.\n\n"
+                     "  -Components\n"
+                     "      When the walls split the board into separate parts, solve\n"
+                     "      each part by itself and put them together by the symbols\n"
+                     "      they use. The parts are searched on one thread.\n\n"
+                     "  -Cut\n"
+                     "      When a few tunnels or gaps are all that join a slice of the\n"
+                     "      board to the rest, solve both sides by themselves and match\n"
+                     "      them up across the cut. The sides are searched on one thread.\n\n"
+                     "  -Islands\n"
+                     "      When counting, count each island of empty cells that the\n"
+                     "      filled in cells cut off by itself, and put them together by\n"
+                     "      the symbols they use. This does nothing with the symmetry options.\n\n"
+                     "  -CacheIslands\n"
+                     "      As -Islands, and remember what each island came to so the\n"
+                     "      same island found again is not searched again.\n\n"
+                     "  -Transfer\n"
+                     "      Count by sweeping across the board a column at a time,\n"
+                     "      keeping how many ways there are of reaching each column of\n"
+                     "      values and symbols left. Best for narrow boards.\n\n"
+                     "  -Diagram\n"
+                     "      Sweep across the board as -Transfer does, and keep all of\n"
+                     "      the solutions in a compact diagram to count or step through.\n\n"
+                     "  -Tree\n"
+                     "      When the empty cells are only loosely joined up, solve by\n"
+                     "      working along a tree of small groups of them instead of\n"
+                     "      searching. Other boards are searched as usual.\n\n"
+                     "  -Backjump\n"
+                     "      When a cell runs out of options, go straight back to the last\n"
+                     "      cell that helped rule them out.\n\n"
+                     "  -Nogoods\n"
+                     "      As -Backjump, and remember small sets of cells that can't\n"
+                     "      be filled in together so they are ruled out at once.\n\n"
+                     "  -Restarts\n"
+                     "      Break ties in the search order at random, and start again\n"
+                     "      in a new order whenever a run takes too long without finding\n"
+                     "      a solution. The seed used is shown, so a run can be repeated.\n\n"
+                     "  -Seed n\n"
+                     "      The seed for -Restarts, rather than one from the clock.\n\n"
+                     "  -Sat\n"
+                     "      Solve by handing the puzzle to a SAT solver instead of\n"
+                     "      searching the grid. The other search options are ignored.\n\n"
+                     "  -Parallel\n"
+                     "      Split the search up and run it on every core.\n\n"
+                     "  -Count [limit]\n"
+                     "      Count the solutions instead of showing the first one.\n"
+                     "      Counting stops at the limit if there is one, so a limit\n"
+                     "      of 2 checks whether the solution is unique." << std::endl;
+    }
+
+    // Returns false if the option isn't recognized.
+    bool parseSearchOption(const _TCHAR* option, Solver::SearchOptions& options)
+    {
+        if(_tcscmp(option, _T("-ForwardCheck")) == 0)
+        {
+            options.flags |= Solver::kForwardChecking;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-SmallestDomain")) == 0)
+        {
+            options.flags |= Solver::kSmallestDomainFirst;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-ArcConsistency")) == 0)
+        {
+            options.flags |= Solver::kArcConsistency;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-BreakSymmetry")) == 0)
+        {
+            options.flags |= Solver::kBreakSymmetry;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-ExpandSymmetry")) == 0)
+        {
+            options.flags |= Solver::kExpandSymmetry;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-BreakValueSymmetry")) == 0)
+        {
+            options.flags |= Solver::kBreakValueSymmetry;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Cardinality")) == 0)
+        {
+            options.flags |= Solver::kCardinality;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-NeighbourCapacity")) == 0)
+        {
+            options.flags |= Solver::kNeighbourCapacity;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Chains")) == 0)
+        {
+            options.flags |= Solver::kCompressChains;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Components")) == 0)
+        {
+            options.flags |= Solver::kSplitComponents;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Cut")) == 0)
+        {
+            options.flags |= Solver::kCutJoin;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Islands")) == 0)
+        {
+            options.flags |= Solver::kSplitIslands;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-CacheIslands")) == 0)
+        {
+            options.flags |= Solver::kCacheIslands;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Transfer")) == 0)
+        {
+            options.flags |= Solver::kTransferCount;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Diagram")) == 0)
+        {
+            options.flags |= Solver::kSolutionDiagram;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Tree")) == 0)
+        {
+            options.flags |= Solver::kTreeDecomposition;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Backjump")) == 0)
+        {
+            options.flags |= Solver::kBackjumping;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Nogoods")) == 0)
+        {
+            options.flags |= Solver::kRecordNogoods;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Restarts")) == 0)
+        {
+            options.flags |= Solver::kRestarts;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Sat")) == 0)
+        {
+            options.flags |= Solver::kSatBackend;
+            return true;
+        }
+        else if(_tcscmp(option, _T("-Parallel")) == 0)
+        {
+            options.threads = 0;
+            return true;
+        }
+        return false;
     }
 
     int story()
@@ -309,6 +558,44 @@ int _tmain(int argc, _TCHAR* argv[])
 {
     if(argc > 1)
     {
+        Solver::SearchOptions searchOptions;
+        CountMode countMode;
+        bool seeded = false;
+        for(int i = 1; i < argc - 1; ++i)
+        {
+            if(_tcscmp(argv[i], _T("-Count")) == 0)
+            {
+                countMode.enabled = true;
+                if(i + 1 < argc - 1 && _istdigit(argv[i + 1][0]))
+                {
+                    ++i;
+                    countMode.limit = _ttoi(argv[i]);
+                }
+            }
+            else if(_tcscmp(argv[i], _T("-Seed")) == 0 && i + 1 < argc - 1 && _istdigit(argv[i + 1][0]))
+            {
+                ++i;
+                searchOptions.seed = (unsigned)_ttoi(argv[i]);
+                seeded = true;
+            }
+            else if(!parseSearchOption(argv[i], searchOptions))
+            {
+                printUsage();
+                printGap(2);
+                pauseForInput();
+                return 0;
+            }
+        }
+        if(searchOptions.has(Solver::kRestarts))
+        {
+            if(!seeded)
+            {
+                searchOptions.seed = (unsigned)std::time(NULLPTR);
+            }
+            // So a slow run can be repeated with -Seed.
+            std::cout << "Seed: " << searchOptions.seed << std::endl;
+        }
+
         const _TCHAR* option = argv[argc - 1];
         if(_tcscmp(option, _T("-UnitTest")) == 0)
         {
@@ -321,15 +608,15 @@ int _tmain(int argc, _TCHAR* argv[])
         }
         else if(_tcscmp(option, _T("-Hour")) == 0)
         {
-            return solvePuzzle<Solver::HourPuzzle>();
+            return solvePuzzle<Solver::HourPuzzle>(searchOptions, countMode);
         }
         else if(_tcscmp(option, _T("-Card3D")) == 0)
         {
-            return solvePuzzle<Solver::CardPuzzle3D>();
+            return solvePuzzle<Solver::CardPuzzle3D>(searchOptions, countMode);
         }
         else if(_tcscmp(option, _T("-Card4D")) == 0)
         {
-            return solvePuzzle<Solver::CardPuzzle4D>();
+            return solvePuzzle<Solver::CardPuzzle4D>(searchOptions, countMode);
         }
         else
         {